@@ -16,6 +16,8 @@
 #include "tiny86/program.h"
 #include "tiny86/program/programbuilder.h"
 #include "tiny86/program/helpers.h"
+#include "tiny86/program/assembler.h"
+#include "tiny86/target.h"
 
 using namespace tiny::t86;
 using namespace tiny;
@@ -32,6 +34,7 @@ int main(int argc, char * argv[]) {
     tiny::t86::Cpu::Config::instance();
 
     config.setDefaultIfMissing("-o","0");
+    config.setDefaultIfMissing("-asmOutput","");
 
     std::ifstream file(config.input());
     std::string str((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
@@ -39,6 +42,21 @@ int main(int argc, char * argv[]) {
     std::cout << color::gray << "NI-GEN 2022" << color::reset << std::endl;
     initializeTerminal();
     try {
+        // Hand written t86 assembly skips the compiler entirely
+        const std::string & input = config.input();
+        if (input.size() > 4 && input.compare(input.size() - 4, 4, ".t86") == 0) {
+            Assembler as;
+            Program program = as.assemble(str);
+            if (const std::string & asmOutput = config.get("-asmOutput"); !asmOutput.empty()) {
+                std::ofstream os(asmOutput);
+                Assembler::disassemble(program, os);
+            }
+            Target ex;
+            ex.coRunCompiler = Backend::Compile;
+            ex.execute(std::move(program));
+            return EXIT_SUCCESS;
+        }
+
         Frontend front;
         std::unique_ptr<AST> ast = front.parse(str);
         std::cout << "AST:" << std::endl;
@@ -52,12 +70,15 @@ int main(int argc, char * argv[]) {
         Optimalization optim(IRprg);
 
 
-        if (config.get("-o") == "1")
-            optim.StartAll();
+        optim.StartLevel(std::stoi(config.get("-o")),
+                         std::stoi(config.get(tiny::t86::Cpu::Config::registerCountConfigString)),
+                         std::stoi(config.get(tiny::t86::Cpu::Config::vectorRegisterCountConfigString)),
+                         Backend::MispredictPenalty());
 
         Backend back(IRprg,
                     std::stoul(config.get(tiny::t86::Cpu::Config::registerCountConfigString)),
-                    std::stoul(config.get(tiny::t86::Cpu::Config::floatRegisterCountConfigString)));
+                    std::stoul(config.get(tiny::t86::Cpu::Config::floatRegisterCountConfigString)),
+                    std::stoul(config.get(tiny::t86::Cpu::Config::vectorRegisterCountConfigString)));
 
         back.irtot86();
 
@@ -0,0 +1,404 @@
+#include <cstdlib>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <sys/resource.h>
+
+#include "tinyC/backend.h"
+
+#include "common/config.h"
+
+#include "tiny86/cpu.h"
+#include "tiny86/program.h"
+#include "tiny86/program/assembler.h"
+#include "tiny86/target.h"
+
+using namespace tiny::t86;
+using namespace tiny;
+using namespace tinyc;
+
+/** Simulator throughput benchmark
+
+    Every program (the examples and generated synthetic ones) is compiled once, then Target::execute
+    is timed over warm-up and measured repetitions. Output of the programs and the stats printed
+    by Target are discarded, the results are written as JSON so two builds can be diffed. Peak RSS is
+    reported once for the whole process, after all benchmarks ran.
+
+    Options:
+        -examples=dir       directory with tinyC programs, all *.txt and *.t86 files are used
+        -synthetic=1,2,4    scales of generated programs, empty for none
+        -warmup=1           repetitions which are not measured
+        -repetitions=5      measured repetitions
+        -benchOutput=file   JSON is written here instead of stdout
+        -o=1                optimization level of compiled programs, as in ni-gen
+    Any option of the Cpu (-aluCnt, ...) applies to all runs.
+ */
+
+namespace {
+
+    constexpr const char* examplesConfigString = "-examples";
+
+    constexpr const char* syntheticConfigString = "-synthetic";
+
+    constexpr const char* warmupConfigString = "-warmup";
+
+    constexpr const char* repetitionsConfigString = "-repetitions";
+
+    constexpr const char* outputConfigString = "-benchOutput";
+
+    struct Benchmark {
+        std::string name;
+
+        // Assembly of the compiled program, Program can't be copied so it is assembled before every run
+        std::string assembly;
+
+        std::string error;
+    };
+
+    struct Statistics {
+        double median{0};
+
+        double q1{0};
+
+        double q3{0};
+
+        double min{0};
+
+        double max{0};
+
+        static Statistics of(std::vector<double> samples) {
+            Statistics result;
+            if (samples.empty()) {
+                return result;
+            }
+            std::sort(samples.begin(), samples.end());
+            result.median = quantile(samples, 0.5);
+            result.q1 = quantile(samples, 0.25);
+            result.q3 = quantile(samples, 0.75);
+            result.min = samples.front();
+            result.max = samples.back();
+            return result;
+        }
+
+    private:
+        // Linear interpolation between the closest ranks
+        static double quantile(const std::vector<double>& sorted, double q) {
+            double position = q * static_cast<double>(sorted.size() - 1);
+            auto lower = static_cast<std::size_t>(position);
+            std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+            return sorted[lower] + (sorted[upper] - sorted[lower]) * (position - static_cast<double>(lower));
+        }
+    };
+
+    struct Result {
+        std::size_t programSize{0};
+
+        std::size_t ticks{0};
+
+        std::size_t instructions{0};
+
+        std::vector<double> seconds;
+    };
+
+    /** Swaps std::cout and std::cerr for a sink for its lifetime
+     */
+    class Silence {
+    public:
+        Silence() : cout_{std::cout.rdbuf(&sink_)}, cerr_{std::cerr.rdbuf(&sink_)} {}
+
+        ~Silence() {
+            std::cout.rdbuf(cout_);
+            std::cerr.rdbuf(cerr_);
+        }
+
+    private:
+        class Sink : public std::streambuf {
+        protected:
+            int overflow(int c) override {
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(const char*, std::streamsize count) override {
+                return count;
+            }
+        };
+
+        Sink sink_;
+
+        std::streambuf* cout_;
+
+        std::streambuf* cerr_;
+    };
+
+    std::string readFile(const std::string& path) {
+        std::ifstream file(path);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    /** Generates tinyC program whose run length and code size grow with the scale
+     */
+    std::string syntheticProgram(std::size_t scale) {
+        std::size_t functions = 4 * scale;
+        std::ostringstream os;
+        for (std::size_t i = 0; i < functions; ++i) {
+            os << "int f" << i << "(int a, int b)\n"
+               << "{\n"
+               << "    int c = a * " << i + 3 << " + b;\n"
+               << "    if (c > 5000)\n"
+               << "        c = c - 4999;\n"
+               << "    return c % 1009;\n"
+               << "}\n\n";
+        }
+        os << "int fib(int n)\n"
+           << "{\n"
+           << "    if (n < 2)\n"
+           << "        return n;\n"
+           << "    return fib(n - 1) + fib(n - 2);\n"
+           << "}\n\n"
+           << "void main()\n"
+           << "{\n"
+           << "    int i;\n"
+           << "    int s = 0;\n"
+           << "    for (i = 0; i < " << 25 * scale << "; i++) {\n";
+        for (std::size_t i = 0; i < functions; ++i) {
+            os << "        s = f" << i << "(s, i);\n";
+        }
+        os << "    }\n"
+           << "    print(s);\n"
+           << "    print(fib(" << 6 + std::min<std::size_t>(scale, 8) << "));\n"
+           << "}\n";
+        return os.str();
+    }
+
+    // Same pipeline as ni-gen at the -o level of the config
+    std::string compile(const std::string& source) {
+        std::ostringstream os;
+        Assembler::disassemble(Backend::Compile(source), os);
+        return os.str();
+    }
+
+    Benchmark prepare(const std::string& name, const std::string& source, bool assembly) {
+        Benchmark benchmark{name, "", ""};
+        try {
+            if (assembly) {
+                benchmark.assembly = source;
+                // Fails early on invalid input
+                Assembler().assemble(source);
+            } else {
+                Silence silence;
+                benchmark.assembly = compile(source);
+            }
+        } catch (std::exception const& e) {
+            benchmark.error = e.what();
+        }
+        return benchmark;
+    }
+
+    Result run(const Benchmark& benchmark, std::size_t warmup, std::size_t repetitions) {
+        Result result;
+        for (std::size_t i = 0; i < warmup + repetitions; ++i) {
+            Program program = Assembler().assemble(benchmark.assembly);
+            result.programSize = program.size();
+            double seconds;
+            {
+                Silence silence;
+                auto start = std::chrono::steady_clock::now();
+                Target().execute(std::move(program));
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            if (i >= warmup) {
+                result.seconds.push_back(seconds);
+            }
+            result.ticks = StatsLogger::instance().tickCount();
+            result.instructions = StatsLogger::instance().retiredCount();
+        }
+        StatsLogger::instance().reset();
+        return result;
+    }
+
+    std::string escape(const std::string& text) {
+        std::ostringstream os;
+        for (char c : text) {
+            switch (c) {
+                case '"':
+                    os << "\\\"";
+                    break;
+                case '\\':
+                    os << "\\\\";
+                    break;
+                case '\n':
+                    os << "\\n";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                    } else {
+                        os << c;
+                    }
+            }
+        }
+        return os.str();
+    }
+
+    void printStatistics(std::ostream& os, const char* name, const Statistics& statistics) {
+        os << "\"" << name << "\": {\"median\": " << statistics.median
+           << ", \"q1\": " << statistics.q1
+           << ", \"q3\": " << statistics.q3
+           << ", \"iqr\": " << statistics.q3 - statistics.q1
+           << ", \"min\": " << statistics.min
+           << ", \"max\": " << statistics.max << "}";
+    }
+
+    void printResult(std::ostream& os, const Benchmark& benchmark, const Result& result) {
+        os << "    {\"name\": \"" << escape(benchmark.name) << "\"";
+        if (!benchmark.error.empty()) {
+            os << ", \"error\": \"" << escape(benchmark.error) << "\"}";
+            return;
+        }
+        Statistics seconds = Statistics::of(result.seconds);
+        std::vector<double> ticksPerSecond;
+        std::vector<double> instructionsPerSecond;
+        for (double s : result.seconds) {
+            ticksPerSecond.push_back(s > 0 ? static_cast<double>(result.ticks) / s : 0);
+            instructionsPerSecond.push_back(s > 0 ? static_cast<double>(result.instructions) / s : 0);
+        }
+        os << ", \"programSize\": " << result.programSize
+           << ", \"ticks\": " << result.ticks
+           << ", \"instructions\": " << result.instructions
+           << ",\n     ";
+        printStatistics(os, "hostSeconds", seconds);
+        os << ",\n     ";
+        printStatistics(os, "ticksPerSecond", Statistics::of(ticksPerSecond));
+        os << ",\n     ";
+        printStatistics(os, "instructionsPerSecond", Statistics::of(instructionsPerSecond));
+        os << "}";
+    }
+}
+
+int main(int argc, char * argv[]) {
+
+    config.parse(argc, argv);
+    Cpu::Config::instance();
+
+    config.setDefaultIfMissing("-o", "0");
+    config.setDefaultIfMissing(examplesConfigString, T86_BENCH_EXAMPLES_DIR);
+    config.setDefaultIfMissing(syntheticConfigString, "1,2,4");
+    config.setDefaultIfMissing(warmupConfigString, "1");
+    config.setDefaultIfMissing(repetitionsConfigString, "5");
+    config.setDefaultIfMissing(outputConfigString, "");
+
+    try {
+        int level = std::stoi(config.get("-o"));
+        std::size_t warmup = std::stoul(config.get(warmupConfigString));
+        std::size_t repetitions = std::max<std::size_t>(1, std::stoul(config.get(repetitionsConfigString)));
+
+        std::vector<Benchmark> benchmarks;
+        std::vector<std::filesystem::path> files;
+        if (const std::string& examples = config.get(examplesConfigString); !examples.empty()) {
+            for (const auto& entry : std::filesystem::directory_iterator(examples)) {
+                auto extension = entry.path().extension();
+                if (entry.is_regular_file() && (extension == ".txt" || extension == ".t86")) {
+                    files.push_back(entry.path());
+                }
+            }
+        }
+        // Directory order is not stable, results of two runs should line up
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            benchmarks.push_back(prepare(file.filename().string(), readFile(file.string()),
+                                         file.extension() == ".t86"));
+        }
+        std::istringstream scales(config.get(syntheticConfigString));
+        for (std::string scale; std::getline(scales, scale, ',');) {
+            benchmarks.push_back(prepare("synthetic-" + scale, syntheticProgram(std::stoul(scale)), false));
+        }
+
+        std::ofstream file;
+        if (const std::string& output = config.get(outputConfigString); !output.empty()) {
+            file.open(output);
+        }
+        std::ostream& os = file.is_open() ? file : std::cout;
+        os << "{\n  \"warmup\": " << warmup << ",\n  \"repetitions\": " << repetitions << ",\n  \"optimizationLevel\": "
+           << level << ",\n  \"cpu\": {";
+        const char* cpuOptions[] = {
+                Cpu::Config::registerCountConfigString,
+                Cpu::Config::floatRegisterCountConfigString,
+                Cpu::Config::vectorRegisterCountConfigString,
+                Cpu::Config::aluCountConfigString,
+                Cpu::Config::reservationStationEntriesCountConfigString,
+                Cpu::Config::ramSizeConfigString,
+                Cpu::Config::ramGatesCountConfigString,
+                Cpu::Config::instructionCacheSizeConfigString,
+                Cpu::Config::instructionCacheAssociativityConfigString,
+                Cpu::Config::instructionCacheLineSizeConfigString,
+                Cpu::Config::instructionCacheMissLatencyConfigString,
+                Cpu::Config::frontendStagesConfigString,
+                Cpu::Config::renameLatencyConfigString,
+                Cpu::Config::loopBufferSizeConfigString,
+                Cpu::Config::prefetchTableSizeConfigString,
+                Cpu::Config::prefetchDistanceConfigString,
+                Cpu::Config::prefetchDegreeConfigString,
+                Cpu::Config::prefetchBufferSizeConfigString,
+                Cpu::Config::dramBanksConfigString,
+                Cpu::Config::dramRowSizeConfigString,
+                Cpu::Config::dramMappingConfigString,
+                Cpu::Config::dramCasConfigString,
+                Cpu::Config::dramRcdConfigString,
+                Cpu::Config::dramRpConfigString,
+                Cpu::Config::vectorUnitCountConfigString,
+                Cpu::Config::valuePredictorSizeConfigString,
+                Cpu::Config::smtThreadsConfigString,
+                Cpu::Config::smtFetchPolicyConfigString,
+                Cpu::Config::dataCacheSizeConfigString,
+                Cpu::Config::dataCacheAssociativityConfigString,
+                Cpu::Config::dataCacheLineSizeConfigString,
+                Cpu::Config::coherenceProtocolConfigString,
+                Cpu::Config::coherenceLatencyConfigString,
+                Cpu::Config::coreStackSizeConfigString,
+        };
+        for (std::size_t i = 0; i < std::size(cpuOptions); ++i) {
+            const std::string& value = config.get(cpuOptions[i]);
+            // Policies and mappings are names, everything else is a number
+            bool number = !value.empty() && std::all_of(value.begin(), value.end(), [](unsigned char c) {
+                return std::isdigit(c);
+            });
+            os << (i ? ", " : "") << "\"" << cpuOptions[i] + 1 << "\": ";
+            if (number) {
+                os << value;
+            } else {
+                os << "\"" << value << "\"";
+            }
+        }
+        os << "},\n  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < benchmarks.size(); ++i) {
+            std::cerr << "Running " << benchmarks[i].name << std::endl;
+            Result result;
+            if (benchmarks[i].error.empty()) {
+                try {
+                    result = run(benchmarks[i], warmup, repetitions);
+                } catch (std::exception const& e) {
+                    benchmarks[i].error = e.what();
+                }
+            }
+            printResult(os, benchmarks[i], result);
+            os << (i + 1 < benchmarks.size() ? ",\n" : "\n");
+        }
+        // Peak RSS only grows over the life of the process, so it is not attributable to single benchmarks
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        // Kilobytes on Linux
+        os << "  ],\n  \"processPeakRssKiB\": " << usage.ru_maxrss << "\n}" << std::endl;
+    } catch (std::exception const & e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -4,69 +4,187 @@
 
 #include "cpu.h"
 #include "utils/stats_logger.h"
+#include "utils/host_profiler.h"
 #include "cpu/branch_predictors/naive_branch_predictor.h"
 
 #include "common/config.h"
 
 namespace tiny::t86 {
     void Cpu::tick() {
+        HostProfiler::Scope tickScope(HostProfiler::Phase::tick);
         StatsLogger::instance().newTick();
+        ++ticks_;
 
-        ram_.tick();
+        if (ownRam_) {
+            HostProfiler::Scope scope(HostProfiler::Phase::ramTick);
+            ram_.tick();
+        }
 
-        writesManager_.removeFinished(ram_);
+        {
+            HostProfiler::Scope scope(HostProfiler::Phase::removeFinishedWrites);
+            for (auto& thread : threads_) {
+                if (dataCache_) {
+                    thread.writesManager.removeFinished(*dataCache_);
+                } else {
+                    thread.writesManager.removeFinished(ram_);
+                }
+            }
+        }
 
-        reservationStation_.executeAndRetire();
+        {
+            HostProfiler::Scope scope(HostProfiler::Phase::executeAndRetire);
+            reservationStation_.executeAndRetire();
+        }
 
         if (halted()) {
             return;
         }
 
-        reservationStation_.fetchAndStartExecution();
+        {
+            HostProfiler::Scope scope(HostProfiler::Phase::fetchAndStartExecution);
+            reservationStation_.fetchAndStartExecution();
+        }
+
+        if (prefetcher_) {
+            issuePrefetches();
+        }
 
-        if (instructionDecode_) {
-            if (reservationStation_.hasFreeEntry()) {
-                reservationStation_.add(instructionDecode_->instruction, instructionDecode_->pc, instructionDecode_->loggingId);
-                instructionDecode_ = std::nullopt;
+        // The loop buffer takes the slot of the fetch for this tick
+        bool loopBufferDelivered = false;
+        {
+            HostProfiler::Scope scope(HostProfiler::Phase::dispatch);
+            auto& dispatched = frontend_.back();
+            if (dispatched) {
+                if (reservationStation_.hasFreeEntry() && !reservationStation_.serializing(dispatched->thread)) {
+                    reservationStation_.add(dispatched->instruction, dispatched->pc, dispatched->loggingId, dispatched->thread);
+                    dispatched = std::nullopt;
+                }
+            } else if (frontendEmpty() && loopBufferStreaming()) {
+                loopBufferDelivered = dispatchFromLoopBuffer();
             }
         }
 
-        if (!instructionDecode_) {
-            // this will set instructionFetch to be nullopt
-            std::swap(instructionDecode_, instructionFetch_);
+        // Stalled stage holds the ones before it, free stages are filled from the previous ones
+        for (std::size_t i = frontend_.size() - 1; i > 0; --i) {
+            if (!frontend_[i]) {
+                std::swap(frontend_[i], frontend_[i - 1]);
+            }
         }
 
-        if (!instructionFetch_) {
-            instructionFetch_ = fetchInstruction();
+        if (!frontend_.front() && !loopBufferDelivered && !loopBufferStreaming()) {
+            HostProfiler::Scope scope(HostProfiler::Phase::fetch);
+            if (auto thread = selectFetchThread()) {
+                // Threads share the cache, their programs are told apart by the upper bits
+                uint64_t address = (static_cast<uint64_t>(*thread) << 40) | threads_[*thread].speculativeProgramCounter;
+                auto access = instructionCache_ ? instructionCache_->fetch(address) : InstructionCache::Access::hit;
+                if (instructionCache_) {
+                    StatsLogger::instance().logInstructionCacheAccess(access);
+                }
+                if (InstructionCache::ready(access)) {
+                    frontend_.front() = fetchInstruction(*thread);
+                    lastFetchThread_ = *thread;
+                    instructionCacheThread_ = std::nullopt;
+                } else {
+                    instructionCacheThread_ = thread;
+                }
+            }
         }
 
-        if (instructionFetch_) {
-            StatsLogger::instance().logInstructionFetch(instructionFetch_->loggingId);
+        if (frontend_.front()) {
+            StatsLogger::instance().logInstructionFetch(frontend_.front()->loggingId);
+        }
+        for (std::size_t i = 1; i < frontend_.size(); ++i) {
+            if (frontend_[i]) {
+                StatsLogger::instance().logInstructionDecode(i - 1, frontend_[i]->loggingId);
+            }
         }
-        if (instructionDecode_) {
-            StatsLogger::instance().logInstructionDecode(instructionDecode_->loggingId);
+        if (frontend_.back() || loopBufferStreaming()) {
+            StatsLogger::instance().logDispatchReady();
         }
     }
 
-    Cpu::InstructionEntry Cpu::fetchInstruction() {
-        std::size_t oldPc = speculativeProgramCounter_;
-        const auto* instruction = program_.at(speculativeProgramCounter_);
+    bool Cpu::frontendEmpty() const {
+        return std::none_of(frontend_.begin(), frontend_.end(), [](const auto& stage) {
+            return stage.has_value();
+        });
+    }
+
+    Cpu::InstructionEntry Cpu::fetchInstruction(std::size_t thread) {
+        Thread& t = threads_[thread];
+        std::size_t oldPc = t.speculativeProgramCounter;
+        const auto* instruction = t.program.at(t.speculativeProgramCounter);
         if (auto jumpInstruction = dynamic_cast<const JumpInstruction*>(instruction); jumpInstruction) {
-            speculativeProgramCounter_ = branchPredictor_->nextGuess(speculativeProgramCounter_, *jumpInstruction);
-            predictions_.push_back(speculativeProgramCounter_);
+            t.speculativeProgramCounter = t.branchPredictor->nextGuess(t.speculativeProgramCounter, *jumpInstruction);
+            t.predictions.push_back(t.speculativeProgramCounter);
+            if (loopBuffer_ && t.speculativeProgramCounter != oldPc + 1) {
+                loopBuffer_->observeBranch(oldPc, t.speculativeProgramCounter);
+            }
         }
         else {
-            ++speculativeProgramCounter_;
+            ++t.speculativeProgramCounter;
+        }
+        return {instruction, oldPc + 1, StatsLogger::instance().registerNewInstruction(oldPc, instruction, thread), thread};
+    }
+
+    bool Cpu::loopBufferStreaming() const {
+        return loopBuffer_ && !threads_.front().halted && loopBuffer_->covers(threads_.front().speculativeProgramCounter);
+    }
+
+    bool Cpu::dispatchFromLoopBuffer() {
+        if (!reservationStation_.hasFreeEntry() || reservationStation_.serializing(0)) {
+            return false;
+        }
+        InstructionEntry entry = fetchInstruction(0);
+        // Fetch of the instruction is logged only for its lifetime, it spends no tick in fetch or decode
+        StatsLogger::instance().logInstructionFetch(entry.loggingId);
+        StatsLogger::instance().logLoopBufferDelivery();
+        reservationStation_.add(entry.instruction, entry.pc, entry.loggingId, entry.thread);
+        redirectLoopBuffer(0);
+        return true;
+    }
+
+    void Cpu::redirectLoopBuffer(std::size_t thread) {
+        // The buffer follows only the first thread
+        if (loopBuffer_ && thread == 0 && !loopBuffer_->covers(threads_[thread].speculativeProgramCounter)) {
+            loopBuffer_->unlock();
         }
-        return {instruction, oldPc + 1, StatsLogger::instance().registerNewInstruction(oldPc, instruction)};
+    }
+
+    std::optional<std::size_t> Cpu::selectFetchThread() const {
+        // Fill of the instruction cache would be abandoned by fetching elsewhere
+        if (instructionCacheThread_ && !threads_[*instructionCacheThread_].halted) {
+            return instructionCacheThread_;
+        }
+        std::optional<std::size_t> selected;
+        std::size_t selectedInFlight = 0;
+        // Ties are broken round robin
+        for (std::size_t i = 1; i <= threads_.size(); ++i) {
+            std::size_t thread = (lastFetchThread_ + i) % threads_.size();
+            if (threads_[thread].halted) {
+                continue;
+            }
+            if (fetchPolicy_ == FetchPolicy::roundRobin) {
+                return thread;
+            }
+            // Instructions being fetched do not count
+            std::size_t inFlight = reservationStation_.entriesCount(thread)
+                    + std::count_if(frontend_.begin() + 1, frontend_.end(), [thread](const auto& stage) {
+                        return stage && stage->thread == thread;
+                    });
+            if (!selected || inFlight < selectedInFlight) {
+                selected = thread;
+                selectedInFlight = inFlight;
+            }
+        }
+        return selected;
     }
 
     int64_t Cpu::getRegister(Register reg) const {
-        return getRegister(rat_.translate(reg));
+        return getRegister(threads_.at(debugThread_).rat.translate(reg));
     }
 
     double Cpu::getFloatRegister(FloatRegister fReg) const {
-        return getFloatRegister(rat_.translate(fReg));
+        return getFloatRegister(threads_.at(debugThread_).rat.translate(fReg));
     }
 
     int64_t Cpu::getRegister(PhysicalRegister reg) const {
@@ -78,37 +196,116 @@ namespace tiny::t86 {
         return *reinterpret_cast<double*>(&val);
     }
 
+    const VectorRegister::Value& Cpu::getVectorRegister(VectorRegister vReg) const {
+        return getVectorRegister(threads_.at(debugThread_).rat.translate(vReg));
+    }
+
+    const VectorRegister::Value& Cpu::getVectorRegister(PhysicalRegister reg) const {
+        return vectorRegisters_.at(reg.index());
+    }
+
     Cpu::Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt)
             : Cpu(registerCount, floatRegisterCount, aluCnt, aluCnt * 2, Config::instance().ramSize(), Config::instance().ramGatesCount()) {}
 
     Cpu::Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount,
         std::size_t ramSize, std::size_t ramGatesCnt)
-            : reservationStation_(*this, aluCnt, reservationStationEntriesCount),
-              branchPredictor_{std::make_unique<NaiveBranchPredictor>()},
+            : Cpu(registerCount, floatRegisterCount, aluCnt, reservationStationEntriesCount, ramSize, ramGatesCnt, nullptr, nullptr, nullptr, 0) {}
+
+    Cpu::Cpu(RAM& ram, CoherentCache& dataCache, IOChannel& io, std::size_t coreId)
+            : Cpu(Config::instance().registerCnt(),
+                  Config::instance().floatRegisterCnt(),
+                  Config::instance().aluCnt(),
+                  Config::instance().reservationStationEntriesCnt(),
+                  ram.size(),
+                  Config::instance().ramGatesCount(),
+                  &ram, &dataCache, &io, coreId) {}
+
+    Cpu::Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount,
+        std::size_t ramSize, std::size_t ramGatesCnt, RAM* sharedRam, CoherentCache* dataCache, IOChannel* sharedIo,
+        std::size_t coreId)
+            : frontend_(Config::instance().frontendStages() + Config::instance().renameLatency()),
               registerCnt_(registerCount),
               floatRegisterCnt_(floatRegisterCount),
-              physicalRegisterCnt_(specialRegistersCnt + registerCount + floatRegisterCount + reservationStationEntriesCount * possibleRenamedRegisterCnt),
+              vectorRegisterCnt_(Config::instance().vectorRegisterCnt()),
+              physicalRegisterCnt_(Config::instance().smtThreads() * contextRegistersCount() + reservationStationEntriesCount * possibleRenamedRegisterCnt),
               registers_(physicalRegisterCnt_),
-              rat_(*this, registerCount, floatRegisterCount),
-              ram_(ramSize, ramGatesCnt)
+              vectorRegisters_(physicalRegisterCnt_),
+              ownRam_(sharedRam ? std::nullopt : std::optional<RAM>(std::in_place, ramSize, ramGatesCnt,
+                      Config::instance().prefetchTableSize() > 0 ? Config::instance().prefetchBufferSize() : 0)),
+              ram_(sharedRam ? *sharedRam : *ownRam_),
+              dataCache_(dataCache),
+              ownIo_(sharedIo ? std::nullopt : std::optional<IOChannel>(std::in_place)),
+              io_(sharedIo ? *sharedIo : *ownIo_),
+              coreId_(coreId),
+              reservationStation_(*this, aluCnt, Config::instance().vectorUnitCnt(), reservationStationEntriesCount),
+              fetchPolicy_(Config::instance().smtFetchPolicy())
     {
-        // To be sure, theoretically not needed
-        for (std::size_t i = 0; i < registerCount; ++i) {
-            setRegister(Register{i}, 0);
+        std::size_t threadsCnt = Config::instance().smtThreads();
+        if (threadsCnt == 0) {
+            throw std::invalid_argument("Cpu needs at least one hardware thread");
+        }
+        if (dataCache_ && threadsCnt != 1) {
+            throw std::invalid_argument("Cores of a system can't have more hardware threads");
+        }
+        // Thread is referenced by its RAT, so they must not be reallocated
+        threads_.reserve(threadsCnt);
+        std::size_t memoryWindow = ram_.size() / threadsCnt;
+        for (std::size_t i = 0; i < threadsCnt; ++i) {
+            threads_.emplace_back(*this, i * contextRegistersCount(), i * memoryWindow);
+        }
+        if (auto dramTiming = Config::instance().dramTiming(); dramTiming && ownRam_) {
+            ram_.setDramTiming(*dramTiming);
+        }
+        // Loads of a core in a system do not reach the RAM, there is nothing to prefetch for
+        if (std::size_t size = Config::instance().prefetchTableSize(); size > 0 && !dataCache_) {
+            prefetcher_.emplace(size, Config::instance().prefetchDegree(), Config::instance().prefetchDistance());
+        }
+        if (std::size_t size = Config::instance().instructionCacheSize(); size > 0) {
+            instructionCache_.emplace(size,
+                                      Config::instance().instructionCacheAssociativity(),
+                                      Config::instance().instructionCacheLineSize(),
+                                      Config::instance().instructionCacheMissLatency());
         }
-        setRegister(Register::ProgramCounter(), 0);
-        setRegister(Register::Flags(), 0);
-        setRegister(Register::StackPointer(), ram_.size());
-        setRegister(Register::StackBasePointer(), ram_.size());
+        if (std::size_t size = Config::instance().loopBufferSize(); size > 0 && threadsCnt == 1) {
+            loopBuffer_.emplace(size);
+        }
+        for (debugThread_ = 0; debugThread_ < threadsCnt; ++debugThread_) {
+            // To be sure, theoretically not needed
+            for (std::size_t i = 0; i < registerCount; ++i) {
+                setRegister(Register{i}, 0);
+            }
+            for (std::size_t i = 0; i < vectorRegisterCnt_; ++i) {
+                setVectorRegister(VectorRegister{i}, {});
+            }
+            setRegister(Register::ProgramCounter(), 0);
+            setRegister(Register::Flags(), 0);
+            setRegister(Register::CoreId(), static_cast<int64_t>(coreId_ * threadsCnt + debugThread_));
+            // Stack of each thread grows from the end of its part of the RAM, cores sharing the RAM get theirs by setStack
+            setRegister(Register::StackPointer(), memoryWindow);
+            setRegister(Register::StackBasePointer(), memoryWindow);
+        }
+        debugThread_ = 0;
+    }
 
+    Cpu::Thread::Thread(Cpu& cpu, std::size_t physicalRegisterOffset, std::size_t memoryOffset)
+            : branchPredictor{std::make_unique<NaiveBranchPredictor>()},
+              rat(cpu, cpu.registerCnt_, cpu.floatRegisterCnt_, cpu.vectorRegisterCnt_, physicalRegisterOffset),
+              memoryOffset(memoryOffset) {
+        if (std::size_t size = Config::instance().valuePredictorSize(); size > 0) {
+            valuePredictor.emplace(size);
+        }
     }
 
     void Cpu::setRegister(Register reg, int64_t value) {
-        setRegister(rat_.translate(reg), value);
+        setRegister(threads_.at(debugThread_).rat.translate(reg), value);
     }
 
     void Cpu::setFloatRegister(FloatRegister fReg, double value) {
-        setRegister(rat_.translate(fReg), value);
+        setRegister(threads_.at(debugThread_).rat.translate(fReg), value);
+    }
+
+    void Cpu::setVectorRegister(VectorRegister vReg, const VectorRegister::Value& value) {
+        setRegister(threads_.at(debugThread_).rat.translate(vReg), value);
     }
 
     void Cpu::setRegister(PhysicalRegister reg, int64_t value) {
@@ -121,27 +318,102 @@ namespace tiny::t86 {
         registers_.at(reg.index()).ready = true;
     }
 
-    void Cpu::start(Program&& program) {
-        program_ = std::move(program);
-        const auto& data = program_.data();
+    void Cpu::setRegister(PhysicalRegister reg, const VectorRegister::Value& value) {
+        vectorRegisters_.at(reg.index()) = value;
+        registers_.at(reg.index()).ready = true;
+    }
+
+    void Cpu::start(Program&& program, std::size_t thread) {
+        Thread& t = threads_.at(thread);
+        t.program = std::move(program);
+        t.halted = false;
+        const auto& data = t.program.data();
         for (std::size_t i = 0; i < data.size(); ++i) {
-            setMemory(i, data[i]);
+            ram_.set(t.memoryOffset + i, data[i]);
+        }
+    }
+
+    void Cpu::setStack(std::size_t top, std::size_t limit) {
+        stack_.emplace(limit, top);
+        debugThread_ = 0;
+        setRegister(Register::StackPointer(), top);
+        setRegister(Register::StackBasePointer(), top);
+    }
+
+    void Cpu::checkStack(const ReservationStation::Entry& entry) const {
+        if (!stack_) {
+            return;
+        }
+        auto [limit, top] = *stack_;
+        auto sp = static_cast<uint64_t>(getRegister(entry.rat().translate(Register::StackPointer())));
+        if (sp < limit || sp > top) {
+            throw std::runtime_error("Stack pointer " + std::to_string(sp) + " of core " + std::to_string(coreId_)
+                                     + " left its stack [" + std::to_string(limit) + ", " + std::to_string(top)
+                                     + ") at pc " + std::to_string(entry.pc()) + ", set "
+                                     + Config::coreStackSizeConfigString + " or -ram");
         }
     }
 
+    int64_t Cpu::performanceCounter(std::size_t thread, PerformanceCounter counter) const {
+        const Thread& t = threads_.at(thread);
+        switch (counter) {
+            case PerformanceCounter::ticks:
+                return static_cast<int64_t>(ticks_);
+            case PerformanceCounter::retired:
+                return static_cast<int64_t>(t.retired);
+            case PerformanceCounter::mispredicts:
+                return static_cast<int64_t>(t.mispredicts);
+            case PerformanceCounter::ramStalls:
+                return static_cast<int64_t>(t.ramStalls);
+        }
+        throw std::runtime_error("Unhandled performance counter");
+    }
+
     bool Cpu::halted() const {
-        return halted_;
+        return std::all_of(threads_.begin(), threads_.end(), [](const Thread& thread) {
+            return thread.halted;
+        });
+    }
+
+    void Cpu::halt(std::size_t thread) {
+        threads_.at(thread).halted = true;
+        StatsLogger::instance().logThreadHalt(thread);
+        if (halted()) {
+            io_.flush();
+        }
     }
 
-    void Cpu::halt() {
-        halted_ = true;
+    void Cpu::observeLoad(std::size_t thread, uint64_t pc, uint64_t address) {
+        // Same tagging as in the instruction cache
+        prefetcher_->observe((static_cast<uint64_t>(thread) << 40) | pc, threads_[thread].memoryOffset + address);
     }
 
-    std::optional<uint64_t> Cpu::readMemory(uint64_t address, MemoryWrite::Id maxId) {
-        if (writesManager_.hasUnspecifiedWrites(maxId)) {
+    std::optional<int64_t> Cpu::predictValue(std::size_t thread, uint64_t pc, std::size_t olderInFlight) const {
+        return threads_[thread].valuePredictor->predict(pc, olderInFlight);
+    }
+
+    void Cpu::trainValuePredictor(std::size_t thread, uint64_t pc, int64_t value) {
+        threads_[thread].valuePredictor->train(pc, value);
+    }
+
+    void Cpu::distrustValuePrediction(std::size_t thread, uint64_t pc) {
+        threads_[thread].valuePredictor->distrust(pc);
+    }
+
+    void Cpu::issuePrefetches() {
+        while (prefetcher_->hasCandidate() && !ram_.isBusy()) {
+            // Candidates which can't be prefetched (pending, out of memory) are just dropped
+            ram_.prefetch(prefetcher_->nextCandidate());
+            prefetcher_->popCandidate();
+        }
+    }
+
+    std::optional<uint64_t> Cpu::readMemory(std::size_t thread, uint64_t address, MemoryWrite::Id maxId) {
+        const Thread& t = threads_[thread];
+        if (t.writesManager.hasUnspecifiedWrites(maxId)) {
             return std::nullopt;
         }
-        auto optWrite = writesManager_.previousWrite(address, maxId);
+        auto optWrite = t.writesManager.previousWrite(address, maxId);
         if (optWrite) {
             // There is a previous write
             if (optWrite->hasValue()) {
@@ -152,45 +424,82 @@ namespace tiny::t86 {
             return std::nullopt;
         }
         // We need to read it from mem
-        return ram_.read(address);
+        if (dataCache_) {
+            if (!dataCache_->read(t.memoryOffset + address)) {
+                return std::nullopt;
+            }
+            return ram_.get(t.memoryOffset + address);
+        }
+        return ram_.read(t.memoryOffset + address);
+    }
+
+    void Cpu::writeMemory(std::size_t thread, MemoryWrite::Id id) {
+        if (dataCache_) {
+            threads_[thread].writesManager.startWriting(id, *dataCache_, threads_[thread].memoryOffset);
+        } else {
+            threads_[thread].writesManager.startWriting(id, ram_, threads_[thread].memoryOffset);
+        }
+    }
+
+    bool Cpu::acquireLine(std::size_t thread, uint64_t address) {
+        if (!dataCache_) {
+            // Single core, the RAM itself is the point of coherence
+            return true;
+        }
+        uint64_t physical = threads_[thread].memoryOffset + address;
+        if (!dataCache_->own(physical)) {
+            return false;
+        }
+        dataCache_->lock(physical);
+        return true;
     }
 
-    void Cpu::writeMemory(MemoryWrite::Id id) {
-        writesManager_.startWriting(id, ram_);
+    int64_t Cpu::loadAtomic(std::size_t thread, uint64_t address) const {
+        return ram_.get(threads_[thread].memoryOffset + address);
+    }
+
+    void Cpu::storeAtomic(std::size_t thread, uint64_t address, int64_t value) {
+        ram_.set(threads_[thread].memoryOffset + address, value);
+        if (dataCache_) {
+            dataCache_->unlock();
+        }
     }
 
     uint64_t Cpu::getMemory(uint64_t address) const {
-        return ram_.get(address);
+        return ram_.get(threads_.at(debugThread_).memoryOffset + address);
     }
 
     void Cpu::setMemory(uint64_t address, uint64_t value) {
-        ram_.set(address, value);
+        ram_.set(threads_.at(debugThread_).memoryOffset + address, value);
     }
 
     void Cpu::jump(const ReservationStation::Entry& entry, bool taken) {
         uint64_t destination = entry.getUpdatedProgramCounter();
         if (taken) {
-            registerBranchTaken(entry.getRegister(Register::ProgramCounter()), destination);
+            registerBranchTaken(entry.thread(), entry.getRegister(Register::ProgramCounter()), destination);
         } else {
-            registerBranchNotTaken(entry.getRegister(Register::ProgramCounter()));
+            registerBranchNotTaken(entry.thread(), entry.getRegister(Register::ProgramCounter()));
         }
         checkBranchPrediction(entry, destination);
     }
 
-    void Cpu::registerBranchTaken(uint64_t sourcePc, uint64_t destination) {
-        branchPredictor_->registerBranchTaken(sourcePc, destination);
+    void Cpu::registerBranchTaken(std::size_t thread, uint64_t sourcePc, uint64_t destination) {
+        threads_[thread].branchPredictor->registerBranchTaken(sourcePc, destination);
     }
 
-    void Cpu::registerBranchNotTaken(uint64_t sourcePc) {
-        branchPredictor_->registerBranchNotTaken(sourcePc);
+    void Cpu::registerBranchNotTaken(std::size_t thread, uint64_t sourcePc) {
+        threads_[thread].branchPredictor->registerBranchNotTaken(sourcePc);
     }
 
     void Cpu::checkBranchPrediction(const ReservationStation::Entry& entry, uint64_t destination) {
-        assert(!predictions_.empty());
-        std::size_t predictedDestination = predictions_.front();
-        predictions_.pop_front();
+        auto& predictions = threads_[entry.thread()].predictions;
+        assert(!predictions.empty());
+        std::size_t predictedDestination = predictions.front();
+        predictions.pop_front();
         if (predictedDestination != destination) {
-            unrollSpeculation(entry.rat());
+            entry.logMispredict();
+            ++threads_[entry.thread()].mispredicts;
+            unrollSpeculation(entry.thread(), entry.rat());
         }
     }
 
@@ -208,13 +517,45 @@ namespace tiny::t86 {
     }
 
     void Cpu::doBreak() {
+        // Output of the handler follows the one of the program
+        io_.flush();
         if (breakHandler_) {
             breakHandler_(*this);
         }
     }
 
-    const RegisterAllocationTable& Cpu::getRat() const {
-        return rat_;
+    void Cpu::connectTraceWriter(TraceWriter* writer) {
+        traceWriter_ = writer;
+    }
+
+    void Cpu::traceRetirement(const ReservationStation::Entry& entry) {
+        assert(tracing());
+        // The trace is replayed against single program, the one of the first thread
+        if (entry.thread() != 0) {
+            return;
+        }
+        traceRecord_.clear();
+        traceRecord_.pc = entry.pc();
+        traceRecord_.memoryReads = entry.memoryReads();
+        for (MemoryWrite::Id id : entry.memoryWriteIds()) {
+            traceRecord_.memoryWrites.push_back(getWrite(entry.thread(), id).address());
+        }
+        if (entry.branchTaken()) {
+            if (*entry.branchTaken()) {
+                traceRecord_.branch = TraceRecord::Branch::taken;
+                traceRecord_.target = entry.getUpdatedProgramCounter();
+            } else {
+                traceRecord_.branch = TraceRecord::Branch::notTaken;
+                traceRecord_.target = traceRecord_.pc + 1;
+            }
+        } else {
+            traceRecord_.target = traceRecord_.pc + 1;
+        }
+        traceWriter_->write(traceRecord_);
+    }
+
+    const RegisterAllocationTable& Cpu::getRat(std::size_t thread) const {
+        return threads_[thread].rat;
     }
 
     void Cpu::subscribeRegisterRead(PhysicalRegister reg) {
@@ -226,75 +567,93 @@ namespace tiny::t86 {
         --(registers_.at(reg.index()).subscribedReads);
     }
 
-    void Cpu::renameRegister(Register reg) {
+    void Cpu::renameRegister(std::size_t thread, Register reg) {
         PhysicalRegister dest = nextFreeRegister();
-        rat_.rename(reg, dest);
+        threads_[thread].rat.rename(reg, dest);
         registers_.at(dest.index()).ready = false;
     }
 
-    void Cpu::renameFloatRegister(FloatRegister fReg) {
+    void Cpu::renameFloatRegister(std::size_t thread, FloatRegister fReg) {
         PhysicalRegister dest = nextFreeRegister();
-        rat_.rename(fReg, dest);
+        threads_[thread].rat.rename(fReg, dest);
+        registers_.at(dest.index()).ready = false;
+    }
+
+    void Cpu::renameVectorRegister(std::size_t thread, VectorRegister vReg) {
+        PhysicalRegister dest = nextFreeRegister();
+        threads_[thread].rat.rename(vReg, dest);
         registers_.at(dest.index()).ready = false;
     }
 
     PhysicalRegister Cpu::nextFreeRegister() const {
         for (std::size_t i = 0; i < physicalRegisterCnt_; ++i) {
-            if (rat_.isUnmapped(PhysicalRegister{i}) && registers_.at(i).subscribedReads == 0) {
+            if (registers_.at(i).subscribedReads == 0
+                    && std::all_of(threads_.begin(), threads_.end(), [i](const Thread& thread) {
+                        return thread.rat.isUnmapped(PhysicalRegister{i});
+                    })) {
                 return i;
             }
         }
         throw std::runtime_error("No free register was found, either bug in RAT or small scale for physical registers");
     }
 
-    void Cpu::flushPipeline() {
+    void Cpu::flushPipeline(std::size_t thread) {
         // Unroll speculation
-        reservationStation_.clear();
-        predictions_.clear();
-        if (instructionFetch_) {
-            StatsLogger::instance().logClearSpeculation(instructionFetch_->loggingId);
-            instructionFetch_ = std::nullopt;
-        }
-        if (instructionDecode_) {
-            StatsLogger::instance().logClearSpeculation(instructionDecode_->loggingId);
-            instructionDecode_ = std::nullopt;
+        reservationStation_.clear(thread);
+        threads_[thread].predictions.clear();
+        for (auto& stage : frontend_) {
+            if (stage && stage->thread == thread) {
+                StatsLogger::instance().logClearSpeculation(stage->loggingId);
+                stage = std::nullopt;
+            }
         }
     }
 
-    void Cpu::unrollSpeculation(const RegisterAllocationTable& rat) {
-        flushPipeline();
+    void Cpu::unrollSpeculation(std::size_t thread, const RegisterAllocationTable& rat) {
+        flushPipeline(thread);
+        Thread& t = threads_[thread];
         // Restore rat
-        rat_ = rat;
+        t.rat = rat;
 
         // Set correct PC
-        speculativeProgramCounter_ = getRegister(Register::ProgramCounter());
+        t.speculativeProgramCounter = getRegister(t.rat.translate(Register::ProgramCounter()));
+        redirectLoopBuffer(thread);
 
         // Remove pending writes
-        writesManager_.removePending();
+        t.writesManager.removePending();
+    }
+
+    void Cpu::replay(std::size_t thread, const RegisterAllocationTable& rat, uint64_t pc) {
+        unrollSpeculation(thread, rat);
+        threads_[thread].speculativeProgramCounter = pc;
+        redirectLoopBuffer(thread);
     }
 
     Cpu::Cpu() : Cpu(Cpu::Config::instance().registerCnt(),
+                     Cpu::Config::instance().floatRegisterCnt(),
                      Cpu::Config::instance().aluCnt(),
-                     Cpu::Config::instance().reservationStationEntriesCnt()) {}
+                     Cpu::Config::instance().reservationStationEntriesCnt(),
+                     Cpu::Config::instance().ramSize(),
+                     Cpu::Config::instance().ramGatesCount()) {}
 
-    MemoryWrite::Id Cpu::registerPendingWrite(Memory::Immediate mem) {
-        return writesManager_.registerPendingWrite(mem.index());
+    MemoryWrite::Id Cpu::registerPendingWrite(std::size_t thread, Memory::Immediate mem) {
+        return threads_[thread].writesManager.registerPendingWrite(mem.index());
     }
 
-    MemoryWrite::Id Cpu::registerPendingWrite() {
-        return writesManager_.registerPendingWrite();
+    MemoryWrite::Id Cpu::registerPendingWrite(std::size_t thread) {
+        return threads_[thread].writesManager.registerPendingWrite();
     }
 
-    MemoryWrite& Cpu::getWrite(MemoryWrite::Id id) const {
-        return writesManager_.getWrite(id);
+    MemoryWrite& Cpu::getWrite(std::size_t thread, MemoryWrite::Id id) const {
+        return threads_[thread].writesManager.getWrite(id);
     }
 
-    MemoryWrite::Id Cpu::currentMaxWriteId() const {
-        return writesManager_.currentMaxWriteId();
+    MemoryWrite::Id Cpu::currentMaxWriteId(std::size_t thread) const {
+        return threads_[thread].writesManager.currentMaxWriteId();
     }
 
-    void Cpu::specifyWriteAddress(MemoryWrite::Id id, uint64_t value) {
-        writesManager_.specifyAddress(id, value);
+    void Cpu::specifyWriteAddress(std::size_t thread, MemoryWrite::Id id, uint64_t value) {
+        threads_[thread].writesManager.specifyAddress(id, value);
     }
 
     std::size_t Cpu::Config::registerCnt() const {
@@ -321,9 +680,133 @@ namespace tiny::t86 {
         return std::stoul(config.get(ramGatesCountConfigString));
     }
 
+    std::size_t Cpu::Config::instructionCacheSize() const {
+        return std::stoul(config.get(instructionCacheSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::instructionCacheAssociativity() const {
+        return std::stoul(config.get(instructionCacheAssociativityConfigString));
+    }
+
+    std::size_t Cpu::Config::instructionCacheLineSize() const {
+        return std::stoul(config.get(instructionCacheLineSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::frontendStages() const {
+        std::size_t stages = std::stoul(config.get(frontendStagesConfigString));
+        if (stages == 0) {
+            throw std::invalid_argument("Frontend needs at least one stage");
+        }
+        return stages;
+    }
+
+    std::size_t Cpu::Config::renameLatency() const {
+        return std::stoul(config.get(renameLatencyConfigString));
+    }
+
+    std::size_t Cpu::Config::loopBufferSize() const {
+        return std::stoul(config.get(loopBufferSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::instructionCacheMissLatency() const {
+        return std::stoul(config.get(instructionCacheMissLatencyConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchTableSize() const {
+        return std::stoul(config.get(prefetchTableSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchDistance() const {
+        return std::stoul(config.get(prefetchDistanceConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchDegree() const {
+        return std::stoul(config.get(prefetchDegreeConfigString));
+    }
+
+    std::size_t Cpu::Config::prefetchBufferSize() const {
+        return std::stoul(config.get(prefetchBufferSizeConfigString));
+    }
+
+    std::optional<DramTiming::Config> Cpu::Config::dramTiming() const {
+        std::size_t banks = std::stoul(config.get(dramBanksConfigString));
+        if (banks == 0) {
+            return std::nullopt;
+        }
+        return DramTiming::Config{
+                banks,
+                std::stoul(config.get(dramRowSizeConfigString)),
+                std::stoul(config.get(dramCasConfigString)),
+                std::stoul(config.get(dramRcdConfigString)),
+                std::stoul(config.get(dramRpConfigString)),
+                DramTiming::Config::parseMapping(config.get(dramMappingConfigString))
+        };
+    }
+
+    std::size_t Cpu::Config::smtThreads() const {
+        return std::stoul(config.get(smtThreadsConfigString));
+    }
+
+    Cpu::FetchPolicy Cpu::Config::smtFetchPolicy() const {
+        const std::string& name = config.get(smtFetchPolicyConfigString);
+        if (name == "roundRobin") {
+            return FetchPolicy::roundRobin;
+        }
+        if (name == "icount") {
+            return FetchPolicy::icount;
+        }
+        throw std::invalid_argument("Unknown SMT fetch policy " + name + ", expected roundRobin or icount");
+    }
+
+    std::size_t Cpu::Config::dataCacheSize() const {
+        return std::stoul(config.get(dataCacheSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::dataCacheAssociativity() const {
+        return std::stoul(config.get(dataCacheAssociativityConfigString));
+    }
+
+    std::size_t Cpu::Config::dataCacheLineSize() const {
+        return std::stoul(config.get(dataCacheLineSizeConfigString));
+    }
+
+    CoherenceBus::Protocol Cpu::Config::coherenceProtocol() const {
+        return CoherenceBus::parseProtocol(config.get(coherenceProtocolConfigString));
+    }
+
+    std::size_t Cpu::Config::coherenceLatency() const {
+        return std::stoul(config.get(coherenceLatencyConfigString));
+    }
+
+    std::size_t Cpu::Config::coreStackSize() const {
+        return std::stoul(config.get(coreStackSizeConfigString));
+    }
+
+    std::size_t Cpu::Config::vectorRegisterCnt() const {
+        return std::stoul(config.get(vectorRegisterCountConfigString));
+    }
+
+    std::size_t Cpu::Config::vectorUnitCnt() const {
+        return std::stoul(config.get(vectorUnitCountConfigString));
+    }
+
+    std::size_t Cpu::Config::valuePredictorSize() const {
+        return std::stoul(config.get(valuePredictorSizeConfigString));
+    }
+
     std::size_t Cpu::Config::getExecutionLength(const Instruction* ins) const {
         static std::map<Instruction::Signature, std::size_t> lengths = {
             { { Instruction::Type::MOV, { Operand::Type::Reg, Operand::Type::Imm } }, 2 },
+            { { Instruction::Type::VMUL, { Operand::Type::VReg, Operand::Type::VReg } }, 5 },
+            { { Instruction::Type::VFADD, { Operand::Type::VReg, Operand::Type::VReg } }, 4 },
+            { { Instruction::Type::VFMUL, { Operand::Type::VReg, Operand::Type::VReg } }, 6 },
+            { { Instruction::Type::VBROADCAST, { Operand::Type::VReg, Operand::Type::Reg } }, 2 },
+            { { Instruction::Type::VBROADCAST, { Operand::Type::VReg, Operand::Type::FReg } }, 2 },
+            { { Instruction::Type::VBROADCAST, { Operand::Type::VReg, Operand::Type::Imm } }, 2 },
+            { { Instruction::Type::VBROADCAST, { Operand::Type::VReg, Operand::Type::FImm } }, 2 },
+            // Reductions add the lanes as a tree
+            { { Instruction::Type::VREDUCE, { Operand::Type::Reg, Operand::Type::VReg } }, 4 },
+            { { Instruction::Type::VFREDUCE, { Operand::Type::FReg, Operand::Type::VReg } }, 6 },
         };
 
         if (auto it = lengths.find(ins->getSignature()); it != lengths.end()) {
@@ -352,5 +835,61 @@ namespace tiny::t86 {
                                    std::to_string(Config::defaultRamSize));
         config.setDefaultIfMissing(Config::ramGatesCountConfigString,
                                    std::to_string(Config::defaultRamGatesCount));
+        config.setDefaultIfMissing(Config::instructionCacheSizeConfigString,
+                                   std::to_string(Config::defaultInstructionCacheSize));
+        config.setDefaultIfMissing(Config::instructionCacheAssociativityConfigString,
+                                   std::to_string(Config::defaultInstructionCacheAssociativity));
+        config.setDefaultIfMissing(Config::instructionCacheLineSizeConfigString,
+                                   std::to_string(Config::defaultInstructionCacheLineSize));
+        config.setDefaultIfMissing(Config::instructionCacheMissLatencyConfigString,
+                                   std::to_string(Config::defaultInstructionCacheMissLatency));
+        config.setDefaultIfMissing(Config::frontendStagesConfigString,
+                                   std::to_string(Config::defaultFrontendStages));
+        config.setDefaultIfMissing(Config::renameLatencyConfigString,
+                                   std::to_string(Config::defaultRenameLatency));
+        config.setDefaultIfMissing(Config::loopBufferSizeConfigString,
+                                   std::to_string(Config::defaultLoopBufferSize));
+        config.setDefaultIfMissing(Config::prefetchTableSizeConfigString,
+                                   std::to_string(Config::defaultPrefetchTableSize));
+        config.setDefaultIfMissing(Config::prefetchDistanceConfigString,
+                                   std::to_string(Config::defaultPrefetchDistance));
+        config.setDefaultIfMissing(Config::prefetchDegreeConfigString,
+                                   std::to_string(Config::defaultPrefetchDegree));
+        config.setDefaultIfMissing(Config::prefetchBufferSizeConfigString,
+                                   std::to_string(Config::defaultPrefetchBufferSize));
+        config.setDefaultIfMissing(Config::dramBanksConfigString,
+                                   std::to_string(Config::defaultDramBanks));
+        config.setDefaultIfMissing(Config::dramRowSizeConfigString,
+                                   std::to_string(Config::defaultDramRowSize));
+        config.setDefaultIfMissing(Config::dramMappingConfigString,
+                                   Config::defaultDramMapping);
+        config.setDefaultIfMissing(Config::dramCasConfigString,
+                                   std::to_string(Config::defaultDramCas));
+        config.setDefaultIfMissing(Config::dramRcdConfigString,
+                                   std::to_string(Config::defaultDramRcd));
+        config.setDefaultIfMissing(Config::dramRpConfigString,
+                                   std::to_string(Config::defaultDramRp));
+        config.setDefaultIfMissing(Config::vectorRegisterCountConfigString,
+                                   std::to_string(Config::defaultVectorRegisterCount));
+        config.setDefaultIfMissing(Config::vectorUnitCountConfigString,
+                                   std::to_string(Config::defaultVectorUnitCount));
+        config.setDefaultIfMissing(Config::valuePredictorSizeConfigString,
+                                   std::to_string(Config::defaultValuePredictorSize));
+        config.setDefaultIfMissing(Config::smtThreadsConfigString,
+                                   std::to_string(Config::defaultSmtThreads));
+        config.setDefaultIfMissing(Config::smtFetchPolicyConfigString,
+                                   Config::defaultSmtFetchPolicy);
+        config.setDefaultIfMissing(Config::dataCacheSizeConfigString,
+                                   std::to_string(Config::defaultDataCacheSize));
+        config.setDefaultIfMissing(Config::dataCacheAssociativityConfigString,
+                                   std::to_string(Config::defaultDataCacheAssociativity));
+        config.setDefaultIfMissing(Config::dataCacheLineSizeConfigString,
+                                   std::to_string(Config::defaultDataCacheLineSize));
+        config.setDefaultIfMissing(Config::coherenceProtocolConfigString,
+                                   Config::defaultCoherenceProtocol);
+        config.setDefaultIfMissing(Config::coherenceLatencyConfigString,
+                                   std::to_string(Config::defaultCoherenceLatency));
+        config.setDefaultIfMissing(Config::coreStackSizeConfigString,
+                                   std::to_string(Config::defaultCoreStackSize));
     }
 }
\ No newline at end of file
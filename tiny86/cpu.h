@@ -3,11 +3,19 @@
 #include "program.h"
 #include "instruction.h"
 #include "ram.h"
+#include "io_channel.h"
 #include "cpu/register.h"
 #include "cpu/reservation_station.h"
 #include "cpu/register_allocation_table.h"
 #include "cpu/branchpredictor.h"
 #include "cpu/memory_writes_manager.h"
+#include "cpu/instruction_cache.h"
+#include "cpu/loop_buffer.h"
+#include "cpu/stride_prefetcher.h"
+#include "cpu/value_predictor.h"
+#include "cpu/coherent_cache.h"
+#include "cpu/coherence_bus.h"
+#include "trace/trace_writer.h"
 
 #include <vector>
 #include <list>
@@ -22,6 +30,11 @@
 namespace tiny::t86 {   
     class Cpu {
     public:
+        // Which thread fetches when there are more of them
+        enum class FetchPolicy {
+            roundRobin, icount
+        };
+
         class Config {
         public:
             static Config& instance();
@@ -50,6 +63,144 @@ namespace tiny::t86 {
 
             constexpr static std::size_t defaultRamGatesCount = 4;
 
+            // Size of the instruction cache in instructions, 0 disables the cache (every fetch hits)
+            constexpr static const char* instructionCacheSizeConfigString = "-icacheSize";
+
+            constexpr static std::size_t defaultInstructionCacheSize = 0;
+
+            constexpr static const char* instructionCacheAssociativityConfigString = "-icacheAssociativity";
+
+            constexpr static std::size_t defaultInstructionCacheAssociativity = 2;
+
+            // In instructions
+            constexpr static const char* instructionCacheLineSizeConfigString = "-icacheLineSize";
+
+            constexpr static std::size_t defaultInstructionCacheLineSize = 4;
+
+            constexpr static const char* instructionCacheMissLatencyConfigString = "-icacheMissLatency";
+
+            constexpr static std::size_t defaultInstructionCacheMissLatency = 10;
+
+            // Stages from fetch to dispatch, the first one fetches and the others decode
+            constexpr static const char* frontendStagesConfigString = "-frontendStages";
+
+            constexpr static std::size_t defaultFrontendStages = 2;
+
+            // Extra stages renaming registers between the decode and the dispatch
+            constexpr static const char* renameLatencyConfigString = "-renameLatency";
+
+            constexpr static std::size_t defaultRenameLatency = 0;
+
+            // Instructions of a loop the loop buffer can hold, 0 disables it, used only with one hardware thread
+            constexpr static const char* loopBufferSizeConfigString = "-loopBufferSize";
+
+            constexpr static std::size_t defaultLoopBufferSize = 0;
+
+            // Entries of the stride prefetcher table, 0 disables the prefetcher
+            constexpr static const char* prefetchTableSizeConfigString = "-prefetchTableSize";
+
+            constexpr static std::size_t defaultPrefetchTableSize = 0;
+
+            // How many strides ahead is prefetched
+            constexpr static const char* prefetchDistanceConfigString = "-prefetchDistance";
+
+            constexpr static std::size_t defaultPrefetchDistance = 1;
+
+            // How many consecutive strides are prefetched at once
+            constexpr static const char* prefetchDegreeConfigString = "-prefetchDegree";
+
+            constexpr static std::size_t defaultPrefetchDegree = 1;
+
+            // Finished prefetches kept by the RAM
+            constexpr static const char* prefetchBufferSizeConfigString = "-prefetchBufferSize";
+
+            constexpr static std::size_t defaultPrefetchBufferSize = 8;
+
+            // Count of DRAM banks, 0 keeps the flat RAM latency
+            constexpr static const char* dramBanksConfigString = "-dramBanks";
+
+            constexpr static std::size_t defaultDramBanks = 0;
+
+            // In words
+            constexpr static const char* dramRowSizeConfigString = "-dramRowSize";
+
+            constexpr static std::size_t defaultDramRowSize = 64;
+
+            // RoBaCo (consecutive addresses share a row) or RoCoBa (consecutive addresses interleave banks)
+            constexpr static const char* dramMappingConfigString = "-dramMapping";
+
+            constexpr static const char* defaultDramMapping = "RoBaCo";
+
+            // Column access, paid by every access
+            constexpr static const char* dramCasConfigString = "-dramCas";
+
+            constexpr static std::size_t defaultDramCas = 2;
+
+            // Row activation, paid when the bank has no open row
+            constexpr static const char* dramRcdConfigString = "-dramRcd";
+
+            constexpr static std::size_t defaultDramRcd = 3;
+
+            // Precharge, paid when other row is open
+            constexpr static const char* dramRpConfigString = "-dramRp";
+
+            constexpr static std::size_t defaultDramRp = 3;
+
+            // Hardware threads (contexts) sharing the core, RAM is split evenly among them
+            constexpr static const char* smtThreadsConfigString = "-smtThreads";
+
+            constexpr static std::size_t defaultSmtThreads = 1;
+
+            // roundRobin or icount (thread with the fewest instructions in flight fetches)
+            constexpr static const char* smtFetchPolicyConfigString = "-smtFetchPolicy";
+
+            constexpr static const char* defaultSmtFetchPolicy = "roundRobin";
+
+            // Private data cache of every core in a System, in words
+            constexpr static const char* dataCacheSizeConfigString = "-dcacheSize";
+
+            constexpr static std::size_t defaultDataCacheSize = 64;
+
+            constexpr static const char* dataCacheAssociativityConfigString = "-dcacheAssociativity";
+
+            constexpr static std::size_t defaultDataCacheAssociativity = 2;
+
+            // In words
+            constexpr static const char* dataCacheLineSizeConfigString = "-dcacheLineSize";
+
+            constexpr static std::size_t defaultDataCacheLineSize = 4;
+
+            // MSI or MESI
+            constexpr static const char* coherenceProtocolConfigString = "-coherenceProtocol";
+
+            constexpr static const char* defaultCoherenceProtocol = "MESI";
+
+            // Ticks of a cache to cache transfer on the coherence bus
+            constexpr static const char* coherenceLatencyConfigString = "-coherenceLatency";
+
+            constexpr static std::size_t defaultCoherenceLatency = 4;
+
+            // Stacks of the cores in a System are placed below each other from the end of the RAM,
+            // 0 splits the RAM above the globals evenly among the cores
+            constexpr static const char* coreStackSizeConfigString = "-coreStackSize";
+
+            constexpr static std::size_t defaultCoreStackSize = 0;
+
+            // Vector registers of every hardware thread, each holds VectorRegister::lanes words
+            constexpr static const char* vectorRegisterCountConfigString = "-vectorRegisterCnt";
+
+            constexpr static std::size_t defaultVectorRegisterCount = 4;
+
+            // Units executing vector arithmetic, broadcasts and reductions, loads and stores do not need one
+            constexpr static const char* vectorUnitCountConfigString = "-vectorUnitCnt";
+
+            constexpr static std::size_t defaultVectorUnitCount = 1;
+
+            // Entries of the load value predictor table, 0 disables the predictor
+            constexpr static const char* valuePredictorSizeConfigString = "-valuePredictorSize";
+
+            constexpr static std::size_t defaultValuePredictorSize = 0;
+
             std::size_t registerCnt() const;
 
             std::size_t floatRegisterCnt() const;
@@ -62,6 +213,56 @@ namespace tiny::t86 {
 
             std::size_t ramGatesCount() const;
 
+            std::size_t instructionCacheSize() const;
+
+            std::size_t instructionCacheAssociativity() const;
+
+            std::size_t instructionCacheLineSize() const;
+
+            std::size_t instructionCacheMissLatency() const;
+
+            // Throws std::invalid_argument for no stages
+            std::size_t frontendStages() const;
+
+            std::size_t renameLatency() const;
+
+            std::size_t loopBufferSize() const;
+
+            std::size_t prefetchTableSize() const;
+
+            std::size_t prefetchDistance() const;
+
+            std::size_t prefetchDegree() const;
+
+            std::size_t prefetchBufferSize() const;
+
+            // Empty without DRAM timing
+            std::optional<DramTiming::Config> dramTiming() const;
+
+            std::size_t smtThreads() const;
+
+            // Throws std::invalid_argument for unknown policy
+            FetchPolicy smtFetchPolicy() const;
+
+            std::size_t dataCacheSize() const;
+
+            std::size_t dataCacheAssociativity() const;
+
+            std::size_t dataCacheLineSize() const;
+
+            // Throws std::invalid_argument for unknown protocol
+            CoherenceBus::Protocol coherenceProtocol() const;
+
+            std::size_t coherenceLatency() const;
+
+            std::size_t coreStackSize() const;
+
+            std::size_t vectorRegisterCnt() const;
+
+            std::size_t vectorUnitCnt() const;
+
+            std::size_t valuePredictorSize() const;
+
             std::size_t getExecutionLength(const Instruction* ins) const;
 
         private:
@@ -71,8 +272,8 @@ namespace tiny::t86 {
         // Max instruction operands - for example ADD R1 R2 has 3 (destination and 2 source)
         static constexpr std::size_t maxInstructionOperands = 3;
 
-        // These are Pc, Sp, Bp and Flags
-        static constexpr std::size_t specialRegistersCnt = 4;
+        // These are Pc, Sp, Bp, Flags and CoreId
+        static constexpr std::size_t specialRegistersCnt = 5;
 
         // This is how many renamed registers can be in use translate once for once instruction
         //  (it is quite generous, usually around 3 will be used translate once)
@@ -84,6 +285,9 @@ namespace tiny::t86 {
 
         Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount, std::size_t ramSize, std::size_t ramGatesCnt);
 
+        // Core of a System, memory is accessed through the data cache, the RAM is ticked by the owner
+        Cpu(RAM& ram, CoherentCache& dataCache, IOChannel& io, std::size_t coreId);
+
         // These do not include special registers
         std::size_t registersCount() const {
             return registerCnt_;
@@ -93,11 +297,34 @@ namespace tiny::t86 {
             return physicalRegisterCnt_;
         }
 
+        // Console of PUTCHAR and GETCHAR, shared by the cores of a System
+        IOChannel& io() {
+            return io_;
+        }
+
         void connectBreakHandler(std::function<void(Cpu&)> handler);
 
         void doBreak();
 
-        void start(Program&& program);
+        // Every retired instruction will be written into the trace, nullptr stops the tracing
+        void connectTraceWriter(TraceWriter* writer);
+
+        bool tracing() const {
+            return traceWriter_ != nullptr;
+        }
+
+        void traceRetirement(const ReservationStation::Entry& entry);
+
+        std::size_t threadsCount() const {
+            return threads_.size();
+        }
+
+        // Threads which were not given a program stay halted
+        void start(Program&& program, std::size_t thread = 0);
+
+        const Program& program(std::size_t thread = 0) const {
+            return threads_.at(thread).program;
+        }
 
         void tick();
 
@@ -107,56 +334,145 @@ namespace tiny::t86 {
 
         double getFloatRegister(PhysicalRegister reg) const;
 
+        const VectorRegister::Value& getVectorRegister(PhysicalRegister reg) const;
+
         void setRegister(PhysicalRegister reg, int64_t value);
 
         void setRegister(PhysicalRegister reg, double value);
 
-        MemoryWrite::Id currentMaxWriteId() const;
+        void setRegister(PhysicalRegister reg, const VectorRegister::Value& value);
+
+        MemoryWrite::Id currentMaxWriteId(std::size_t thread) const;
+
+        std::optional<uint64_t> readMemory(std::size_t thread, uint64_t address, MemoryWrite::Id maxId);
+
+        bool prefetching() const {
+            return prefetcher_.has_value();
+        }
+
+        // Trains the prefetcher with address the load at pc asked for
+        void observeLoad(std::size_t thread, uint64_t pc, uint64_t address);
+
+        bool predictingValues() const {
+            return threads_.front().valuePredictor.has_value();
+        }
+
+        // Value for the load at pc still waiting for the RAM, empty when the predictor is not confident
+        std::optional<int64_t> predictValue(std::size_t thread, uint64_t pc, std::size_t olderInFlight) const;
+
+        // Called with the loaded value of every retired load, in program order
+        void trainValuePredictor(std::size_t thread, uint64_t pc, int64_t value);
+
+        // The load at pc was mispredicted, it is not predicted until its stride repeats again
+        void distrustValuePrediction(std::size_t thread, uint64_t pc);
+
+        MemoryWrite& getWrite(std::size_t thread, MemoryWrite::Id id) const;
+
+        void writeMemory(std::size_t thread, MemoryWrite::Id id);
+
+        // All writes of the thread are finished
+        bool writesDrained(std::size_t thread) const {
+            return threads_[thread].writesManager.empty();
+        }
+
+        // True when no other core can access the address until storeAtomic, the line is requested otherwise
+        bool acquireLine(std::size_t thread, uint64_t address);
+
+        int64_t loadAtomic(std::size_t thread, uint64_t address) const;
+
+        void storeAtomic(std::size_t thread, uint64_t address, int64_t value);
 
-        std::optional<uint64_t> readMemory(uint64_t address, MemoryWrite::Id maxId);
+        std::size_t coreId() const {
+            return coreId_;
+        }
+
+        // Stack of the core spans [limit, top), stack pointer and base pointer are set to top.
+        // Used by System, so the stacks of its cores do not overlap
+        void setStack(std::size_t top, std::size_t limit);
+
+        // Throws std::runtime_error when the stack pointer left by the retired entry is outside of the stack
+        void checkStack(const ReservationStation::Entry& entry) const;
+
+        // Counters read by RDPMC, ticks are counted for the whole core, the others per thread
+        enum class PerformanceCounter {
+            ticks,
+            retired,
+            mispredicts,
+            // Ticks spent by instructions waiting for memory reads, summed over the waiting instructions
+            ramStalls,
+        };
 
-        MemoryWrite& getWrite(MemoryWrite::Id id) const;
+        static constexpr std::size_t performanceCountersCnt = 4;
 
-        void writeMemory(MemoryWrite::Id id);
+        int64_t performanceCounter(std::size_t thread, PerformanceCounter counter) const;
 
+        void countRetirement(std::size_t thread) {
+            ++threads_[thread].retired;
+        }
+
+        void countRamStall(std::size_t thread) {
+            ++threads_[thread].ramStalls;
+        }
+
+        // All threads halted
         bool halted() const;
 
-        void halt();
+        bool halted(std::size_t thread) const {
+            return threads_.at(thread).halted;
+        }
+
+        void halt(std::size_t thread);
 
         bool registerReady(PhysicalRegister reg) const;
 
         void setReady(PhysicalRegister reg);
 
-        void renameRegister(Register reg);
+        void renameRegister(std::size_t thread, Register reg);
+
+        void renameFloatRegister(std::size_t thread, FloatRegister fReg);
 
-        void renameFloatRegister(FloatRegister fReg);
+        void renameVectorRegister(std::size_t thread, VectorRegister vReg);
 
-        const RegisterAllocationTable& getRat() const;
+        const RegisterAllocationTable& getRat(std::size_t thread) const;
 
         void subscribeRegisterRead(PhysicalRegister reg);
 
         void unsubscribeRegisterRead(PhysicalRegister reg);
 
-        MemoryWrite::Id registerPendingWrite(Memory::Immediate mem);
+        MemoryWrite::Id registerPendingWrite(std::size_t thread, Memory::Immediate mem);
+
+        MemoryWrite::Id registerPendingWrite(std::size_t thread);
 
-        MemoryWrite::Id registerPendingWrite();
+        void specifyWriteAddress(std::size_t thread, MemoryWrite::Id id, uint64_t value);
 
-        void specifyWriteAddress(MemoryWrite::Id id, uint64_t value);
+        void unrollSpeculation(std::size_t thread, const RegisterAllocationTable& rat);
 
-        void unrollSpeculation(const RegisterAllocationTable& rat);
+        // Unrolls speculation and fetches again from pc, the instruction there is executed once more
+        void replay(std::size_t thread, const RegisterAllocationTable& rat, uint64_t pc);
 
-        void flushPipeline();
+        // Throws away instructions of the thread from the whole pipeline
+        void flushPipeline(std::size_t thread);
+
+        // Following debug functions work with this thread, set for DBG and BREAK to the thread which executed them
+        void selectDebugThread(std::size_t thread) {
+            debugThread_ = thread;
+        }
     public:
         /// Following function are for debug only
         /// In execution, version with PhysicalRegister should be used
+        /// Memory addresses are the ones seen by the debug thread
         int64_t getRegister(Register reg) const;
 
         double getFloatRegister(FloatRegister reg) const;
 
+        const VectorRegister::Value& getVectorRegister(VectorRegister vReg) const;
+
         void setRegister(Register reg, int64_t value);
 
         void setFloatRegister(FloatRegister fReg, double value);
 
+        void setVectorRegister(VectorRegister vReg, const VectorRegister::Value& value);
+
         uint64_t getMemory(uint64_t address) const;
 
         void setMemory(uint64_t address, uint64_t value);
@@ -165,36 +481,94 @@ namespace tiny::t86 {
         // Branch processing
         void checkBranchPrediction(const ReservationStation::Entry& entry, uint64_t destination);
 
-        void registerBranchNotTaken(uint64_t sourcePc);
+        void registerBranchNotTaken(std::size_t thread, uint64_t sourcePc);
+
+        void registerBranchTaken(std::size_t thread, uint64_t sourcePc, uint64_t destination);
 
-        void registerBranchTaken(uint64_t sourcePc, uint64_t destination);
+        Cpu(std::size_t registerCount, std::size_t floatRegisterCount, std::size_t aluCnt, std::size_t reservationStationEntriesCount,
+            std::size_t ramSize, std::size_t ramGatesCnt, RAM* sharedRam, CoherentCache* dataCache, IOChannel* sharedIo,
+            std::size_t coreId);
 
         PhysicalRegister nextFreeRegister() const;
 
-        // Harvard architecture
-        Program program_;
+        // Physical registers holding architectural state of one thread
+        std::size_t contextRegistersCount() const {
+            // One more, the special registers start after a gap
+            return registerCnt_ + floatRegisterCnt_ + vectorRegisterCnt_ + specialRegistersCnt + 1;
+        }
+
+        // Empty when no thread can fetch
+        std::optional<std::size_t> selectFetchThread() const;
+
+        // Prefetches go only through RAM gates left free by the demand reads
+        void issuePrefetches();
+
+        /**
+         * Hardware context, with SMT more of them share the frontend, reservation station, ALUs and RAM
+         */
+        struct Thread {
+            Thread(Cpu& cpu, std::size_t physicalRegisterOffset, std::size_t memoryOffset);
+
+            // Harvard architecture
+            Program program;
+
+            uint64_t speculativeProgramCounter{0};
+
+            std::unique_ptr<BranchPredictor> branchPredictor;
+
+            // Empty when values are not predicted
+            std::optional<ValuePredictor> valuePredictor;
+
+            // list of predicted jump destinations
+            std::list<uint64_t> predictions;
+
+            // Register allocation table
+            RegisterAllocationTable rat;
+
+            MemoryWritesManager writesManager;
+
+            // Addresses of the thread start here in RAM
+            std::size_t memoryOffset;
 
-        uint64_t speculativeProgramCounter_{0};
+            bool halted{true};
+
+            // Performance counters
+            std::size_t retired{0};
+            std::size_t mispredicts{0};
+            std::size_t ramStalls{0};
+        };
 
         struct InstructionEntry {
             const Instruction* instruction;
             std::size_t pc;
             std::size_t loggingId;
+            std::size_t thread;
         };
 
-        InstructionEntry fetchInstruction();
+        InstructionEntry fetchInstruction(std::size_t thread);
 
-        std::optional<InstructionEntry> instructionFetch_;
+        bool frontendEmpty() const;
 
-        std::optional<InstructionEntry> instructionDecode_;
+        // Fetch of the only thread is inside the locked loop, fetch and decode are bypassed
+        bool loopBufferStreaming() const;
 
-        ReservationStation reservationStation_; // ReservationStations
+        // False when the reservation station can't take the instruction
+        bool dispatchFromLoopBuffer();
+
+        // Fetch of the thread was redirected, the buffer unlocks when it is no longer inside the locked loop
+        void redirectLoopBuffer(std::size_t thread);
+
+        // Without the cache fetch never stalls
+        std::optional<InstructionCache> instructionCache_;
 
-        std::unique_ptr<BranchPredictor> branchPredictor_;
+        std::optional<LoopBuffer> loopBuffer_;
 
+        // Pipeline from fetch (front) to dispatch (back), every tick instructions move to free stages after them
+        std::vector<std::optional<InstructionEntry>> frontend_;
 
         std::size_t registerCnt_;
         std::size_t floatRegisterCnt_;
+        std::size_t vectorRegisterCnt_;
         std::size_t physicalRegisterCnt_;
 
         struct RegisterValue {
@@ -206,18 +580,52 @@ namespace tiny::t86 {
         // Values of registers, indexed by PhysicalRegister
         std::vector<RegisterValue> registers_;
 
-        // Register allocation table
-        RegisterAllocationTable rat_;
+        // Lanes of physical registers mapped to vector registers, readiness is kept in registers_
+        std::vector<VectorRegister::Value> vectorRegisters_;
+
+        // Empty for cores of a System
+        std::optional<RAM> ownRam_;
+
+        RAM& ram_;
+
+        // Only cores of a System have one
+        CoherentCache* dataCache_;
+
+        // Empty for cores of a System
+        std::optional<IOChannel> ownIo_;
+
+        IOChannel& io_;
 
-        RAM ram_;
+        std::size_t coreId_;
 
-        MemoryWritesManager writesManager_;
+        std::size_t ticks_{0};
 
-        // list of predicted jump destinations
-        std::list<uint64_t> predictions_;
+        std::vector<Thread> threads_;
+
+        // Declared after registers_ and threads_, entries left by a run stopped by an exception
+        // unsubscribe from the registers when they are destroyed
+        ReservationStation reservationStation_; // ReservationStations
+
+        FetchPolicy fetchPolicy_;
+
+        // Thread which fetched the last, round robin continues after it
+        std::size_t lastFetchThread_{0};
+
+        // Thread waiting for instruction cache fill keeps the fetch
+        std::optional<std::size_t> instructionCacheThread_;
+
+        std::size_t debugThread_{0};
+
+        std::optional<StridePrefetcher> prefetcher_;
 
         std::function<void(Cpu&)> breakHandler_;
 
-        bool halted_{false};
+        TraceWriter* traceWriter_{nullptr};
+
+        // Empty when the stack is not bounded
+        std::optional<std::pair<std::size_t, std::size_t>> stack_;
+
+        // Reused for every record to avoid allocations
+        TraceRecord traceRecord_;
     };
 }
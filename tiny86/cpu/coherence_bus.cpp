@@ -0,0 +1,98 @@
+#include "coherence_bus.h"
+#include "coherent_cache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tiny::t86 {
+    CoherenceBus::Protocol CoherenceBus::parseProtocol(const std::string& name) {
+        if (name == "MSI") {
+            return Protocol::msi;
+        }
+        if (name == "MESI") {
+            return Protocol::mesi;
+        }
+        throw std::invalid_argument("Unknown coherence protocol " + name + ", expected MSI or MESI");
+    }
+
+    CoherenceBus::CoherenceBus(Protocol protocol, std::size_t transferLatency)
+            : protocol_(protocol), transferLatency_(std::max<std::size_t>(transferLatency, 1)) {}
+
+    void CoherenceBus::connect(CoherentCache& cache) {
+        caches_.push_back(&cache);
+    }
+
+    void CoherenceBus::request(CoherentCache& cache, uint64_t line, Request request) {
+        queue_.push_back({&cache, line, request});
+    }
+
+    void CoherenceBus::tick(RAM& ram) {
+        if (current_) {
+            ++stats_.busyTicks;
+            if (current_->fromMemory) {
+                if (!ram.read(current_->line * current_->cache->lineSize())) {
+                    return;
+                }
+            } else if (--current_->remaining > 0) {
+                return;
+            }
+            CoherentCache::State state = CoherentCache::State::modified;
+            if (current_->request == Request::read) {
+                state = protocol_ == Protocol::mesi && !current_->shared
+                        ? CoherentCache::State::exclusive
+                        : CoherentCache::State::shared;
+            }
+            current_->cache->fill(current_->line, state);
+            // Next transaction starts in the following tick
+            current_ = std::nullopt;
+            return;
+        }
+        if (queue_.empty()) {
+            return;
+        }
+        const Transaction& next = queue_.front();
+        // Atomic instruction of other core holds the line
+        if (std::any_of(caches_.begin(), caches_.end(), [&next](const CoherentCache* cache) {
+                return cache != next.cache && cache->locked(next.line);
+            })) {
+            return;
+        }
+        Transaction transaction = next;
+        queue_.pop_front();
+        start(transaction);
+    }
+
+    void CoherenceBus::start(Transaction transaction) {
+        ++stats_.transactions;
+        if (transaction.request == Request::upgrade
+                && transaction.cache->state(transaction.line) == CoherentCache::State::invalid) {
+            // The copy was invalidated while the upgrade waited in the queue
+            transaction.request = Request::readExclusive;
+        }
+        bool exclusive = transaction.request != Request::read;
+        bool owned = false;
+        for (CoherentCache* cache : caches_) {
+            if (cache == transaction.cache) {
+                continue;
+            }
+            auto state = cache->state(transaction.line);
+            if (state == CoherentCache::State::invalid) {
+                continue;
+            }
+            transaction.shared = true;
+            owned |= state == CoherentCache::State::modified || state == CoherentCache::State::exclusive;
+            cache->snoop(transaction.line, exclusive);
+        }
+        if (transaction.request == Request::upgrade) {
+            ++stats_.upgrades;
+            transaction.remaining = 1;
+        } else if (owned) {
+            ++stats_.cacheTransfers;
+            transaction.remaining = transferLatency_;
+        } else {
+            ++stats_.memoryFills;
+            transaction.fromMemory = true;
+        }
+        current_ = transaction;
+    }
+}
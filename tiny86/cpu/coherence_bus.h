@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <optional>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "../ram.h"
+
+namespace tiny::t86 {
+    class CoherentCache;
+
+    /**
+     * Snooping bus connecting the private data caches of the cores with the shared RAM
+     *
+     * Requests are served one at a time in the order they came. All other caches snoop the request
+     * when it starts; the line is then transferred from the cache which owned it (transferLatency)
+     * or read from the RAM. Upgrade of a shared line carries no data and takes a single tick.
+     * Under MESI a read of a line no other cache holds is filled as exclusive,
+     * so a later write needs no bus transaction.
+     */
+    class CoherenceBus {
+    public:
+        enum class Protocol {
+            msi, mesi
+        };
+
+        enum class Request {
+            read, readExclusive, upgrade
+        };
+
+        struct Stats {
+            std::size_t transactions{0};
+            std::size_t cacheTransfers{0};
+            std::size_t memoryFills{0};
+            std::size_t upgrades{0};
+            // Ticks with a transaction in progress
+            std::size_t busyTicks{0};
+        };
+
+        // MSI or MESI, throws std::invalid_argument for other names
+        static Protocol parseProtocol(const std::string& name);
+
+        CoherenceBus(Protocol protocol, std::size_t transferLatency);
+
+        Protocol protocol() const {
+            return protocol_;
+        }
+
+        void connect(CoherentCache& cache);
+
+        void request(CoherentCache& cache, uint64_t line, Request request);
+
+        void tick(RAM& ram);
+
+        const Stats& stats() const {
+            return stats_;
+        }
+
+    private:
+        struct Transaction {
+            CoherentCache* cache;
+            uint64_t line;
+            Request request;
+            // Other cache had a copy when the transaction started
+            bool shared{false};
+            bool fromMemory{false};
+            std::size_t remaining{0};
+        };
+
+        void start(Transaction transaction);
+
+        Protocol protocol_;
+
+        std::size_t transferLatency_;
+
+        std::vector<CoherentCache*> caches_;
+
+        std::deque<Transaction> queue_;
+
+        std::optional<Transaction> current_;
+
+        Stats stats_;
+    };
+}
@@ -0,0 +1,155 @@
+#include "coherent_cache.h"
+#include "coherence_bus.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <cassert>
+
+namespace tiny::t86 {
+    CoherentCache::CoherentCache(CoherenceBus& bus, std::size_t size, std::size_t associativity, std::size_t lineSize)
+            : bus_(bus), associativity_(associativity), lineSize_(lineSize) {
+        if (associativity == 0 || lineSize == 0 || size == 0 || size % (associativity * lineSize) != 0) {
+            throw std::invalid_argument("Data cache size " + std::to_string(size)
+                                        + " is not a multiple of associativity * line size");
+        }
+        sets_.resize(size / (associativity * lineSize));
+        for (auto& set : sets_) {
+            set.reserve(associativity);
+        }
+        bus_.connect(*this);
+    }
+
+    bool CoherentCache::read(uint64_t address) {
+        ++time_;
+        uint64_t line = this->line(address);
+        if (Way* way = find(line)) {
+            countHit(*way);
+            return true;
+        }
+        if (requested_.insert(line).second) {
+            ++stats_.misses;
+            bus_.request(*this, line, CoherenceBus::Request::read);
+        }
+        return false;
+    }
+
+    bool CoherentCache::own(uint64_t address) {
+        ++time_;
+        uint64_t line = this->line(address);
+        Way* way = find(line);
+        if (way && way->state == State::exclusive) {
+            // Nobody else has the line, no need to ask
+            way->state = State::modified;
+        }
+        if (way && way->state == State::modified) {
+            countHit(*way);
+            return true;
+        }
+        if (requested_.insert(line).second) {
+            if (way) {
+                ++stats_.upgrades;
+                bus_.request(*this, line, CoherenceBus::Request::upgrade);
+            } else {
+                ++stats_.misses;
+                bus_.request(*this, line, CoherenceBus::Request::readExclusive);
+            }
+        }
+        return false;
+    }
+
+    void CoherentCache::lock(uint64_t address) {
+        assert(!lockedLine_ || *lockedLine_ == line(address));
+        lockedLine_ = line(address);
+    }
+
+    void CoherentCache::unlock() {
+        lockedLine_ = std::nullopt;
+    }
+
+    CoherentCache::StoreId CoherentCache::write(uint64_t address, int64_t value) {
+        StoreId id = nextStoreId_++;
+        stores_.push_back({id, address, value});
+        return id;
+    }
+
+    bool CoherentCache::pending(StoreId id) const {
+        return std::any_of(stores_.begin(), stores_.end(), [id](const Store& store) { return store.id == id; });
+    }
+
+    void CoherentCache::tick(RAM& ram) {
+        if (!stores_.empty() && own(stores_.front().address)) {
+            ram.set(stores_.front().address, stores_.front().value);
+            stores_.pop_front();
+        }
+    }
+
+    CoherentCache::State CoherentCache::state(uint64_t line) const {
+        const Way* way = find(line);
+        return way ? way->state : State::invalid;
+    }
+
+    void CoherentCache::snoop(uint64_t line, bool exclusive) {
+        auto& set = sets_[line % sets_.size()];
+        auto it = std::find_if(set.begin(), set.end(), [line](const Way& way) { return way.tag == line; });
+        if (it == set.end()) {
+            return;
+        }
+        assert(!locked(line) && "Bus must not snoop a locked line");
+        if (it->state == State::modified) {
+            ++stats_.writebacks;
+        }
+        if (exclusive) {
+            ++stats_.invalidations;
+            filled_.erase(line);
+            set.erase(it);
+        } else {
+            it->state = State::shared;
+        }
+    }
+
+    void CoherentCache::fill(uint64_t line, State state) {
+        requested_.erase(line);
+        filled_.insert(line);
+        if (Way* way = find(line)) {
+            way->state = state;
+            way->lastUse = time_;
+            return;
+        }
+        auto& set = sets_[line % sets_.size()];
+        if (set.size() < associativity_) {
+            set.push_back({line, state, time_});
+            return;
+        }
+        auto victim = set.end();
+        for (auto it = set.begin(); it != set.end(); ++it) {
+            if (!locked(it->tag) && (victim == set.end() || it->lastUse < victim->lastUse)) {
+                victim = it;
+            }
+        }
+        if (victim->state == State::modified) {
+            ++stats_.writebacks;
+        }
+        filled_.erase(victim->tag);
+        *victim = {line, state, time_};
+    }
+
+    CoherentCache::Way* CoherentCache::find(uint64_t line) {
+        auto& set = sets_[line % sets_.size()];
+        auto it = std::find_if(set.begin(), set.end(), [line](const Way& way) { return way.tag == line; });
+        return it == set.end() ? nullptr : &*it;
+    }
+
+    const CoherentCache::Way* CoherentCache::find(uint64_t line) const {
+        const auto& set = sets_[line % sets_.size()];
+        auto it = std::find_if(set.begin(), set.end(), [line](const Way& way) { return way.tag == line; });
+        return it == set.end() ? nullptr : &*it;
+    }
+
+    void CoherentCache::countHit(Way& way) {
+        way.lastUse = time_;
+        if (filled_.erase(way.tag) == 0) {
+            ++stats_.hits;
+        }
+    }
+}
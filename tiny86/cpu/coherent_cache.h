@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <set>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+#include "../ram.h"
+
+namespace tiny::t86 {
+    class CoherenceBus;
+
+    /**
+     * Private data cache of one core, kept coherent with the other cores by snooping the CoherenceBus
+     *
+     * Only tags and MSI/MESI states are kept, values always live in the shared RAM. A valid line
+     * lets the core read the words without a bus transaction, a modified one lets it write them.
+     * Stores wait in a store buffer and the oldest one is applied to the RAM once its line is modified,
+     * so a store becomes visible only after copies in other caches were invalidated.
+     * Sizes are in words.
+     */
+    class CoherentCache {
+    public:
+        enum class State {
+            invalid, shared, exclusive, modified
+        };
+
+        using StoreId = RAM::WriteId;
+
+        struct Stats {
+            std::size_t hits{0};
+            std::size_t misses{0};
+            // Shared line had to be made modified
+            std::size_t upgrades{0};
+            // Lines taken away by other caches
+            std::size_t invalidations{0};
+            // Modified lines given to other caches or evicted
+            std::size_t writebacks{0};
+        };
+
+        // Throws std::invalid_argument if the size is not a multiple of lineSize * associativity
+        CoherentCache(CoherenceBus& bus, std::size_t size, std::size_t associativity, std::size_t lineSize);
+
+        // True when the word can be read right away, otherwise its line is requested from the bus
+        bool read(uint64_t address);
+
+        // True when the line of the word is modified, otherwise the ownership is requested from the bus
+        bool own(uint64_t address);
+
+        // Other caches can't take the line until unlock, at most one line is locked
+        void lock(uint64_t address);
+
+        void unlock();
+
+        StoreId write(uint64_t address, int64_t value);
+
+        // The store is still in the store buffer
+        bool pending(StoreId id) const;
+
+        // Applies the oldest store if its line is modified
+        void tick(RAM& ram);
+
+        /// Following functions are used by the bus
+        uint64_t line(uint64_t address) const {
+            return address / lineSize_;
+        }
+
+        std::size_t lineSize() const {
+            return lineSize_;
+        }
+
+        State state(uint64_t line) const;
+
+        bool locked(uint64_t line) const {
+            return lockedLine_ == line;
+        }
+
+        // Other cache asked for the line, exclusive requests invalidate it
+        void snoop(uint64_t line, bool exclusive);
+
+        // Bus transaction of the line finished
+        void fill(uint64_t line, State state);
+
+        const Stats& stats() const {
+            return stats_;
+        }
+
+    private:
+        struct Way {
+            uint64_t tag;
+            State state;
+            // Tick of the last access, smallest is evicted
+            std::size_t lastUse;
+        };
+
+        Way* find(uint64_t line);
+
+        const Way* find(uint64_t line) const;
+
+        // Accessed line is valid; the first use of a line filled for a waiting access is not a hit
+        void countHit(Way& way);
+
+        CoherenceBus& bus_;
+
+        std::size_t associativity_;
+
+        std::size_t lineSize_;
+
+        std::vector<std::vector<Way>> sets_;
+
+        // Lines with a bus transaction in flight
+        std::set<uint64_t> requested_;
+
+        std::set<uint64_t> filled_;
+
+        struct Store {
+            StoreId id;
+            uint64_t address;
+            int64_t value;
+        };
+
+        std::deque<Store> stores_;
+
+        StoreId nextStoreId_{0};
+
+        std::optional<uint64_t> lockedLine_;
+
+        std::size_t time_{0};
+
+        Stats stats_;
+    };
+}
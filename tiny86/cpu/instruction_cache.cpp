@@ -0,0 +1,63 @@
+#include "instruction_cache.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace tiny::t86 {
+    InstructionCache::InstructionCache(std::size_t size, std::size_t associativity, std::size_t lineSize, std::size_t missLatency)
+            : associativity_(associativity), lineSize_(lineSize), missLatency_(missLatency) {
+        if (associativity == 0 || lineSize == 0 || size == 0 || size % (associativity * lineSize) != 0) {
+            throw std::invalid_argument("Instruction cache size " + std::to_string(size)
+                                        + " is not a multiple of associativity * line size");
+        }
+        if (missLatency == 0) {
+            throw std::invalid_argument("Instruction cache miss latency must be positive");
+        }
+        sets_.resize(size / (associativity * lineSize));
+        for (auto& set : sets_) {
+            set.reserve(associativity);
+        }
+    }
+
+    InstructionCache::Access InstructionCache::fetch(uint64_t pc) {
+        ++time_;
+        uint64_t line = pc / lineSize_;
+        if (pending_ && pending_->line == line) {
+            if (--pending_->remaining > 0) {
+                return Access::filling;
+            }
+            pending_.reset();
+            fill(line);
+            return Access::filled;
+        }
+        pending_.reset();
+        if (lookup(line)) {
+            ++hits_;
+            return Access::hit;
+        }
+        ++misses_;
+        pending_ = PendingFill{line, missLatency_};
+        return Access::miss;
+    }
+
+    bool InstructionCache::lookup(uint64_t line) {
+        auto& set = sets_[line % sets_.size()];
+        auto it = std::find_if(set.begin(), set.end(), [line](const Way& way) { return way.tag == line; });
+        if (it == set.end()) {
+            return false;
+        }
+        it->lastUse = time_;
+        return true;
+    }
+
+    void InstructionCache::fill(uint64_t line) {
+        auto& set = sets_[line % sets_.size()];
+        if (set.size() < associativity_) {
+            set.push_back({line, time_});
+            return;
+        }
+        auto victim = std::min_element(set.begin(), set.end(), [](const Way& a, const Way& b) { return a.lastUse < b.lastUse; });
+        *victim = {line, time_};
+    }
+}
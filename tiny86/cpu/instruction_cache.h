@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace tiny::t86 {
+    /**
+     * Set associative instruction cache with LRU replacement
+     *
+     * Only tags are kept, instructions themselves are always read from the program.
+     * Sizes are in instructions, since program memory is addressed by instructions.
+     * A miss fills the line after missLatency ticks, while it is pending
+     * the fetch stalls; a redirect of the fetch to other line abandons the fill.
+     */
+    class InstructionCache {
+    public:
+        enum class Access {
+            hit,
+            // The fill started, fetch stalls
+            miss,
+            // Waiting for the fill
+            filling,
+            // The fill finished in this tick, instruction can be fetched
+            filled
+        };
+
+        // Throws std::invalid_argument if the size is not a multiple of lineSize * associativity
+        // or the miss latency is 0
+        InstructionCache(std::size_t size, std::size_t associativity, std::size_t lineSize, std::size_t missLatency);
+
+        // Called once per tick while the fetch wants the instruction at pc
+        Access fetch(uint64_t pc);
+
+        static bool ready(Access access) {
+            return access == Access::hit || access == Access::filled;
+        }
+
+        std::size_t hits() const {
+            return hits_;
+        }
+
+        std::size_t misses() const {
+            return misses_;
+        }
+
+    private:
+        struct Way {
+            uint64_t tag;
+            // Tick of the last access, smallest is evicted
+            std::size_t lastUse;
+        };
+
+        struct PendingFill {
+            uint64_t line;
+            std::size_t remaining;
+        };
+
+        bool lookup(uint64_t line);
+
+        void fill(uint64_t line);
+
+        std::size_t associativity_;
+
+        std::size_t lineSize_;
+
+        std::size_t missLatency_;
+
+        // Every set holds up to associativity_ ways
+        std::vector<std::vector<Way>> sets_;
+
+        std::optional<PendingFill> pending_;
+
+        std::size_t time_{0};
+
+        std::size_t hits_{0};
+
+        std::size_t misses_{0};
+    };
+}
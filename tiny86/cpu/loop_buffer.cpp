@@ -0,0 +1,25 @@
+#include "loop_buffer.h"
+
+namespace tiny::t86 {
+    LoopBuffer::LoopBuffer(std::size_t capacity)
+            : capacity_(capacity) {}
+
+    void LoopBuffer::observeBranch(uint64_t pc, uint64_t destination) {
+        // Forward branches may be inside the loop body, leaving the loop is found by the cpu
+        if (destination > pc) {
+            return;
+        }
+        if (pc - destination + 1 > capacity_) {
+            unlock();
+            return;
+        }
+        Loop loop{destination, pc};
+        locked_ = candidate_ == loop;
+        candidate_ = loop;
+    }
+
+    void LoopBuffer::unlock() {
+        candidate_.reset();
+        locked_ = false;
+    }
+}
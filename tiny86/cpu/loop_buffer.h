@@ -0,0 +1,50 @@
+#pragma once
+
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace tiny::t86 {
+    /**
+     * Loop stream buffer keeping decoded instructions of a short loop
+     *
+     * A loop is a backward branch predicted taken, with at most capacity instructions from its destination
+     * to the branch. When the fetch sees the same loop two times in a row, the first iteration filled
+     * the buffer and it locks. While the fetch stays inside the locked loop, instructions go from the buffer
+     * straight to the reservation station, bypassing the instruction cache, fetch and decode.
+     * Leaving the loop unlocks the buffer.
+     */
+    class LoopBuffer {
+    public:
+        explicit LoopBuffer(std::size_t capacity);
+
+        // Called by the fetch for every branch it predicts taken
+        void observeBranch(uint64_t pc, uint64_t destination);
+
+        // The instruction at pc can be delivered from the buffer
+        bool covers(uint64_t pc) const {
+            return locked_ && pc >= candidate_->start && pc <= candidate_->end;
+        }
+
+        // Fetch left the loop, it has to be seen two times again
+        void unlock();
+
+    private:
+        struct Loop {
+            uint64_t start;
+            // Address of the backward branch
+            uint64_t end;
+
+            bool operator==(const Loop& other) const {
+                return start == other.start && end == other.end;
+            }
+        };
+
+        std::size_t capacity_;
+
+        // The last loop seen by the fetch
+        std::optional<Loop> candidate_;
+
+        bool locked_{false};
+    };
+}
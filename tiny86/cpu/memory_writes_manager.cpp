@@ -47,6 +47,16 @@ namespace tiny::t86 {
         }
     }
 
+    void MemoryWritesManager::removeFinished(const CoherentCache& cache) {
+        auto pending = [&cache](RAM::WriteId id) { return cache.pending(id); };
+        for (auto& [address, writes] : writesMap_) {
+            auto removedIds = writes.removeFinished(pending);
+            for (MemoryWrite::Id id : removedIds) {
+                writesById.erase(id);
+            }
+        }
+    }
+
     void MemoryWritesManager::removePending() {
         for (auto& [address, writes] : writesMap_) {
             auto removedIds = writes.removePending();
@@ -63,9 +73,15 @@ namespace tiny::t86 {
         return it->second;
     }
 
-    void MemoryWritesManager::startWriting(MemoryWrite::Id id, RAM& ram) {
+    void MemoryWritesManager::startWriting(MemoryWrite::Id id, RAM& ram, std::size_t addressOffset) {
+        MemoryWrite& write = getWrite(id);
+        assert(write.isPending() && write.hasValue());
+        write.setWriteId(ram.write(addressOffset + write.address(), write.value()));
+    }
+
+    void MemoryWritesManager::startWriting(MemoryWrite::Id id, CoherentCache& cache, std::size_t addressOffset) {
         MemoryWrite& write = getWrite(id);
         assert(write.isPending() && write.hasValue());
-        write.setWriteId(ram.write(write.address(), write.value()));
+        write.setWriteId(cache.write(addressOffset + write.address(), write.value()));
     }
 }
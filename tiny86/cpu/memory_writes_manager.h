@@ -7,6 +7,7 @@
 
 #include "memory_writes_manager/memory_write.h"
 #include "memory_writes_manager/memory_writes.h"
+#include "coherent_cache.h"
 
 namespace tiny::t86 {
     class MemoryWritesManager {
@@ -18,6 +19,9 @@ namespace tiny::t86 {
         /// Removes all finished outgoing writes
         void removeFinished(const RAM& ram);
 
+        /// Removes writes which already left the store buffer of the cache
+        void removeFinished(const CoherentCache& cache);
+
         /**
          * Removes all pending writes
          * Used when undoing speculation
@@ -36,8 +40,16 @@ namespace tiny::t86 {
         /// Specify value of the write, this does not transitions the write to outgoing state
         void specifyValue(MemoryWrite::Id, uint64_t value) const;
 
-        /// Starts the writing
-        void startWriting(MemoryWrite::Id id, RAM& ram);
+        /// Starts the writing, addresses of the writes are relative to the addressOffset in the ram
+        void startWriting(MemoryWrite::Id id, RAM& ram, std::size_t addressOffset = 0);
+
+        /// Same as above, the write goes through the store buffer of the cache
+        void startWriting(MemoryWrite::Id id, CoherentCache& cache, std::size_t addressOffset = 0);
+
+        /// No write is pending or outgoing
+        bool empty() const {
+            return writesById.empty() && unspecifiedWrites_.empty();
+        }
 
         bool hasUnspecifiedWrites(MemoryWrite::Id maxId) const {
             auto it = unspecifiedWrites_.lower_bound(maxId);
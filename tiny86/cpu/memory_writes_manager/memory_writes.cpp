@@ -26,9 +26,13 @@ namespace tiny::t86 {
     }
 
     std::vector<MemoryWrite::Id> MemoryWrites::removeFinished(const RAM& ram) {
+        return removeFinished([&ram](RAM::WriteId id) { return ram.pending(id); });
+    }
+
+    std::vector<MemoryWrite::Id> MemoryWrites::removeFinished(const std::function<bool(RAM::WriteId)>& pending) {
         std::vector<MemoryWrite::Id> removed;
         for (auto writeIt = writes_.begin(); writeIt != writes_.end();) {
-            if (writeIt->isOutgoing() && !ram.pending(writeIt->writeId())) {
+            if (writeIt->isOutgoing() && !pending(writeIt->writeId())) {
                 // Already finished
                 removed.push_back(writeIt->id());
                 writeIt = writes_.erase(writeIt);
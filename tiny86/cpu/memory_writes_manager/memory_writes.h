@@ -3,6 +3,7 @@
 #include <utility>
 #include <optional>
 #include <set>
+#include <functional>
 
 #include "../../ram.h"
 #include "memory_write.h"
@@ -28,6 +29,9 @@ namespace tiny::t86 {
          */
         std::vector<MemoryWrite::Id> removeFinished(const RAM& ram);
 
+        // Same as above, pending tells whether the outgoing write with given id is still in progress
+        std::vector<MemoryWrite::Id> removeFinished(const std::function<bool(RAM::WriteId)>& pending);
+
         /**
          * Removes all pending writes
          * used when undoing speculation
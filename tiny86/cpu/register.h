@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <array>
 #include <limits>
 #include <functional>
 #include <string>
@@ -39,6 +41,11 @@ namespace tiny::t86 {
             return Register{std::numeric_limits<size_t>::max() - 3};
         }
 
+        // Id of the hardware thread (core) executing the instruction, read only
+        constexpr static Register CoreId() {
+            return Register{std::numeric_limits<size_t>::max() - 4};
+        }
+
         constexpr Register(size_t index) : index_{index} {}
 
         constexpr size_t index() const {
@@ -49,6 +56,7 @@ namespace tiny::t86 {
             switch (index_) {
                 case ProgramCounter().index_:
                 case Flags().index_:
+                case CoreId().index_:
                     return true;
                 default:
                     return false;
@@ -93,6 +101,8 @@ namespace tiny::t86 {
                     return "Bp";
                 case Flags().index_:
                     return "Flags";
+                case CoreId().index_:
+                    return "CoreId";
                 default:
                     return "Reg" + std::to_string(index_);
             }
@@ -302,9 +312,41 @@ namespace tiny::t86 {
         size_t index_;
     };
 
+    /**
+     * Packed register of the vector extension, its value are `lanes` 64bit words,
+     * all of them integers or all doubles (stored bitwise like in float registers)
+     */
+    class VectorRegister {
+    public:
+        static constexpr std::size_t lanes = 4;
+
+        using Value = std::array<int64_t, lanes>;
+
+        VectorRegister(size_t index) : index_(index) {}
+
+        size_t index() const {
+            return index_;
+        }
+
+        bool operator<(const VectorRegister other) const {
+            return index_ < other.index_;
+        }
+
+        bool operator==(const VectorRegister other) const {
+            return index_ == other.index_;
+        }
+
+        std::string toString() const {
+            return "VReg" + std::to_string(index_);
+        }
+
+    private:
+        size_t index_;
+    };
+
     /**
      * This does not store any value, just refers to a physical register in CPU.
-     * The refered register can be either Register of FloatRegister
+     * The refered register can be Register, FloatRegister or VectorRegister
      */
     class PhysicalRegister {
     public:
@@ -340,3 +382,10 @@ struct std::hash<tiny::t86::FloatRegister> {
         return std::hash<size_t>()(lr.index());
     }
 };
+
+template<>
+struct std::hash<tiny::t86::VectorRegister> {
+    std::size_t operator()(const tiny::t86::VectorRegister& lr) const noexcept {
+        return std::hash<size_t>()(lr.index());
+    }
+};
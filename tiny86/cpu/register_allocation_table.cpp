@@ -3,27 +3,33 @@
 #include <cassert>
 
 #include "../cpu.h"
+#include "../utils/host_profiler.h"
 
 namespace tiny::t86 {
 
-    RegisterAllocationTable::RegisterAllocationTable(Cpu& cpu, std::size_t registerCnt, std::size_t floatRegisterCnt)
+    RegisterAllocationTable::RegisterAllocationTable(Cpu& cpu, std::size_t registerCnt, std::size_t floatRegisterCnt, std::size_t vectorRegisterCnt, std::size_t offset)
             : cpu_{cpu} {
-        std::size_t i = 0;
-        for (; i < registerCnt; ++i) {
-            table_.insert_or_assign(Register{i}, PhysicalRegister{i});
+        std::size_t i = offset;
+        for (std::size_t j = 0; j < registerCnt; ++j, ++i) {
+            table_.insert_or_assign(Register{j}, PhysicalRegister{i});
         }
         for (std::size_t j = 0; j < floatRegisterCnt; ++j, ++i) {
             table_.insert_or_assign(FloatRegister{j}, PhysicalRegister{i});
         }
+        for (std::size_t j = 0; j < vectorRegisterCnt; ++j, ++i) {
+            table_.insert_or_assign(VectorRegister{j}, PhysicalRegister{i});
+        }
         table_.insert_or_assign(Register::ProgramCounter(), PhysicalRegister{ ++i });
         table_.insert_or_assign(Register::StackPointer(), PhysicalRegister{ ++i });
         table_.insert_or_assign(Register::StackBasePointer(), PhysicalRegister{ ++i });
         table_.insert_or_assign(Register::Flags(), PhysicalRegister{ ++i });
+        table_.insert_or_assign(Register::CoreId(), PhysicalRegister{ ++i });
         subscribeToReads();
     }
 
     RegisterAllocationTable::RegisterAllocationTable(const RegisterAllocationTable& other)
             : table_{other.table_}, cpu_{other.cpu_} {
+        HostProfiler::instance().countRatCopy();
         subscribeToReads();
     }
 
@@ -57,6 +63,7 @@ namespace tiny::t86 {
 
         unsubscribeFromReads();
 
+        HostProfiler::instance().countRatCopy();
         table_ = other.table_;
 
         subscribeToReads();
@@ -80,6 +87,14 @@ namespace tiny::t86 {
         cpu_.subscribeRegisterRead(to);
     }
 
+    void RegisterAllocationTable::rename(VectorRegister from, PhysicalRegister to) {
+        if (auto it = table_.find(from); it != table_.end()) {
+            cpu_.unsubscribeRegisterRead(it->second);
+        }
+        table_.insert_or_assign(from, to);
+        cpu_.subscribeRegisterRead(to);
+    }
+
     PhysicalRegister RegisterAllocationTable::translate(Register reg) const {
         return table_.at(reg);
     }
@@ -88,6 +103,10 @@ namespace tiny::t86 {
         return table_.at(fReg);
     }
 
+    PhysicalRegister RegisterAllocationTable::translate(VectorRegister vReg) const {
+        return table_.at(vReg);
+    }
+
     bool RegisterAllocationTable::isUnmapped(PhysicalRegister reg) const {
         return std::all_of(table_.begin(), table_.end(), [reg](const auto& mapping) {
             return mapping.second.index() != reg.index();
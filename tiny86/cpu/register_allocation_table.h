@@ -11,7 +11,8 @@ namespace tiny::t86 {
     public:
         // The number of logical registers here is passed so we don't have to worry
         // if cpu's register count is already initialized
-        RegisterAllocationTable(Cpu& cpu, std::size_t registerCnt, std::size_t floatRegisterCnt);
+        // Physical registers of the initial mapping start at the offset (each hardware thread has its own)
+        RegisterAllocationTable(Cpu& cpu, std::size_t registerCnt, std::size_t floatRegisterCnt, std::size_t vectorRegisterCnt, std::size_t offset = 0);
 
         RegisterAllocationTable(const RegisterAllocationTable& other);
 
@@ -25,10 +26,14 @@ namespace tiny::t86 {
 
         void rename(FloatRegister from, PhysicalRegister to);
 
+        void rename(VectorRegister from, PhysicalRegister to);
+
         PhysicalRegister translate(Register reg) const;
 
         PhysicalRegister translate(FloatRegister fReg) const;
 
+        PhysicalRegister translate(VectorRegister vReg) const;
+
         bool isUnmapped(PhysicalRegister reg) const;
 
     protected:
@@ -36,7 +41,7 @@ namespace tiny::t86 {
 
         void unsubscribeFromReads();
 
-        std::map<std::variant<Register, FloatRegister>, PhysicalRegister> table_;
+        std::map<std::variant<Register, FloatRegister, VectorRegister>, PhysicalRegister> table_;
 
         Cpu& cpu_;
     };
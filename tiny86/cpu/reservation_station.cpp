@@ -4,17 +4,24 @@
 
 #include <cassert>
 #include <stdexcept>
+#include <algorithm>
 
 namespace tiny::t86 {
     void ReservationStation::executeAndRetire() {
         // First check finished ones by progressing execution
         for (auto& entry : entries_) {
+            if (entry.valuePredicted()) {
+                entry.verifyValuePrediction();
+            }
             if (entry.state() == Entry::State::executing) {
                 if (entry.executionTick()) {
                     // finished
                     if (entry.instruction()->needsAlu()) {
                         ++freeAlus_;
                     }
+                    if (entry.instruction()->needsVectorUnit()) {
+                        ++freeVectorUnits_;
+                    }
                 }
             }
         }
@@ -25,16 +32,42 @@ namespace tiny::t86 {
         // might lead to erasure of all other instructions in reservation station (invalidating all iterators)
         // Instructions that just ended execution can retire also in this tick
         // but one tick was also "taken" by preparing state
-        while (!entries_.empty()) {
-            if (entries_.front().state() == Entry::State::retiring) {
-                Entry entry = std::move(entries_.front());
-                entries_.pop_front();
-                entry.logRetirement();
-                entry.retire();
+        // With more hardware threads the order is kept per thread, unfinished instruction blocks only its own thread
+        std::vector<bool> blocked(cpu_.threadsCount());
+        while (true) {
+            auto it = entries_.begin();
+            std::fill(blocked.begin(), blocked.end(), false);
+            std::size_t blockedCnt = 0;
+            for (; it != entries_.end() && blockedCnt != blocked.size(); ++it) {
+                if (blocked[it->thread()]) {
+                    continue;
+                }
+                if (it->retirable()) {
+                    break;
+                }
+                blocked[it->thread()] = true;
+                ++blockedCnt;
             }
-            else {
+            if (it == entries_.end() || blockedCnt == blocked.size()) {
                 break;
             }
+            Entry entry = std::move(*it);
+            entries_.erase(it);
+            if (entry.valueMispredicted()) {
+                entry.replay();
+                continue;
+            }
+            entry.logRetirement();
+            entry.retire();
+            cpu_.checkStack(entry);
+            cpu_.countRetirement(entry.thread());
+            if (cpu_.predictingValues() && entry.loadedValue()) {
+                cpu_.trainValuePredictor(entry.thread(), entry.pc(), *entry.loadedValue());
+                StatsLogger::instance().logLoadRetirement(entry.valuePredicted());
+            }
+            if (cpu_.tracing()) {
+                cpu_.traceRetirement(entry);
+            }
         }
     }
 
@@ -88,11 +121,24 @@ namespace tiny::t86 {
                                     entry.logStallFloatRegisterFetch(fReg);
                                     break;
                                 }
+                            } else if (requirement.isVectorRegisterRead()) {
+                                VectorRegister vReg = requirement.getVectorRegisterRead();
+                                if (entry.vectorRegisterAvailable(vReg)) {
+                                    operand.supply(entry.getVectorRegister(vReg));
+                                } else {
+                                    fetchStall = true;
+                                    entry.logStallVectorRegisterFetch(vReg);
+                                    break;
+                                }
                             } else if (requirement.isMemoryRead()) {
                                 uint64_t address = requirement.getMemoryRead();
                                 auto optMemory = entry.readMemory(address);
                                 if (optMemory.has_value()) {
+                                    entry.recordLoadedValue(optMemory.value());
                                     operand.supply(optMemory.value());
+                                } else if (auto predicted = predictValue(entry)) {
+                                    // Dependants go on with the predicted value, the read itself goes on too
+                                    entry.predictValue(operand, address, *predicted);
                                 } else {
                                     fetchStall = true;
                                     entry.logStallRAMRead(address);
@@ -111,6 +157,9 @@ namespace tiny::t86 {
                     break;
                 }
                 case Entry::State::ready:
+                    if (entry.instruction()->serializing() && !serializingReady(entry)) {
+                        break;
+                    }
                     // Check for ALU
                     if (entry.instruction()->needsAlu()) {
                         // No ALU is free
@@ -120,6 +169,14 @@ namespace tiny::t86 {
                         }
                         --freeAlus_;
                     }
+                    // Vector unit stalls are logged like the ALU ones, both are functional units
+                    if (entry.instruction()->needsVectorUnit()) {
+                        if (!freeVectorUnits_) {
+                            entry.logStallALU();
+                            break;
+                        }
+                        --freeVectorUnits_;
+                    }
                     // Start execution
                     // Again, this will result into one tick spent in "ready" state
                     entry.startExecution();
@@ -143,38 +200,40 @@ namespace tiny::t86 {
         return entries_.size() < maxEntries_;
     }
 
-    ReservationStation::ReservationStation(Cpu& cpu, std::size_t aluCnt, std::size_t maxEntriesCnt)
-            : maxEntries_(maxEntriesCnt), cpu_(cpu), freeAlus_(aluCnt) {}
+    ReservationStation::ReservationStation(Cpu& cpu, std::size_t aluCnt, std::size_t vectorUnitCnt, std::size_t maxEntriesCnt)
+            : maxEntries_(maxEntriesCnt), cpu_(cpu), freeAlus_(aluCnt), freeVectorUnits_(vectorUnitCnt) {}
 
-    void ReservationStation::add(const Instruction* instruction, std::size_t nextPc, std::size_t loggingId) {
+    void ReservationStation::add(const Instruction* instruction, std::size_t nextPc, std::size_t loggingId, std::size_t thread) {
         assert(entries_.size() < maxEntries_ && "Can't add another entry, max capacity was reached");
-        cpu_.renameRegister(Register::ProgramCounter());
-        cpu_.setRegister(Register::ProgramCounter(), nextPc);
-        RegisterAllocationTable readRat = cpu_.getRat();
+        cpu_.renameRegister(thread, Register::ProgramCounter());
+        cpu_.setRegister(cpu_.getRat(thread).translate(Register::ProgramCounter()), static_cast<int64_t>(nextPc));
+        RegisterAllocationTable readRat = cpu_.getRat(thread);
         std::vector<MemoryWrite::Id> memWriteIds;
         for (const auto& product : instruction->produces()) {
             if (product.isRegister()) {
                 Register reg = product.getRegister();
                 // We always rename program counter
                 if (reg != Register::ProgramCounter()) {
-                    cpu_.renameRegister(reg);
+                    cpu_.renameRegister(thread, reg);
                 }
             } else if (product.isFloatRegister()) {
                 FloatRegister fReg = product.getFloatRegister();
-                cpu_.renameFloatRegister(fReg);
+                cpu_.renameFloatRegister(thread, fReg);
+            } else if (product.isVectorRegister()) {
+                cpu_.renameVectorRegister(thread, product.getVectorRegister());
             } else if (product.isMemoryImmediate()) {
-                memWriteIds.push_back(cpu_.registerPendingWrite(product.getMemoryImmediate()));
+                memWriteIds.push_back(cpu_.registerPendingWrite(thread, product.getMemoryImmediate()));
             } else if (product.isMemoryRegister()) {
-                memWriteIds.push_back(cpu_.registerPendingWrite());
+                memWriteIds.push_back(cpu_.registerPendingWrite(thread));
             } else {
                 assert(false && "Missing product type");
             }
         }
-        RegisterAllocationTable writeRat = cpu_.getRat();
+        RegisterAllocationTable writeRat = cpu_.getRat(thread);
         auto& entry = entries_.emplace_back(instruction, cpu_,
                               std::move(readRat), std::move(writeRat),
-                              std::move(memWriteIds), cpu_.currentMaxWriteId(),
-                              loggingId);
+                              std::move(memWriteIds), cpu_.currentMaxWriteId(thread),
+                              nextPc - 1, loggingId, thread);
 
         // Log as preparing status
         entry.logPreparing();
@@ -182,14 +241,68 @@ namespace tiny::t86 {
         entry.checkReady();
     }
 
-    void ReservationStation::clear() {
-        for (const auto& entry : entries_) {
-            if (entry.state() == Entry::State::executing && entry.instruction()->needsAlu()) {
+    void ReservationStation::clear(std::size_t thread) {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->thread() != thread) {
+                ++it;
+                continue;
+            }
+            if (it->state() == Entry::State::executing && it->instruction()->needsAlu()) {
                 ++freeAlus_;
             }
-            entry.logClearSpeculation();
+            if (it->state() == Entry::State::executing && it->instruction()->needsVectorUnit()) {
+                ++freeVectorUnits_;
+            }
+            it->logClearSpeculation();
+            it = entries_.erase(it);
+        }
+    }
+
+    std::size_t ReservationStation::entriesCount(std::size_t thread) const {
+        return std::count_if(entries_.begin(), entries_.end(), [thread](const Entry& entry) {
+            return entry.thread() == thread;
+        });
+    }
+
+    bool ReservationStation::serializing(std::size_t thread) const {
+        return std::any_of(entries_.begin(), entries_.end(), [thread](const Entry& entry) {
+            return entry.thread() == thread && entry.instruction()->serializing();
+        });
+    }
+
+    bool ReservationStation::serializingReady(const Entry& entry) const {
+        auto oldest = std::find_if(entries_.begin(), entries_.end(), [&entry](const Entry& other) {
+            return other.thread() == entry.thread();
+        });
+        if (&*oldest != &entry || !cpu_.writesDrained(entry.thread())) {
+            entry.logStallSerialization();
+            return false;
+        }
+        if (const auto* atomic = dynamic_cast<const AtomicInstruction*>(entry.instruction())) {
+            uint64_t address = atomic->address(entry);
+            if (!cpu_.acquireLine(entry.thread(), address)) {
+                // Operands are fetched already, waiting for the line is a memory stall only for the counters
+                entry.logStallSerialization();
+                cpu_.countRamStall(entry.thread());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::optional<int64_t> ReservationStation::predictValue(const Entry& entry) const {
+        // Only the first read of an entry is predicted, serializing instructions must see memory as it is
+        if (!cpu_.predictingValues() || entry.instruction()->serializing() || entry.valuePredicted() || entry.loadedValue()) {
+            return std::nullopt;
+        }
+        std::size_t olderInFlight = 0;
+        for (const auto& other : entries_) {
+            if (&other == &entry) {
+                break;
+            }
+            olderInFlight += other.thread() == entry.thread() && other.pc() == entry.pc();
         }
-        entries_.clear();
+        return cpu_.predictValue(entry.thread(), entry.pc(), olderInFlight);
     }
 
     bool ReservationStation::Entry::registerAvailable(Register reg) const {
@@ -200,6 +313,10 @@ namespace tiny::t86 {
         return cpu_.registerReady(readRat_.translate(fReg));
     }
 
+    bool ReservationStation::Entry::vectorRegisterAvailable(VectorRegister vReg) const {
+        return cpu_.registerReady(readRat_.translate(vReg));
+    }
+
     int64_t ReservationStation::Entry::getRegister(Register reg) const {
         assert(registerAvailable(reg));
         return cpu_.getRegister(readRat_.translate(reg));
@@ -210,6 +327,11 @@ namespace tiny::t86 {
         return cpu_.getFloatRegister(readRat_.translate(fReg));
     }
 
+    const VectorRegister::Value& ReservationStation::Entry::getVectorRegister(VectorRegister vReg) const {
+        assert(vectorRegisterAvailable(vReg));
+        return cpu_.getVectorRegister(readRat_.translate(vReg));
+    }
+
     void ReservationStation::Entry::setRegister(Register reg, int64_t val) {
         assert(reg == Register::ProgramCounter() || !cpu_.registerReady(writeRat_.translate(reg)));
         cpu_.setRegister(writeRat_.translate(reg), val);
@@ -219,11 +341,16 @@ namespace tiny::t86 {
         cpu_.setRegister(writeRat_.translate(fReg), val);
     }
 
+    void ReservationStation::Entry::setVectorRegister(VectorRegister vReg, const VectorRegister::Value& val) {
+        cpu_.setRegister(writeRat_.translate(vReg), val);
+    }
+
     uint64_t ReservationStation::Entry::getUpdatedProgramCounter() const {
         return cpu_.getRegister(writeRat_.translate(Register::ProgramCounter()));
     }
 
     void ReservationStation::Entry::processJump(bool taken) {
+        branchTaken_ = taken;
         cpu_.jump(*this, taken);
     }
 
@@ -247,7 +374,9 @@ namespace tiny::t86 {
                                      RegisterAllocationTable readRat, RegisterAllocationTable writeRat,
                                      std::vector<MemoryWrite::Id> memWriteIds,
                                      MemoryWrite::Id maxWriteId,
-                                     std::size_t loggingId)
+                                     std::size_t pc,
+                                     std::size_t loggingId,
+                                     std::size_t thread)
             : instruction_(instruction),
               operands_(instruction->operands()),
               readRat_(std::move(readRat)),
@@ -255,7 +384,9 @@ namespace tiny::t86 {
               memWriteIds_(std::move(memWriteIds)),
               maxWriteId_(maxWriteId),
               cpu_(cpu),
-              loggingId_(loggingId) {
+              pc_(pc),
+              loggingId_(loggingId),
+              thread_(thread) {
         remainingExecutionTime_ = Cpu::Config::instance().getExecutionLength(instruction);
     }
 
@@ -308,7 +439,15 @@ namespace tiny::t86 {
     }
 
     void ReservationStation::Entry::writeMemory(MemoryWrite::Id id) {
-        cpu_.writeMemory(id);
+        cpu_.writeMemory(thread_, id);
+    }
+
+    int64_t ReservationStation::Entry::loadAtomic(uint64_t address) {
+        return cpu_.loadAtomic(thread_, address);
+    }
+
+    void ReservationStation::Entry::storeAtomic(uint64_t address, int64_t value) {
+        cpu_.storeAtomic(thread_, address, value);
     }
 
     const RegisterAllocationTable& ReservationStation::Entry::rat() const {
@@ -318,19 +457,65 @@ namespace tiny::t86 {
     }
 
     void ReservationStation::Entry::unrollSpeculation() {
-        cpu_.unrollSpeculation(writeRat_);
+        cpu_.unrollSpeculation(thread_, writeRat_);
+    }
+
+    bool ReservationStation::Entry::retirable() const {
+        return state_ == State::retiring && (!valuePrediction_ || valuePrediction_->actual);
+    }
+
+    void ReservationStation::Entry::predictValue(Operand& operand, uint64_t address, int64_t value) {
+        valuePrediction_ = ValuePrediction{address, value, std::nullopt};
+        operand.supply(value);
+    }
+
+    void ReservationStation::Entry::verifyValuePrediction() {
+        if (valuePrediction_->actual) {
+            return;
+        }
+        if (auto value = readMemory(valuePrediction_->address)) {
+            valuePrediction_->actual = value;
+            loadedValue_ = value;
+        }
+    }
+
+    bool ReservationStation::Entry::valueMispredicted() const {
+        return valuePrediction_ && valuePrediction_->actual != valuePrediction_->value;
+    }
+
+    void ReservationStation::Entry::replay() {
+        logClearSpeculation();
+        StatsLogger::instance().logValueMispredict();
+        // The replayed instruction waits for the read, it trains the predictor when it retires
+        cpu_.distrustValuePrediction(thread_, pc_);
+        cpu_.replay(thread_, readRat_, pc_);
+    }
+
+    void ReservationStation::Entry::recordLoadedValue(int64_t value) {
+        if (!loadedValue_) {
+            loadedValue_ = value;
+        }
     }
 
     std::optional<int64_t> ReservationStation::Entry::readMemory(uint64_t address) {
-        return cpu_.readMemory(address, maxWriteId_);
+        if (cpu_.prefetching() && std::find(observedReads_.begin(), observedReads_.end(), address) == observedReads_.end()) {
+            // The read is retried every tick until it is ready, the prefetcher sees only the first one
+            observedReads_.push_back(address);
+            cpu_.observeLoad(thread_, pc_, address);
+        }
+        auto value = cpu_.readMemory(thread_, address, maxWriteId_);
+        if (value && cpu_.tracing()) {
+            memoryReads_.push_back(address);
+        }
+        return value;
     }
 
     void ReservationStation::Entry::specifyWriteAddress(MemoryWrite::Id id, std::size_t address) {
-        cpu_.specifyWriteAddress(id, address);
+        cpu_.specifyWriteAddress(thread_, id, address);
     }
 
     void ReservationStation::Entry::setWriteValue(MemoryWrite::Id id, uint64_t value) {
-        cpu_.getWrite(id).setValue(value);
+        cpu_.getWrite(thread_, id).setValue(value);
     }
 
     void ReservationStation::Entry::logClearSpeculation() const {
@@ -357,8 +542,13 @@ namespace tiny::t86 {
         StatsLogger::instance().logStallFloatRegisterFetch(loggingId_, fReg);
     }
 
+    void ReservationStation::Entry::logStallVectorRegisterFetch(VectorRegister vReg) const {
+        StatsLogger::instance().logStallVectorRegisterFetch(loggingId_, vReg);
+    }
+
     void ReservationStation::Entry::logStallRAMRead(uint64_t address) const {
         StatsLogger::instance().logStallRAMRead(loggingId_, address);
+        cpu_.countRamStall(thread_);
     }
 
     void ReservationStation::Entry::logStallRetirement() const {
@@ -369,6 +559,14 @@ namespace tiny::t86 {
         StatsLogger::instance().logRetirement(loggingId_);
     }
 
+    void ReservationStation::Entry::logMispredict() const {
+        StatsLogger::instance().logMispredict(loggingId_);
+    }
+
+    void ReservationStation::Entry::logStallSerialization() const {
+        StatsLogger::instance().logStallSerialization(loggingId_);
+    }
+
     void ReservationStation::Entry::logStallALU() const {
         StatsLogger::instance().logNoAluAvailable(loggingId_);
     }
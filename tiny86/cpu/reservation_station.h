@@ -21,7 +21,7 @@ namespace tiny::t86 {
 
     class ReservationStation {
     public:
-        ReservationStation(Cpu& cpu, std::size_t aluCnt, std::size_t maxEntriesCnt);
+        ReservationStation(Cpu& cpu, std::size_t aluCnt, std::size_t vectorUnitCnt, std::size_t maxEntriesCnt);
 
 
         // We process executing and possibly finished instructions first
@@ -35,13 +35,26 @@ namespace tiny::t86 {
 
         bool hasFreeEntry() const;
 
-        void add(const Instruction*, std::size_t nextPc, std::size_t loggingId);
+        void add(const Instruction*, std::size_t nextPc, std::size_t loggingId, std::size_t thread = 0);
 
-        void clear();
+        // Removes entries of the hardware thread
+        void clear(std::size_t thread);
+
+        // Entries of the hardware thread
+        std::size_t entriesCount(std::size_t thread) const;
+
+        // The thread has a serializing instruction in flight, nothing else of it may be dispatched
+        bool serializing(std::size_t thread) const;
 
         class Entry;
 
     private:
+        // Serializing instruction can start only as the oldest of its thread, with nothing left to write
+        bool serializingReady(const Entry& entry) const;
+
+        // Value for the memory read of the entry waiting for the RAM, empty when it is not predicted
+        std::optional<int64_t> predictValue(const Entry& entry) const;
+
         std::list<Entry> entries_;
 
         const std::size_t maxEntries_;
@@ -49,6 +62,8 @@ namespace tiny::t86 {
         Cpu& cpu_;
 
         std::size_t freeAlus_;
+
+        std::size_t freeVectorUnits_;
     };
 
     class ReservationStation::Entry {
@@ -59,7 +74,9 @@ namespace tiny::t86 {
               RegisterAllocationTable writeRat,
               std::vector<MemoryWrite::Id> memWriteIds,
               MemoryWrite::Id maxWriteId,
-              std::size_t loggingId);
+              std::size_t pc,
+              std::size_t loggingId,
+              std::size_t thread);
 
         enum class State {
             preparing, ready, executing, retiring
@@ -89,36 +106,92 @@ namespace tiny::t86 {
 
         const Instruction* instruction() const;
 
+        // Address of the instruction in program
+        std::size_t pc() const {
+            return pc_;
+        }
+
+        // Hardware thread which fetched the instruction
+        std::size_t thread() const {
+            return thread_;
+        }
+
         const RegisterAllocationTable& rat() const;
 
         void unrollSpeculation();
 
+        // Finished and the predicted value, if any, was checked
+        bool retirable() const;
+
+        // Supplies the value to the operand instead of the pending read of the address
+        void predictValue(Operand& operand, uint64_t address, int64_t value);
+
+        bool valuePredicted() const {
+            return valuePrediction_.has_value();
+        }
+
+        // Repeats the read of the predicted address until the real value is known
+        void verifyValuePrediction();
+
+        bool valueMispredicted() const;
+
+        // Throws away the entry and everything after it, the instruction is fetched again
+        void replay();
+
+        // Value read by the first memory read of the operands, the real one for predicted reads
+        const std::optional<int64_t>& loadedValue() const {
+            return loadedValue_;
+        }
+
+        void recordLoadedValue(int64_t value);
+
         Cpu& cpu() const;
 
         bool registerAvailable(Register reg) const;
 
         bool floatRegisterAvailable(FloatRegister fReg) const;
 
+        bool vectorRegisterAvailable(VectorRegister vReg) const;
+
         int64_t getRegister(Register reg) const;
 
         double getFloatRegister(FloatRegister fReg) const;
 
+        const VectorRegister::Value& getVectorRegister(VectorRegister vReg) const;
+
         void setRegister(Register reg, int64_t val);
 
         void setFloatRegister(FloatRegister fReg, double val);
 
+        void setVectorRegister(VectorRegister vReg, const VectorRegister::Value& val);
+
         uint64_t getUpdatedProgramCounter() const;
 
         std::optional<int64_t> readMemory(uint64_t address);
 
+        // Addresses of finished memory reads, collected only when the cpu is tracing
+        const std::vector<uint64_t>& memoryReads() const {
+            return memoryReads_;
+        }
+
         void specifyWriteAddress(MemoryWrite::Id id, std::size_t address);
 
         void setWriteValue(MemoryWrite::Id id, uint64_t value);
 
         void writeMemory(MemoryWrite::Id);
 
+        // Used by atomic instructions, see Cpu::acquireLine
+        int64_t loadAtomic(uint64_t address);
+
+        void storeAtomic(uint64_t address, int64_t value);
+
         void processJump(bool taken);
 
+        // Outcome of the jump, empty for instructions which did not jump
+        std::optional<bool> branchTaken() const {
+            return branchTaken_;
+        }
+
         void setProgramCounter(uint64_t address);
 
         void setFlags(Alu::Flags flags);
@@ -139,8 +212,12 @@ namespace tiny::t86 {
 
         void logStallFloatRegisterFetch(FloatRegister fReg) const;
 
+        void logStallVectorRegisterFetch(VectorRegister vReg) const;
+
         void logStallRAMRead(uint64_t address) const;
 
+        void logStallSerialization() const;
+
         void logStallALU() const;
 
         void logExecuting() const;
@@ -149,6 +226,8 @@ namespace tiny::t86 {
 
         void logRetirement() const;
 
+        void logMispredict() const;
+
     private:
         bool allOperandsFetched() const;
 
@@ -170,6 +249,28 @@ namespace tiny::t86 {
 
         size_t remainingExecutionTime_;
 
+        std::size_t pc_;
+
         std::size_t loggingId_;
+
+        std::size_t thread_;
+
+        std::vector<uint64_t> memoryReads_;
+
+        // Addresses already shown to the prefetcher
+        std::vector<uint64_t> observedReads_;
+
+        std::optional<bool> branchTaken_;
+
+        struct ValuePrediction {
+            uint64_t address;
+            int64_t value;
+            // Empty until the read finishes
+            std::optional<int64_t> actual;
+        };
+
+        std::optional<ValuePrediction> valuePrediction_;
+
+        std::optional<int64_t> loadedValue_;
     };
 }
@@ -0,0 +1,43 @@
+#include "stride_prefetcher.h"
+
+#include <algorithm>
+
+namespace tiny::t86 {
+    StridePrefetcher::StridePrefetcher(std::size_t tableSize, std::size_t degree, std::size_t distance)
+            : table_(tableSize), degree_(degree), distance_(std::max<std::size_t>(distance, 1)) {}
+
+    void StridePrefetcher::observe(uint64_t pc, uint64_t address) {
+        auto& entry = table_[pc % table_.size()];
+        if (!entry || entry->pc != pc) {
+            entry = Entry{pc, address, 0, 0};
+            return;
+        }
+        int64_t stride = static_cast<int64_t>(address - entry->lastAddress);
+        entry->lastAddress = address;
+        if (stride == 0) {
+            // Same address again (e.g. a variable on the stack), nothing to prefetch
+            return;
+        }
+        if (stride != entry->stride) {
+            entry->stride = stride;
+            entry->confirmations = 0;
+            return;
+        }
+        if (entry->confirmations < confirmationsNeeded) {
+            ++entry->confirmations;
+        }
+        if (entry->confirmations < confirmationsNeeded) {
+            return;
+        }
+        for (std::size_t i = 0; i < degree_; ++i) {
+            uint64_t candidate = address + static_cast<uint64_t>(stride * static_cast<int64_t>(distance_ + i));
+            if (std::find(queue_.begin(), queue_.end(), candidate) != queue_.end()) {
+                continue;
+            }
+            if (queue_.size() == maxQueuedCandidates) {
+                queue_.pop_front();
+            }
+            queue_.push_back(candidate);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace tiny::t86 {
+    /**
+     * PC indexed stride prefetcher (reference prediction table)
+     *
+     * Every load instruction gets a direct mapped entry with its last address and stride.
+     * Once the same stride repeated confirmationsNeeded times in a row, addresses
+     * distance, distance + 1, ... distance + degree - 1 strides ahead are queued.
+     * The cpu issues queued prefetches only through RAM gates not used by demand reads.
+     */
+    class StridePrefetcher {
+    public:
+        StridePrefetcher(std::size_t tableSize, std::size_t degree, std::size_t distance);
+
+        // Called once for every address a load asks for
+        void observe(uint64_t pc, uint64_t address);
+
+        bool hasCandidate() const {
+            return !queue_.empty();
+        }
+
+        uint64_t nextCandidate() const {
+            return queue_.front();
+        }
+
+        void popCandidate() {
+            queue_.pop_front();
+        }
+
+        constexpr static std::size_t confirmationsNeeded = 1;
+
+        // Older candidates are dropped, they would most likely come too late
+        constexpr static std::size_t maxQueuedCandidates = 16;
+
+    private:
+        struct Entry {
+            uint64_t pc;
+            uint64_t lastAddress;
+            int64_t stride;
+            std::size_t confirmations;
+        };
+
+        std::vector<std::optional<Entry>> table_;
+
+        std::size_t degree_;
+
+        std::size_t distance_;
+
+        std::deque<uint64_t> queue_;
+    };
+}
@@ -0,0 +1,40 @@
+#include "value_predictor.h"
+
+namespace tiny::t86 {
+    ValuePredictor::ValuePredictor(std::size_t tableSize)
+            : table_(tableSize) {}
+
+    std::optional<int64_t> ValuePredictor::predict(uint64_t pc, std::size_t olderInFlight) const {
+        const auto& entry = table_[pc % table_.size()];
+        if (!entry || entry->pc != pc || entry->confirmations < confirmationsNeeded) {
+            return std::nullopt;
+        }
+        // Wraps around like the ALU does
+        return static_cast<int64_t>(static_cast<uint64_t>(entry->lastValue)
+                                    + static_cast<uint64_t>(entry->stride) * (olderInFlight + 1));
+    }
+
+    void ValuePredictor::distrust(uint64_t pc) {
+        if (auto& entry = table_[pc % table_.size()]; entry && entry->pc == pc) {
+            entry->confirmations = 0;
+        }
+    }
+
+    void ValuePredictor::train(uint64_t pc, int64_t value) {
+        auto& entry = table_[pc % table_.size()];
+        if (!entry || entry->pc != pc) {
+            entry = Entry{pc, value, 0, 0};
+            return;
+        }
+        int64_t stride = static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(entry->lastValue));
+        entry->lastValue = value;
+        if (stride != entry->stride) {
+            entry->stride = stride;
+            entry->confirmations = 0;
+            return;
+        }
+        if (entry->confirmations < confirmationsNeeded) {
+            ++entry->confirmations;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace tiny::t86 {
+    /**
+     * PC indexed last value / stride predictor of loaded values
+     *
+     * Every load instruction gets a direct mapped entry with the last value it loaded and the difference
+     * to the one before. Once the same stride repeated confirmationsNeeded times in a row, values
+     * of loads still waiting for the RAM are predicted as the last value plus a stride for the load
+     * and one for every older instance of it in flight (zero stride covers loads of the same value).
+     * The cpu trains the table with loaded values in retirement order.
+     */
+    class ValuePredictor {
+    public:
+        explicit ValuePredictor(std::size_t tableSize);
+
+        // Empty when the load is not confident enough
+        std::optional<int64_t> predict(uint64_t pc, std::size_t olderInFlight) const;
+
+        void train(uint64_t pc, int64_t value);
+
+        // Confirmations of the load start over
+        void distrust(uint64_t pc);
+
+        constexpr static std::size_t confirmationsNeeded = 2;
+
+    private:
+        struct Entry {
+            uint64_t pc;
+            int64_t lastValue;
+            int64_t stride;
+            std::size_t confirmations;
+        };
+
+        std::vector<std::optional<Entry>> table_;
+    };
+}
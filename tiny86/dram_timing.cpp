@@ -0,0 +1,88 @@
+#include <stdexcept>
+
+#include "dram_timing.h"
+#include "utils/stats_logger.h"
+
+using tiny::t86::StatsLogger;
+
+DramTiming::Mapping DramTiming::Config::parseMapping(const std::string& text) {
+    if (text == "RoBaCo") {
+        return Mapping::rowBankColumn;
+    }
+    if (text == "RoCoBa") {
+        return Mapping::rowColumnBank;
+    }
+    throw std::invalid_argument("Unknown DRAM address mapping " + text + ", expected RoBaCo or RoCoBa");
+}
+
+DramTiming::DramTiming(const Config& config) : config_(config), banks_(config.banks) {
+    if (config.banks == 0 || config.rowSize == 0) {
+        throw std::invalid_argument("DRAM needs at least one bank and a nonempty row");
+    }
+}
+
+void DramTiming::enqueue(std::size_t address, bool write) {
+    Request request{address, write, 0, 0};
+    if (config_.mapping == Mapping::rowBankColumn) {
+        request.bank = address / config_.rowSize % config_.banks;
+    } else {
+        request.bank = address % config_.banks;
+    }
+    request.row = address / (config_.rowSize * config_.banks);
+    queue_.push_back(request);
+}
+
+const std::vector<DramTiming::Started>& DramTiming::schedule() {
+    started_.clear();
+    for (auto& bank : banks_) {
+        if (bank.busy > 0) {
+            --bank.busy;
+        }
+    }
+    for (std::size_t b = 0; b < banks_.size(); ++b) {
+        Bank& bank = banks_[b];
+        if (bank.busy > 0) {
+            continue;
+        }
+        auto chosen = queue_.end();
+        for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+            if (it->bank != b) {
+                continue;
+            }
+            if (bank.openRow == it->row) {
+                chosen = it;
+                break;
+            }
+            if (chosen == queue_.end()) {
+                chosen = it;
+            }
+        }
+        if (chosen == queue_.end()) {
+            continue;
+        }
+        RowOutcome outcome;
+        std::size_t latency = config_.cas;
+        if (!bank.openRow) {
+            outcome = RowOutcome::empty;
+            latency += config_.rcd;
+        } else if (*bank.openRow == chosen->row) {
+            outcome = RowOutcome::hit;
+        } else {
+            outcome = RowOutcome::conflict;
+            latency += config_.rp + config_.rcd;
+        }
+        bank.openRow = chosen->row;
+        bank.busy = latency;
+        started_.push_back({chosen->address, chosen->write, latency});
+        StatsLogger::instance().logDramAccess(b, outcome, chosen->write);
+        queue_.erase(chosen);
+    }
+    for (auto& request : queue_) {
+        if (!request.blocked && banks_[request.bank].busy > 0) {
+            request.blocked = true;
+            StatsLogger::instance().logDramBankConflict();
+        }
+    }
+    StatsLogger::instance().logDramQueued(queue_.size());
+    return started_;
+}
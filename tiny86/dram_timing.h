@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <optional>
+#include <string>
+#include <cstddef>
+
+/**
+ * Timing of DRAM banks and their row buffers
+ *
+ * Addresses are split into bank, row and column by the mapping. Every bank keeps its last row open,
+ * access to the open row costs only cas, access to a bank without open row rcd + cas
+ * and access to other row rp + rcd + cas. A bank serves one request at a time.
+ * Pending requests are scheduled FR-FCFS - for every idle bank the oldest request hitting
+ * the open row goes first, otherwise the oldest request for the bank.
+ * Only timing is modelled, values are kept by RAM.
+ */
+class DramTiming {
+public:
+    enum class Mapping {
+        // Consecutive addresses stay in the same row of one bank
+        rowBankColumn,
+        // Consecutive addresses are spread over banks
+        rowColumnBank
+    };
+
+    struct Config {
+        std::size_t banks;
+
+        // In words
+        std::size_t rowSize;
+
+        std::size_t cas;
+
+        std::size_t rcd;
+
+        std::size_t rp;
+
+        Mapping mapping{Mapping::rowBankColumn};
+
+        // Accepts RoBaCo and RoCoBa, throws std::invalid_argument
+        static Mapping parseMapping(const std::string& text);
+    };
+
+    enum class RowOutcome {
+        hit, empty, conflict
+    };
+
+    struct Started {
+        std::size_t address;
+        bool write;
+        std::size_t latency;
+    };
+
+    // Throws std::invalid_argument for zero banks or row size
+    explicit DramTiming(const Config& config);
+
+    void enqueue(std::size_t address, bool write);
+
+    // Advances the banks by one tick and returns requests whose service started
+    const std::vector<Started>& schedule();
+
+private:
+    struct Request {
+        std::size_t address;
+        bool write;
+        std::size_t bank;
+        std::size_t row;
+        // Already counted as bank conflict
+        bool blocked{false};
+    };
+
+    struct Bank {
+        std::optional<std::size_t> openRow;
+        std::size_t busy{0};
+    };
+
+    Config config_;
+
+    // Oldest first
+    std::list<Request> queue_;
+
+    std::vector<Bank> banks_;
+
+    std::vector<Started> started_;
+};
@@ -129,6 +129,64 @@ namespace tiny::t86 {
                 return "EXT";
             case Type::NRW:
                 return "NRW";
+            case Type::XADD:
+                return "XADD";
+            case Type::XCHG:
+                return "XCHG";
+            case Type::FENCE:
+                return "FENCE";
+            case Type::VADD:
+                return "VADD";
+            case Type::VMUL:
+                return "VMUL";
+            case Type::VFADD:
+                return "VFADD";
+            case Type::VFMUL:
+                return "VFMUL";
+            case Type::VLOAD:
+                return "VLOAD";
+            case Type::VSTORE:
+                return "VSTORE";
+            case Type::VBROADCAST:
+                return "VBROADCAST";
+            case Type::VREDUCE:
+                return "VREDUCE";
+            case Type::VFREDUCE:
+                return "VFREDUCE";
+            case Type::CMOVZ:
+                return "CMOVZ";
+            case Type::CMOVNZ:
+                return "CMOVNZ";
+            case Type::CMOVE:
+                return "CMOVE";
+            case Type::CMOVNE:
+                return "CMOVNE";
+            case Type::CMOVG:
+                return "CMOVG";
+            case Type::CMOVGE:
+                return "CMOVGE";
+            case Type::CMOVL:
+                return "CMOVL";
+            case Type::CMOVLE:
+                return "CMOVLE";
+            case Type::CMOVA:
+                return "CMOVA";
+            case Type::CMOVAE:
+                return "CMOVAE";
+            case Type::CMOVB:
+                return "CMOVB";
+            case Type::CMOVBE:
+                return "CMOVBE";
+            case Type::CMOVO:
+                return "CMOVO";
+            case Type::CMOVNO:
+                return "CMOVNO";
+            case Type::CMOVS:
+                return "CMOVS";
+            case Type::CMOVNS:
+                return "CMOVNS";
+            case Type::RDPMC:
+                return "RDPMC";
         }
         throw std::runtime_error("Unhandled instruction type");
     }
@@ -461,6 +519,54 @@ INS_NAME::INS_NAME(Memory::RegisterOffset address) : ConditionalJumpInstruction(
 
     COND_JMP_INS_IMPL(JNS, !flags.signFlag)
 
+    void ConditionalMoveInstruction::validate() const {
+        if (reg_.isSpecial()) {
+            throw InvalidOperand(reg_);
+        }
+    }
+
+    void ConditionalMoveInstruction::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        assert(operands.size() == 3);
+        entry.setRegister(reg_, condition_(operands[2].getValue()) ? operands[1].getValue() : operands[0].getValue());
+    }
+
+#define COND_MOV_INS_IMPL(INS_NAME, CONDITION) \
+INS_NAME::INS_NAME(Register reg, Register val) : ConditionalMoveInstruction([](Alu::Flags flags) { return CONDITION; }, reg, val) {} \
+INS_NAME::INS_NAME(Register reg, int64_t val) : ConditionalMoveInstruction([](Alu::Flags flags) { return CONDITION; }, reg, val) {}
+
+    COND_MOV_INS_IMPL(CMOVZ, flags.zeroFlag)
+
+    COND_MOV_INS_IMPL(CMOVNZ, !flags.zeroFlag)
+
+    COND_MOV_INS_IMPL(CMOVE, flags.zeroFlag)
+
+    COND_MOV_INS_IMPL(CMOVNE, !flags.zeroFlag)
+
+    COND_MOV_INS_IMPL(CMOVG, !flags.zeroFlag && (flags.signFlag == flags.overflowFlag))
+
+    COND_MOV_INS_IMPL(CMOVGE, flags.signFlag == flags.overflowFlag)
+
+    COND_MOV_INS_IMPL(CMOVL, flags.signFlag != flags.overflowFlag)
+
+    COND_MOV_INS_IMPL(CMOVLE, flags.zeroFlag || flags.signFlag != flags.overflowFlag)
+
+    COND_MOV_INS_IMPL(CMOVA, !(flags.carryFlag || flags.zeroFlag))
+
+    COND_MOV_INS_IMPL(CMOVAE, !flags.carryFlag)
+
+    COND_MOV_INS_IMPL(CMOVB, flags.carryFlag)
+
+    COND_MOV_INS_IMPL(CMOVBE, flags.carryFlag || flags.zeroFlag)
+
+    COND_MOV_INS_IMPL(CMOVO, flags.overflowFlag)
+
+    COND_MOV_INS_IMPL(CMOVNO, !flags.overflowFlag)
+
+    COND_MOV_INS_IMPL(CMOVS, flags.signFlag)
+
+    COND_MOV_INS_IMPL(CMOVNS, !flags.signFlag)
+
     void CMP::execute(ReservationStation::Entry& entry) const {
         const auto& operands = entry.operands();
         assert(operands.size() == 2);
@@ -595,17 +701,36 @@ INS_NAME::INS_NAME(Memory::RegisterOffset address) : ConditionalJumpInstruction(
 
     void DBG::retire(ReservationStation::Entry& entry) const {
         entry.unrollSpeculation();
-        debugFunction_(entry.cpu());
+        Cpu& cpu = entry.cpu();
+        cpu.selectDebugThread(entry.thread());
+        if (print_) {
+            // Goes through the console like PUTCHAR, so it stays ordered with it and can be captured
+            std::ostringstream ss;
+            if (print_->isRegister()) {
+                ss << cpu.getRegister(print_->getRegister());
+            } else {
+                ss << cpu.getFloatRegister(print_->getFloatRegister());
+            }
+            for (char c : ss.str()) {
+                cpu.io().put(c);
+            }
+            cpu.io().put('\n');
+        }
+        if (debugFunction_) {
+            cpu.io().flush();
+            debugFunction_(cpu);
+        }
     }
 
     void BREAK::retire(ReservationStation::Entry& entry) const {
         entry.unrollSpeculation();
+        entry.cpu().selectDebugThread(entry.thread());
         entry.cpu().doBreak();
     }
 
     void HALT::retire(ReservationStation::Entry& entry) const {
         entry.unrollSpeculation();
-        entry.cpu().halt();
+        entry.cpu().halt(entry.thread());
     }
 
     void PatchableJumpInstruction::setDestination(uint64_t address) {
@@ -694,13 +819,50 @@ INS_NAME::INS_NAME(Memory::RegisterOffset address) : ConditionalJumpInstruction(
     void PUTCHAR::retire(ReservationStation::Entry& entry) const {
         const auto& operands = entry.operands();
         assert(operands.size() == 1);
-        os_ << static_cast<char>(operands[0].getValue()) << std::flush;
+        entry.cpu().io().put(static_cast<char>(operands[0].getValue()));
     }
 
     void GETCHAR::retire(ReservationStation::Entry& entry) const {
-        char c;
-        is_ >> c;
-        entry.setRegister(reg_, c);
+        entry.setRegister(reg_, entry.cpu().io().get());
+    }
+
+    void AtomicInstruction::validate() const {
+        if (reg_.isSpecial()) {
+            throw InvalidOperand(reg_);
+        }
+    }
+
+    std::vector<Operand> AtomicInstruction::operands() const {
+        if (mem_.isMemoryImmediate()) {
+            return { reg_ };
+        }
+        else if (mem_.isMemoryRegister()) {
+            return { reg_, mem_.getMemoryRegister().reg() };
+        }
+        else if (mem_.isMemoryRegisterOffset()) {
+            return { reg_, mem_.getMemoryRegisterOffset().regOffset().reg() };
+        }
+        throw std::runtime_error("Unhandled memory operand type");
+    }
+
+    uint64_t AtomicInstruction::address(const ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        if (mem_.isMemoryImmediate()) {
+            return mem_.getMemoryImmediate().index();
+        }
+        assert(operands.size() == 2);
+        if (mem_.isMemoryRegister()) {
+            return Operand::supply(mem_.getMemoryRegister(), operands[1].getValue()).index();
+        }
+        return Operand::supply(mem_.getMemoryRegisterOffset(), operands[1].getValue()).index();
+    }
+
+    void AtomicInstruction::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        uint64_t address = this->address(entry);
+        int64_t old = entry.loadAtomic(address);
+        entry.storeAtomic(address, combine(old, operands[0].getValue()));
+        entry.setRegister(reg_, old);
     }
 
     void EXT::execute(ReservationStation::Entry& entry) const {
@@ -714,4 +876,170 @@ INS_NAME::INS_NAME(Memory::RegisterOffset address) : ConditionalJumpInstruction(
         assert(operands.size() == 1);
         entry.setRegister(reg_, static_cast<int64_t>(operands[0].getFloatValue()));
     }
+
+    namespace {
+        // Double lanes are stored bitwise, the same way float registers are
+        double laneToDouble(int64_t lane) {
+            return *reinterpret_cast<double*>(&lane);
+        }
+
+        int64_t doubleToLane(double value) {
+            return *reinterpret_cast<int64_t*>(&value);
+        }
+
+        // Base address of the vector memory operand, the register value is the operand following the ones in front
+        uint64_t vectorAddress(const Operand& mem, const std::vector<Operand>& operands, std::size_t regOperand) {
+            if (mem.isMemoryImmediate()) {
+                return mem.getMemoryImmediate().index();
+            }
+            assert(operands.size() > regOperand);
+            if (mem.isMemoryRegister()) {
+                return Operand::supply(mem.getMemoryRegister(), operands[regOperand].getValue()).index();
+            }
+            return Operand::supply(mem.getMemoryRegisterOffset(), operands[regOperand].getValue()).index();
+        }
+    }
+
+    void VectorArithmeticInstruction::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        assert(operands.size() == 2);
+        VectorRegister::Value result = operands[0].getVectorValue();
+        const VectorRegister::Value& val = operands[1].getVectorValue();
+        for (std::size_t i = 0; i < VectorRegister::lanes; ++i) {
+            result[i] = op_(result[i], val[i]);
+        }
+        entry.setVectorRegister(vReg_, result);
+    }
+
+#define VECTOR_ARITH_INS_IMPL(INS_NAME, OP)                                                                      \
+    INS_NAME::INS_NAME(VectorRegister vReg, VectorRegister val)                                                 \
+        : VectorArithmeticInstruction([](int64_t left, int64_t right) { return OP; }, vReg, val) {}
+
+    VECTOR_ARITH_INS_IMPL(VADD, left + right)
+
+    VECTOR_ARITH_INS_IMPL(VMUL, left * right)
+
+    VECTOR_ARITH_INS_IMPL(VFADD, doubleToLane(laneToDouble(left) + laneToDouble(right)))
+
+    VECTOR_ARITH_INS_IMPL(VFMUL, doubleToLane(laneToDouble(left) * laneToDouble(right)))
+
+    std::vector<Operand> VLOAD::operands() const {
+        std::vector<Operand> result;
+        result.reserve(VectorRegister::lanes);
+        for (std::size_t i = 0; i < VectorRegister::lanes; ++i) {
+            auto offset = static_cast<int64_t>(i);
+            if (mem_.isMemoryImmediate()) {
+                result.emplace_back(Memory::Immediate(mem_.getMemoryImmediate().index() + i));
+            } else if (mem_.isMemoryRegister()) {
+                result.emplace_back(Memory::RegisterOffset(RegisterOffset(mem_.getMemoryRegister().reg(), offset)));
+            } else if (mem_.isMemoryRegisterOffset()) {
+                const auto& regOffset = mem_.getMemoryRegisterOffset().regOffset();
+                result.emplace_back(Memory::RegisterOffset(RegisterOffset(regOffset.reg(), regOffset.offset() + offset)));
+            } else {
+                throw std::runtime_error("Unhandled memory operand type");
+            }
+        }
+        return result;
+    }
+
+    void VLOAD::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        assert(operands.size() == VectorRegister::lanes);
+        VectorRegister::Value value;
+        for (std::size_t i = 0; i < VectorRegister::lanes; ++i) {
+            value[i] = operands[i].getValue();
+        }
+        entry.setVectorRegister(vReg_, value);
+    }
+
+    std::vector<Operand> VSTORE::operands() const {
+        if (mem_.isMemoryImmediate()) {
+            return { vReg_ };
+        } else if (mem_.isMemoryRegister()) {
+            return { vReg_, mem_.getMemoryRegister().reg() };
+        } else if (mem_.isMemoryRegisterOffset()) {
+            return { vReg_, mem_.getMemoryRegisterOffset().regOffset().reg() };
+        }
+        throw std::runtime_error("Unhandled memory operand type");
+    }
+
+    std::vector<Product> VSTORE::produces() const {
+        std::vector<Product> result;
+        result.reserve(VectorRegister::lanes);
+        for (std::size_t i = 0; i < VectorRegister::lanes; ++i) {
+            if (mem_.isMemoryImmediate()) {
+                result.emplace_back(Memory::Immediate(mem_.getMemoryImmediate().index() + i));
+            } else {
+                result.push_back(Product::fromOperand(mem_));
+            }
+        }
+        return result;
+    }
+
+    void VSTORE::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        const auto& memWriteIds = entry.memoryWriteIds();
+        assert(memWriteIds.size() == VectorRegister::lanes);
+        const VectorRegister::Value& value = operands[0].getVectorValue();
+        uint64_t address = vectorAddress(mem_, operands, 1);
+        for (std::size_t i = 0; i < VectorRegister::lanes; ++i) {
+            if (!mem_.isMemoryImmediate()) {
+                entry.specifyWriteAddress(memWriteIds[i], address + i);
+            }
+            entry.setWriteValue(memWriteIds[i], value[i]);
+        }
+    }
+
+    void VSTORE::retire(ReservationStation::Entry& entry) const {
+        for (MemoryWrite::Id id : entry.memoryWriteIds()) {
+            entry.writeMemory(id);
+        }
+    }
+
+    void VBROADCAST::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        assert(operands.size() == 1);
+        VectorRegister::Value value;
+        value.fill(operands[0].getValue());
+        entry.setVectorRegister(vReg_, value);
+    }
+
+    void RDPMC::validate() const {
+        if (reg_.isSpecial()) {
+            throw InvalidOperand(reg_);
+        }
+        if (counter_ < 0 || counter_ >= static_cast<int64_t>(Cpu::performanceCountersCnt)) {
+            throw std::invalid_argument("Unknown performance counter " + std::to_string(counter_));
+        }
+    }
+
+    void RDPMC::execute(ReservationStation::Entry& entry) const {
+        entry.setRegister(reg_, entry.cpu().performanceCounter(entry.thread(), static_cast<Cpu::PerformanceCounter>(counter_)));
+    }
+
+    void VREDUCE::validate() const {
+        if (reg_.isSpecial()) {
+            throw InvalidOperand(reg_);
+        }
+    }
+
+    void VREDUCE::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        assert(operands.size() == 1);
+        int64_t sum = 0;
+        for (int64_t lane : operands[0].getVectorValue()) {
+            sum += lane;
+        }
+        entry.setRegister(reg_, sum);
+    }
+
+    void VFREDUCE::execute(ReservationStation::Entry& entry) const {
+        const auto& operands = entry.operands();
+        assert(operands.size() == 1);
+        double sum = 0;
+        for (int64_t lane : operands[0].getVectorValue()) {
+            sum += laneToDouble(lane);
+        }
+        entry.setFloatRegister(fReg_, sum);
+    }
 }
@@ -11,6 +11,7 @@
 #include <vector>
 #include <stdexcept>
 #include <functional>
+#include <optional>
 #include <string>
 #include <iostream>
 
@@ -80,6 +81,35 @@ namespace tiny::t86 {
             FDIV,
             EXT,
             NRW,
+            XADD,
+            XCHG,
+            FENCE,
+            VADD,
+            VMUL,
+            VFADD,
+            VFMUL,
+            VLOAD,
+            VSTORE,
+            VBROADCAST,
+            VREDUCE,
+            VFREDUCE,
+            CMOVZ,
+            CMOVNZ,
+            CMOVE,
+            CMOVNE,
+            CMOVG,
+            CMOVGE,
+            CMOVL,
+            CMOVLE,
+            CMOVA,
+            CMOVAE,
+            CMOVB,
+            CMOVBE,
+            CMOVO,
+            CMOVNO,
+            CMOVS,
+            CMOVNS,
+            RDPMC,
         };
 
         struct Signature {
@@ -101,6 +131,17 @@ namespace tiny::t86 {
 
         virtual bool needsAlu() const = 0;
 
+        // Vector arithmetic, broadcasts and reductions run on vector units instead of the ALUs
+        virtual bool needsVectorUnit() const {
+            return false;
+        }
+
+        // Starts only as the oldest instruction of its thread once all previous writes are finished,
+        // later instructions of the thread are not dispatched meanwhile
+        virtual bool serializing() const {
+            return false;
+        }
+
         virtual void validate() const {}
 
         virtual void execute(ReservationStation::Entry& entry) const = 0;
@@ -648,6 +689,55 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
         FloatRegister fReg_;
     };
 
+    class FENCE : public NoOpInstruction {
+    public:
+        Type type() const override { return Type::FENCE; }
+
+        bool serializing() const override {
+            return true;
+        }
+
+        void retire(ReservationStation::Entry&) const override {}
+    };
+
+    /**
+     * Reads performance counter of the executing thread, see Cpu::PerformanceCounter for the numbers
+     * Serializing, so the counter covers exactly the instructions before it
+     */
+    class RDPMC : public NoAluInstruction {
+    public:
+        RDPMC(Register reg, int64_t counter) : reg_(reg), counter_(counter) {}
+
+        Type type() const override { return Type::RDPMC; }
+
+        bool serializing() const override {
+            return true;
+        }
+
+        void validate() const override;
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+        std::vector<Operand> operands() const override {
+            return {};
+        }
+
+        std::vector<Operand> signatureOperands() const override {
+            return { reg_, counter_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { reg_ };
+        }
+
+    private:
+        Register reg_;
+
+        int64_t counter_;
+    };
+
     class BREAK : public NoOpInstruction {
     public:
         Type type() const override { return Type::BREAK; }
@@ -657,15 +747,34 @@ class INS_NAME : public UnaryArithmeticInstruction {      \
 
     class DBG : public NoOpInstruction {
     public:
+        /// Does nothing but clear the pipeline
+        DBG() = default;
+
         DBG(std::function<void(Cpu&)> debugFunction)
                 : debugFunction_(std::move(debugFunction)) {}
 
+        /// Prints the architectural value of the register on its own line to the console
+        DBG(Register reg) : print_(reg) {}
+
+        DBG(FloatRegister fReg) : print_(fReg) {}
+
         Type type() const override { return Type::DBG; }
 
         void retire(ReservationStation::Entry& entry) const override;
 
+        std::vector<Operand> signatureOperands() const override {
+            if (print_) {
+                return { *print_ };
+            }
+            return {};
+        }
+
+        /// Host function DBGs have no textual form
+        bool hasDebugFunction() const { return static_cast<bool>(debugFunction_); }
+
     private:
         std::function<void(Cpu&)> debugFunction_;
+        std::optional<Operand> print_;
     };
 
     class JumpInstruction : public NoAluInstruction {
@@ -793,6 +902,89 @@ class INS_NAME : public ConditionalJumpInstruction {          \
 
     COND_JMP_INS_DECL(JNS)
 
+    /**
+     * Moves the value into the register when the condition on Flags holds, otherwise keeps the register
+     * Reads the register, the value and Flags, so it waits for all three like an ALU operation
+     * Flags are not changed
+     */
+    class ConditionalMoveInstruction : public Instruction {
+    public:
+        ConditionalMoveInstruction(std::function<bool(Alu::Flags)> condition, Register reg, Register val)
+                : condition_(std::move(condition)), reg_(reg), val_(val) {}
+
+        ConditionalMoveInstruction(std::function<bool(Alu::Flags)> condition, Register reg, int64_t val)
+                : condition_(std::move(condition)), reg_(reg), val_(val) {}
+
+        bool needsAlu() const override {
+            return true;
+        }
+
+        void validate() const override;
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+        std::vector<Operand> operands() const override {
+            return { reg_, val_, Register::Flags() };
+        }
+
+        std::vector<Operand> signatureOperands() const override {
+            return { reg_, val_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { reg_ };
+        }
+
+    protected:
+        std::function<bool(Alu::Flags)> condition_;
+
+        Register reg_;
+
+        Operand val_;
+    };
+
+#define COND_MOV_INS_DECL(INS_NAME)                           \
+class INS_NAME : public ConditionalMoveInstruction {          \
+    public:                                                   \
+        INS_NAME(Register reg, Register val);                 \
+        INS_NAME(Register reg, int64_t val);                  \
+        Type type() const override { return Type::INS_NAME; } \
+};
+
+    COND_MOV_INS_DECL(CMOVZ)
+
+    COND_MOV_INS_DECL(CMOVNZ)
+
+    COND_MOV_INS_DECL(CMOVE)
+
+    COND_MOV_INS_DECL(CMOVNE)
+
+    COND_MOV_INS_DECL(CMOVG)
+
+    COND_MOV_INS_DECL(CMOVGE)
+
+    COND_MOV_INS_DECL(CMOVL)
+
+    COND_MOV_INS_DECL(CMOVLE)
+
+    COND_MOV_INS_DECL(CMOVA)
+
+    COND_MOV_INS_DECL(CMOVAE)
+
+    COND_MOV_INS_DECL(CMOVB)
+
+    COND_MOV_INS_DECL(CMOVBE)
+
+    COND_MOV_INS_DECL(CMOVO)
+
+    COND_MOV_INS_DECL(CMOVNO)
+
+    COND_MOV_INS_DECL(CMOVS)
+
+    COND_MOV_INS_DECL(CMOVNS)
+
     class LOOP : public PatchableJumpInstruction {
     public:
         LOOP(Register reg, Register address)
@@ -926,7 +1118,7 @@ class INS_NAME : public ConditionalJumpInstruction {          \
 
     class PUTCHAR : public Instruction {
     public:
-        PUTCHAR(Register reg, std::ostream& os = std::cout) : reg_(reg), os_(os) {}
+        PUTCHAR(Register reg) : reg_(reg) {}
 
         Type type() const override { return Type::PUTCHAR; }
 
@@ -948,13 +1140,11 @@ class INS_NAME : public ConditionalJumpInstruction {          \
 
     private:
         Register reg_;
-
-        std::ostream& os_;
     };
 
     class GETCHAR : public Instruction {
     public:
-        GETCHAR(Register reg, std::istream& is = std::cin) : reg_(reg), is_(is) {}
+        GETCHAR(Register reg) : reg_(reg) {}
 
         Type type() const override { return Type::GETCHAR; }
 
@@ -980,8 +1170,84 @@ class INS_NAME : public ConditionalJumpInstruction {          \
 
     private:
         Register reg_;
+    };
+
+    /**
+     * Read-modify-write of a memory word, the register gets the previous value of the word
+     *
+     * The instruction is serializing and starts only once its core owns the word (see Cpu::acquireLine),
+     * the word is then kept until the write, so no other core can access it in between.
+     */
+    class AtomicInstruction : public Instruction {
+    public:
+        AtomicInstruction(Memory::Immediate mem, Register reg) : mem_(mem), reg_(reg) {}
+
+        AtomicInstruction(Memory::Register mem, Register reg) : mem_(mem), reg_(reg) {}
+
+        AtomicInstruction(Memory::RegisterOffset mem, Register reg) : mem_(mem), reg_(reg) {}
+
+        bool serializing() const override {
+            return true;
+        }
+
+        void validate() const override;
+
+        std::vector<Operand> operands() const override;
+
+        std::vector<Operand> signatureOperands() const override {
+            return { mem_, reg_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { reg_ };
+        }
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+        // Operands of the entry must be already fetched
+        uint64_t address(const ReservationStation::Entry& entry) const;
+
+    protected:
+        // New value of the word
+        virtual int64_t combine(int64_t old, int64_t value) const = 0;
+
+    private:
+        Operand mem_;
+        Register reg_;
+    };
+
+    class XADD : public AtomicInstruction {
+    public:
+        using AtomicInstruction::AtomicInstruction;
+
+        Type type() const override { return Type::XADD; }
 
-        std::istream& is_;
+        bool needsAlu() const override {
+            return true;
+        }
+
+    protected:
+        int64_t combine(int64_t old, int64_t value) const override {
+            return old + value;
+        }
+    };
+
+    class XCHG : public AtomicInstruction {
+    public:
+        using AtomicInstruction::AtomicInstruction;
+
+        Type type() const override { return Type::XCHG; }
+
+        bool needsAlu() const override {
+            return false;
+        }
+
+    protected:
+        int64_t combine(int64_t, int64_t value) const override {
+            return value;
+        }
     };
 
     class EXT : public Instruction {
@@ -1045,4 +1311,241 @@ class INS_NAME : public ConditionalJumpInstruction {          \
         Register reg_;
         FloatRegister fReg_;
     };
+
+    /**
+     * Lane-wise operation on two vector registers, the result is stored into the first one
+     * Flags are not changed
+     */
+    class VectorArithmeticInstruction : public Instruction {
+    public:
+        VectorArithmeticInstruction(std::function<int64_t(int64_t, int64_t)> op, VectorRegister vReg, VectorRegister val)
+                : op_(std::move(op)), vReg_(vReg), val_(val) {}
+
+        bool needsAlu() const override {
+            return false;
+        }
+
+        bool needsVectorUnit() const override {
+            return true;
+        }
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+        std::vector<Operand> operands() const override {
+            return { vReg_, val_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { vReg_ };
+        }
+
+    private:
+        std::function<int64_t(int64_t, int64_t)> op_;
+
+        VectorRegister vReg_;
+
+        VectorRegister val_;
+    };
+
+#define VECTOR_ARITH_INS_DECL(INS_NAME)                          \
+    class INS_NAME : public VectorArithmeticInstruction {        \
+    public:                                                      \
+        INS_NAME(VectorRegister vReg, VectorRegister val);       \
+        Type type() const override { return Type::INS_NAME; }    \
+    };
+
+    VECTOR_ARITH_INS_DECL(VADD)
+
+    VECTOR_ARITH_INS_DECL(VMUL)
+
+    VECTOR_ARITH_INS_DECL(VFADD)
+
+    VECTOR_ARITH_INS_DECL(VFMUL)
+
+    /**
+     * Loads VectorRegister::lanes consecutive words starting at the address,
+     * every lane is read on its own like any other memory operand
+     */
+    class VLOAD : public NoAluInstruction {
+    public:
+        VLOAD(VectorRegister vReg, Memory::Immediate mem) : vReg_(vReg), mem_(mem) {}
+
+        VLOAD(VectorRegister vReg, Memory::Register mem) : vReg_(vReg), mem_(mem) {}
+
+        VLOAD(VectorRegister vReg, Memory::RegisterOffset mem) : vReg_(vReg), mem_(mem) {}
+
+        Type type() const override { return Type::VLOAD; }
+
+        std::vector<Operand> operands() const override;
+
+        std::vector<Operand> signatureOperands() const override {
+            return { vReg_, mem_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { vReg_ };
+        }
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+    private:
+        VectorRegister vReg_;
+        Operand mem_;
+    };
+
+    /**
+     * Stores the lanes into VectorRegister::lanes consecutive words starting at the address
+     */
+    class VSTORE : public NoAluInstruction {
+    public:
+        VSTORE(Memory::Immediate mem, VectorRegister vReg) : mem_(mem), vReg_(vReg) {}
+
+        VSTORE(Memory::Register mem, VectorRegister vReg) : mem_(mem), vReg_(vReg) {}
+
+        VSTORE(Memory::RegisterOffset mem, VectorRegister vReg) : mem_(mem), vReg_(vReg) {}
+
+        Type type() const override { return Type::VSTORE; }
+
+        std::vector<Operand> operands() const override;
+
+        std::vector<Operand> signatureOperands() const override {
+            return { mem_, vReg_ };
+        }
+
+        std::vector<Product> produces() const override;
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry& entry) const override;
+
+    private:
+        Operand mem_;
+        VectorRegister vReg_;
+    };
+
+    /**
+     * Copies the value into all lanes, a float value is copied bitwise
+     */
+    class VBROADCAST : public Instruction {
+    public:
+        VBROADCAST(VectorRegister vReg, Register val) : vReg_(vReg), val_(val) {}
+
+        VBROADCAST(VectorRegister vReg, FloatRegister val) : vReg_(vReg), val_(val) {}
+
+        VBROADCAST(VectorRegister vReg, int64_t val) : vReg_(vReg), val_(val) {}
+
+        VBROADCAST(VectorRegister vReg, double val) : vReg_(vReg), val_(val) {}
+
+        Type type() const override { return Type::VBROADCAST; }
+
+        bool needsAlu() const override {
+            return false;
+        }
+
+        bool needsVectorUnit() const override {
+            return true;
+        }
+
+        std::vector<Operand> operands() const override {
+            return { val_ };
+        }
+
+        std::vector<Operand> signatureOperands() const override {
+            return { vReg_, val_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { vReg_ };
+        }
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+    private:
+        VectorRegister vReg_;
+        Operand val_;
+    };
+
+    /**
+     * Sums integer lanes of the vector register into the register
+     */
+    class VREDUCE : public Instruction {
+    public:
+        VREDUCE(Register reg, VectorRegister vReg) : reg_(reg), vReg_(vReg) {}
+
+        Type type() const override { return Type::VREDUCE; }
+
+        bool needsAlu() const override {
+            return false;
+        }
+
+        bool needsVectorUnit() const override {
+            return true;
+        }
+
+        void validate() const override;
+
+        std::vector<Operand> operands() const override {
+            return { vReg_ };
+        }
+
+        std::vector<Operand> signatureOperands() const override {
+            return { reg_, vReg_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { reg_ };
+        }
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+    private:
+        Register reg_;
+        VectorRegister vReg_;
+    };
+
+    /**
+     * Sums double lanes of the vector register into the float register
+     */
+    class VFREDUCE : public Instruction {
+    public:
+        VFREDUCE(FloatRegister fReg, VectorRegister vReg) : fReg_(fReg), vReg_(vReg) {}
+
+        Type type() const override { return Type::VFREDUCE; }
+
+        bool needsAlu() const override {
+            return false;
+        }
+
+        bool needsVectorUnit() const override {
+            return true;
+        }
+
+        std::vector<Operand> operands() const override {
+            return { vReg_ };
+        }
+
+        std::vector<Operand> signatureOperands() const override {
+            return { fReg_, vReg_ };
+        }
+
+        std::vector<Product> produces() const override {
+            return { fReg_ };
+        }
+
+        void execute(ReservationStation::Entry& entry) const override;
+
+        void retire(ReservationStation::Entry&) const override {}
+
+    private:
+        FloatRegister fReg_;
+        VectorRegister vReg_;
+    };
 }
@@ -1,7 +1,11 @@
 #include "operand.h"
 #include "../cpu/memory.h"
 
+#include <algorithm>
 #include <cassert>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 
 
 namespace tiny::t86 {
@@ -42,6 +46,10 @@ namespace tiny::t86 {
 
     Operand::Operand(const FloatRegister& fReg) : value_(fReg) {}
 
+    Operand::Operand(const VectorRegister& vReg) : value_(vReg) {}
+
+    Operand::Operand(const VectorRegister::Value& value) : value_(value) {}
+
     int64_t Operand::getValue() const {
         assert(isValue() || isFloatValue());
         if (isFloatValue()) {
@@ -105,6 +113,14 @@ namespace tiny::t86 {
         }
     }
 
+    void Operand::supply(const VectorRegister::Value& val) {
+        if (isVectorRegister()) {
+            value_ = val;
+        } else {
+            throw std::runtime_error("Unhandled operand type");
+        }
+    }
+
     bool Operand::isValue() const {
         return std::holds_alternative<int64_t>(value_);
     }
@@ -113,6 +129,10 @@ namespace tiny::t86 {
         return std::holds_alternative<double>(value_);
     }
 
+    bool Operand::isVectorValue() const {
+        return std::holds_alternative<VectorRegister::Value>(value_);
+    }
+
     bool Operand::isRegister() const {
         return std::holds_alternative<Register>(value_);
     }
@@ -177,6 +197,15 @@ namespace tiny::t86 {
         return std::holds_alternative<FloatRegister>(value_);
     }
 
+    bool Operand::isVectorRegister() const {
+        return std::holds_alternative<VectorRegister>(value_);
+    }
+
+    const VectorRegister::Value& Operand::getVectorValue() const {
+        assert(isVectorValue());
+        return std::get<VectorRegister::Value>(value_);
+    }
+
     const Register& Operand::getRegister() const {
         assert(isRegister());
         return std::get<Register>(value_);
@@ -257,8 +286,13 @@ namespace tiny::t86 {
         return std::get<FloatRegister>(value_);
     }
 
+    const VectorRegister& Operand::getVectorRegister() const {
+        assert(isVectorRegister());
+        return std::get<VectorRegister>(value_);
+    }
+
     bool Operand::isFetched() const {
-        return isValue() || isFloatValue();
+        return isValue() || isFloatValue() || isVectorValue();
     }
 
     Requirement Operand::requirement() const {
@@ -295,6 +329,8 @@ namespace tiny::t86 {
             return RegisterRead(getMemoryRegisterOffsetRegisterScaled().regOffsetRegScaled().regScaled().reg());
         } else if (isFloatRegister()) {
             return FloatRegisterRead(getFloatRegister());
+        } else if (isVectorRegister()) {
+            return VectorRegisterRead(getVectorRegister());
         }
         throw std::runtime_error("Missing operand type");
     }
@@ -336,6 +372,8 @@ namespace tiny::t86 {
             return Type::FImm;
         } else if (isFloatRegister()) {
             return Type::FReg;
+        } else if (isVectorRegister()) {
+            return Type::VReg;
         }
         throw std::runtime_error("Unhandled operand type");
     }
@@ -378,6 +416,8 @@ namespace tiny::t86 {
                 return "FImm";
             case Type::FReg:
                 return "FReg";
+            case Type::VReg:
+                return "VReg";
         }
         throw std::runtime_error("Unhandled operand type");
     }
@@ -399,6 +439,8 @@ namespace tiny::t86 {
             return getRegisterRegisterScaled().toString();
         } else if (isRegisterOffsetRegisterScaled()) {
             return getRegisterOffsetRegisterScaled().toString();
+        } else if (isMemoryImmediate()) {
+            return getMemoryImmediate().toString();
         } else if (isMemoryRegister()) {
             return getMemoryRegister().toString();
         } else if (isMemoryRegisterOffset()) {
@@ -414,9 +456,24 @@ namespace tiny::t86 {
         } else if (isMemoryRegisterOffsetRegisterScaled()) {
             return getMemoryRegisterOffsetRegisterScaled().toString();
         } else if (isFloatValue()) {
-            return std::to_string(getFloatValue());
+            // Enough digits to read the same double back, always with a '.' so it stays a float immediate
+            std::ostringstream ss;
+            ss << std::setprecision(std::numeric_limits<double>::max_digits10) << getFloatValue();
+            std::string result = ss.str();
+            if (result.find_first_of(".ni") == std::string::npos) {
+                result.insert(std::min(result.find('e'), result.size()), ".0");
+            }
+            return result;
         } else if (isFloatRegister()) {
             return getFloatRegister().toString();
+        } else if (isVectorRegister()) {
+            return getVectorRegister().toString();
+        } else if (isVectorValue()) {
+            std::string result = "{";
+            for (int64_t lane : getVectorValue()) {
+                result += (result.size() > 1 ? ", " : "") + std::to_string(lane);
+            }
+            return result + "}";
         }
         throw std::runtime_error("Unhandled operand type");
     }
@@ -33,6 +33,7 @@ namespace tiny::t86 {
             MemRegImmRegScaled, // [R0 1 + R1 * 2]
             FImm, // 4.2
             FReg, // FR0
+            VReg, // VR0
         };
 
         static std::string typeToString(Type type);
@@ -75,6 +76,10 @@ namespace tiny::t86 {
 
         Operand(const FloatRegister& fReg);
 
+        Operand(const VectorRegister& vReg);
+
+        explicit Operand(const VectorRegister::Value& value);
+
         bool isFetched() const;
 
         Requirement requirement() const;
@@ -83,10 +88,14 @@ namespace tiny::t86 {
 
         void supply(double value);
 
+        void supply(const VectorRegister::Value& value);
+
         bool isValue() const;
 
         bool isFloatValue() const;
 
+        bool isVectorValue() const;
+
         bool isRegister() const;
 
         bool isRegisterOffset() const;
@@ -119,12 +128,16 @@ namespace tiny::t86 {
 
         bool isFloatRegister() const;
 
+        bool isVectorRegister() const;
+
         Type getType() const;
 
         int64_t getValue() const;
 
         double getFloatValue() const;
 
+        const VectorRegister::Value& getVectorValue() const;
+
         const Register& getRegister() const;
 
         const RegisterOffset& getRegisterOffset() const;
@@ -157,6 +170,8 @@ namespace tiny::t86 {
 
         const FloatRegister& getFloatRegister() const;
 
+        const VectorRegister& getVectorRegister() const;
+
         static int64_t supply(const Register& reg, int64_t val);
 
         static int64_t supply(const RegisterOffset& reg, int64_t val);
@@ -190,7 +205,7 @@ namespace tiny::t86 {
         static double supply(const FloatRegister&, double val);
     private:
 
-        std::variant<int64_t, double, Register, FloatRegister,
+        std::variant<int64_t, double, Register, FloatRegister, VectorRegister, VectorRegister::Value,
                      RegisterOffset, RegisterRegister, RegisterScaled,
                      RegisterOffsetRegister, RegisterRegisterScaled, RegisterOffsetRegisterScaled,
                      Memory::Immediate, Memory::Register, Memory::RegisterOffset, Memory::RegisterRegister, Memory::RegisterScaled,
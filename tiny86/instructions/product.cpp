@@ -18,6 +18,8 @@ namespace tiny::t86 {
             return MemoryRegister();
         } else if (op.isFloatRegister()) {
             return op.getFloatRegister();
+        } else if (op.isVectorRegister()) {
+            return op.getVectorRegister();
         } else if (op.isRegisterOffset()
                 || op.isRegisterScaled()
                 || op.isRegisterRegister()
@@ -47,6 +49,15 @@ namespace tiny::t86 {
         return std::get<FloatRegister>(product_);
     }
 
+    bool Product::isVectorRegister() const {
+        return std::holds_alternative<VectorRegister>(product_);
+    }
+
+    VectorRegister Product::getVectorRegister() const {
+        assert(isVectorRegister());
+        return std::get<VectorRegister>(product_);
+    }
+
     bool Product::isMemoryImmediate() const {
         return std::holds_alternative<Memory::Immediate>(product_);
     }
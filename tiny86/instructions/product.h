@@ -16,6 +16,9 @@ namespace tiny::t86 {
         Product(FloatRegister fReg)
                 : product_(fReg) {}
 
+        Product(VectorRegister vReg)
+                : product_(vReg) {}
+
         Product(Memory::Immediate mem)
                 : product_(mem) {}
 
@@ -32,6 +35,10 @@ namespace tiny::t86 {
 
         FloatRegister getFloatRegister() const;
 
+        bool isVectorRegister() const;
+
+        VectorRegister getVectorRegister() const;
+
         bool isMemoryImmediate() const;
 
         Memory::Immediate getMemoryImmediate() const;
@@ -44,6 +51,6 @@ namespace tiny::t86 {
 
         Product(MemoryRegister memReg) : product_(memReg) {}
 
-        std::variant<Register, FloatRegister, Memory::Immediate, MemoryRegister> product_;
+        std::variant<Register, FloatRegister, VectorRegister, Memory::Immediate, MemoryRegister> product_;
     };
 }
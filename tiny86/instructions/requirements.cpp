@@ -22,6 +22,15 @@ namespace tiny::t86 {
         return std::get<FloatRegisterRead>(value_).fReg();
     }
 
+    bool Requirement::isVectorRegisterRead() const {
+        return std::holds_alternative<VectorRegisterRead>(value_);
+    }
+
+    VectorRegister Requirement::getVectorRegisterRead() const {
+        assert(isVectorRegisterRead());
+        return std::get<VectorRegisterRead>(value_).vReg();
+    }
+
     bool Requirement::isMemoryRead() const {
         return std::holds_alternative<MemoryRead>(value_);
     }
@@ -31,6 +31,18 @@ namespace tiny::t86 {
     };
 
 
+    class VectorRegisterRead {
+    public:
+        VectorRegisterRead(VectorRegister vReg) : vReg_(vReg) {}
+
+        VectorRegister vReg() const {
+            return vReg_;
+        }
+
+    private:
+        VectorRegister vReg_;
+    };
+
     class MemoryRead {
     public:
         MemoryRead(uint64_t addr) : addr_(addr) {}
@@ -52,6 +64,8 @@ namespace tiny::t86 {
         Requirement(RegisterRead regRead) : value_(regRead) {}
 
         Requirement(FloatRegisterRead fRegRead) : value_(fRegRead) {}
+
+        Requirement(VectorRegisterRead vRegRead) : value_(vRegRead) {}
             
         Requirement(MemoryRead memRead) : value_(memRead) {}
 
@@ -59,15 +73,19 @@ namespace tiny::t86 {
 
         bool isFloatRegisterRead() const;
 
+        bool isVectorRegisterRead() const;
+
         bool isMemoryRead() const;
 
         Register getRegisterRead() const;
 
         FloatRegister getFloatRegisterRead() const;
 
+        VectorRegister getVectorRegisterRead() const;
+
         uint64_t getMemoryRead() const;
 
     private:
-        std::variant<RegisterRead, FloatRegisterRead, MemoryRead> value_;
+        std::variant<RegisterRead, FloatRegisterRead, VectorRegisterRead, MemoryRead> value_;
     };
 }
@@ -0,0 +1,74 @@
+#include "io_channel.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace tiny::t86 {
+    IOChannel::IOChannel(std::size_t bufferSize)
+            : os_(&std::cout), is_(&std::cin), bufferSize_(bufferSize) {
+        buffer_.reserve(bufferSize_);
+    }
+
+    IOChannel::~IOChannel() {
+        flush();
+    }
+
+    void IOChannel::connectOutput(std::ostream* os) {
+        flush();
+        os_ = os;
+    }
+
+    void IOChannel::connectInput(std::istream& is) {
+        is_ = &is;
+        ownInput_.reset();
+    }
+
+    void IOChannel::openInput(const std::string& path) {
+        auto file = std::make_unique<std::ifstream>(path, std::ios::binary);
+        if (!*file) {
+            throw std::runtime_error("Can't open " + path);
+        }
+        is_ = file.get();
+        ownInput_ = std::move(file);
+    }
+
+    void IOChannel::setInput(std::string input) {
+        auto stream = std::make_unique<std::istringstream>(std::move(input));
+        is_ = stream.get();
+        ownInput_ = std::move(stream);
+    }
+
+    void IOChannel::put(char c) {
+        if (capture_) {
+            captured_.push_back(c);
+        }
+        buffer_.push_back(c);
+        if (buffer_.size() >= bufferSize_) {
+            flush();
+        }
+    }
+
+    int64_t IOChannel::get() {
+        // Prompts written so far have to be seen before the program waits for the user
+        if (!ownInput_) {
+            flush();
+        }
+        int c = is_->get();
+        if (c == std::istream::traits_type::eof()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(c);
+    }
+
+    void IOChannel::flush() {
+        if (buffer_.empty()) {
+            return;
+        }
+        if (os_) {
+            os_->write(buffer_.data(), buffer_.size());
+            os_->flush();
+        }
+        buffer_.clear();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace tiny::t86 {
+    /**
+     * Console of the simulated program, PUTCHAR writes into it and GETCHAR reads from it
+     *
+     * Output is buffered and written to the stream when the buffer fills, when the program halts,
+     * before input is read from an outside stream and on flush. Input is read byte by byte,
+     * whitespace included, from std::cin, a file or a string, at its end GETCHAR gets -1.
+     * Output can be also captured to memory, e.g. to compare it with the expected one.
+     */
+    class IOChannel {
+    public:
+        constexpr static std::size_t defaultBufferSize = 4096;
+
+        // Writes to std::cout and reads from std::cin
+        explicit IOChannel(std::size_t bufferSize = defaultBufferSize);
+
+        IOChannel(const IOChannel&) = delete;
+
+        IOChannel& operator=(const IOChannel&) = delete;
+
+        // Flushes the output
+        ~IOChannel();
+
+        // The stream has to outlive the channel, nullptr discards the output
+        void connectOutput(std::ostream* os);
+
+        // The stream has to outlive the channel
+        void connectInput(std::istream& is);
+
+        // Throws std::runtime_error when the file can't be opened
+        void openInput(const std::string& path);
+
+        void setInput(std::string input);
+
+        // Output written from now on is kept in memory too
+        void captureOutput(bool enabled) {
+            capture_ = enabled;
+        }
+
+        const std::string& captured() const {
+            return captured_;
+        }
+
+        void clearCaptured() {
+            captured_.clear();
+        }
+
+        void put(char c);
+
+        // The byte as unsigned, -1 at the end of input
+        int64_t get();
+
+        void flush();
+
+    private:
+        std::ostream* os_;
+
+        std::istream* is_;
+
+        // File or string the input is read from, empty for outside streams
+        std::unique_ptr<std::istream> ownInput_;
+
+        std::string buffer_;
+
+        std::size_t bufferSize_;
+
+        bool capture_{false};
+
+        std::string captured_;
+    };
+}
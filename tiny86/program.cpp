@@ -1,6 +1,9 @@
 #include "program.h"
 #include "instruction.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace tiny::t86 {
     const Instruction* Program::at(size_t index) const {
         if (index >= instructions_.size()) {
@@ -10,7 +13,30 @@ namespace tiny::t86 {
         return instructions_.at(index);
     }
 
+    void Program::addSymbol(std::string name, std::size_t begin, std::size_t end) {
+        auto it = std::lower_bound(symbols_.begin(), symbols_.end(), begin, [](const Symbol& symbol, std::size_t pc) {
+            return symbol.begin < pc;
+        });
+        if (begin >= end || (it != symbols_.end() && it->begin < end) || (it != symbols_.begin() && std::prev(it)->end > begin)) {
+            throw std::invalid_argument("Symbol " + name + " is empty or overlaps other one");
+        }
+        symbols_.insert(it, Symbol{std::move(name), begin, end});
+    }
+
+    const Program::Symbol* Program::symbolAt(std::size_t pc) const {
+        auto it = std::upper_bound(symbols_.begin(), symbols_.end(), pc, [](std::size_t pc, const Symbol& symbol) {
+            return pc < symbol.begin;
+        });
+        if (it == symbols_.begin() || std::prev(it)->end <= pc) {
+            return nullptr;
+        }
+        return &*std::prev(it);
+    }
+
     void Program::deleteInstructions() {
+        if (!owning_) {
+            return;
+        }
         for (Instruction* ins : instructions_) {
             delete ins;
         }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <cstdint>
+#include <cstddef>
 
 namespace tiny::t86 {
 
@@ -9,14 +11,34 @@ namespace tiny::t86 {
 
     /**
      * Simple wrapper for vector of instructions
+     *
+     * Compilers can also name ranges of the instructions (functions) and give the source line of every instruction,
+     * profiles are then reported per symbol and per line.
      */
     class Program {
     public:
+        // Instructions [begin, end) belong to the symbol
+        struct Symbol {
+            std::string name;
+            std::size_t begin;
+            std::size_t end;
+        };
+
         Program(std::vector<Instruction*> instructions = {}, std::vector<int64_t> data = {})
             : instructions_(std::move(instructions)), data_(std::move(data)) {}
 
         Program(Program&& other)
-            : instructions_(std::move(other.instructions_)), data_(std::move(other.data_)){}
+            : instructions_(std::move(other.instructions_)), data_(std::move(other.data_)),
+              symbols_(std::move(other.symbols_)), lines_(std::move(other.lines_)), owning_(other.owning_) {}
+
+        // Shares the instructions of other, which has to outlive the returned program
+        static Program borrow(const Program& other) {
+            Program program(other.instructions_, other.data_);
+            program.symbols_ = other.symbols_;
+            program.lines_ = other.lines_;
+            program.owning_ = false;
+            return program;
+        }
 
         ~Program() {
             deleteInstructions();
@@ -26,11 +48,18 @@ namespace tiny::t86 {
             deleteInstructions();
             instructions_ = std::move(other.instructions_);
             data_ = std::move(other.data_);
+            symbols_ = std::move(other.symbols_);
+            lines_ = std::move(other.lines_);
+            owning_ = other.owning_;
             return *this;
         }
 
         const Instruction* at(size_t index) const;
 
+        std::size_t size() const {
+            return instructions_.size();
+        }
+
         const std::vector<int64_t>& data() const {
             return data_;
         }
@@ -39,11 +68,40 @@ namespace tiny::t86 {
             return std::move(instructions_);
         }
 
+        // Symbols must not overlap, they are kept sorted by begin
+        void addSymbol(std::string name, std::size_t begin, std::size_t end);
+
+        const std::vector<Symbol>& symbols() const {
+            return symbols_;
+        }
+
+        // Symbol containing the pc, nullptr when there is none
+        const Symbol* symbolAt(std::size_t pc) const;
+
+        // Source line of every instruction by pc, 0 when unknown
+        void setLines(std::vector<std::size_t> lines) {
+            lines_ = std::move(lines);
+        }
+
+        const std::vector<std::size_t>& lines() const {
+            return lines_;
+        }
+
+        std::size_t lineAt(std::size_t pc) const {
+            return pc < lines_.size() ? lines_[pc] : 0;
+        }
+
     private:
         void deleteInstructions();
 
         std::vector<Instruction*> instructions_;
 
         std::vector<int64_t> data_;
+
+        std::vector<Symbol> symbols_;
+
+        std::vector<std::size_t> lines_;
+
+        bool owning_{true};
     };
 }
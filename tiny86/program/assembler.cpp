@@ -0,0 +1,780 @@
+#include "assembler.h"
+#include "helpers.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+
+namespace tiny::t86 {
+    namespace {
+        std::string trim(const std::string& str) {
+            std::size_t begin = str.find_first_not_of(" \t\r");
+            if (begin == std::string::npos) {
+                return "";
+            }
+            std::size_t end = str.find_last_not_of(" \t\r");
+            return str.substr(begin, end - begin + 1);
+        }
+
+        bool isIdentifierStart(char c) {
+            return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+        }
+
+        bool isIdentifierChar(char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+        }
+
+        // Removes comment, but keeps ';' and '#' inside string literals
+        std::string stripComment(const std::string& line) {
+            bool inString = false;
+            for (std::size_t i = 0; i < line.size(); ++i) {
+                char c = line[i];
+                if (inString && c == '\\') {
+                    ++i;
+                } else if (c == '"') {
+                    inString = !inString;
+                } else if (!inString && (c == ';' || c == '#')) {
+                    return line.substr(0, i);
+                }
+            }
+            return line;
+        }
+
+        std::vector<std::string> splitOperands(const std::string& str) {
+            std::vector<std::string> result;
+            std::stringstream ss(str);
+            std::string operand;
+            while (std::getline(ss, operand, ',')) {
+                result.push_back(trim(operand));
+            }
+            return result;
+        }
+
+        std::string unescape(const std::string& literal) {
+            if (literal.size() < 2 || literal.front() != '"' || literal.back() != '"') {
+                throw std::invalid_argument("Expected string literal, got " + literal);
+            }
+            std::string result;
+            for (std::size_t i = 1; i + 1 < literal.size(); ++i) {
+                char c = literal[i];
+                if (c == '\\' && i + 2 < literal.size()) {
+                    switch (literal[++i]) {
+                        case 'n': c = '\n'; break;
+                        case 't': c = '\t'; break;
+                        case 'r': c = '\r'; break;
+                        case '0': c = '\0'; break;
+                        default: c = literal[i]; break;
+                    }
+                }
+                result.push_back(c);
+            }
+            return result;
+        }
+
+        std::string escape(char c) {
+            switch (c) {
+                case '\n': return "\\n";
+                case '\t': return "\\t";
+                case '\r': return "\\r";
+                case '\0': return "\\0";
+                case '\\': return "\\\\";
+                case '"': return "\\\"";
+                default: return std::string(1, c);
+            }
+        }
+
+        std::optional<Register> parseRegister(const std::string& name) {
+            if (name == "Pc") {
+                return Pc();
+            } else if (name == "Sp") {
+                return Sp();
+            } else if (name == "Bp") {
+                return Bp();
+            } else if (name == "Flags") {
+                return Flags();
+            } else if (name == "CoreId") {
+                return CoreId();
+            } else if (name.size() > 3 && name.compare(0, 3, "Reg") == 0
+                       && std::all_of(name.begin() + 3, name.end(), ::isdigit)) {
+                return Reg(std::stoul(name.substr(3)));
+            }
+            return std::nullopt;
+        }
+
+        std::optional<FloatRegister> parseFloatRegister(const std::string& name) {
+            if (name.size() > 4 && name.compare(0, 4, "FReg") == 0
+                && std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+                return FReg(std::stoul(name.substr(4)));
+            }
+            return std::nullopt;
+        }
+
+        std::optional<VectorRegister> parseVectorRegister(const std::string& name) {
+            if (name.size() > 4 && name.compare(0, 4, "VReg") == 0
+                && std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+                return VReg(std::stoul(name.substr(4)));
+            }
+            return std::nullopt;
+        }
+    }
+
+    namespace {
+        template<typename V, typename A, std::size_t I = 0>
+        constexpr std::size_t alternativeIndex() {
+            if constexpr (std::is_same_v<std::variant_alternative_t<I, V>, A>) {
+                return I;
+            } else {
+                return alternativeIndex<V, A, I + 1>();
+            }
+        }
+
+        template<typename T, typename... Args, typename V, std::size_t... I>
+        Label construct(ProgramBuilder& pb, const std::vector<V>& args, std::index_sequence<I...>) {
+            return pb.add(T(std::get<Args>(args[I])...));
+        }
+    }
+
+    template<typename T, typename... Args>
+    void Assembler::define(std::map<Signature, Emitter>& emitters, const std::string& mnemonic) {
+        emitters.emplace(Signature{mnemonic, {alternativeIndex<Value, Args>()...}},
+                         [](ProgramBuilder& pb, const std::vector<Value>& args) {
+            return construct<T, Args...>(pb, args, std::index_sequence_for<Args...>{});
+        });
+    }
+
+    const std::map<Assembler::Signature, Assembler::Emitter>& Assembler::emitters() {
+        static const std::map<Signature, Emitter> emitters = [] {
+            std::map<Signature, Emitter> e;
+#define NO_OPERAND_INS(INS_NAME) \
+            define<INS_NAME>(e, #INS_NAME);
+#define BINARY_ARITH_INS(INS_NAME) \
+            define<INS_NAME, Register, Register>(e, #INS_NAME); \
+            define<INS_NAME, Register, RegisterOffset>(e, #INS_NAME); \
+            define<INS_NAME, Register, int64_t>(e, #INS_NAME); \
+            define<INS_NAME, Register, Memory::Immediate>(e, #INS_NAME); \
+            define<INS_NAME, Register, Memory::Register>(e, #INS_NAME); \
+            define<INS_NAME, Register, Memory::RegisterOffset>(e, #INS_NAME);
+#define FLOAT_BINARY_ARITH_INS(INS_NAME) \
+            define<INS_NAME, FloatRegister, FloatRegister>(e, #INS_NAME); \
+            define<INS_NAME, FloatRegister, double>(e, #INS_NAME);
+#define UNARY_ARITH_INS(INS_NAME) \
+            define<INS_NAME, Register>(e, #INS_NAME);
+#define COND_JMP_INS(INS_NAME) \
+            define<INS_NAME, Register>(e, #INS_NAME); \
+            define<INS_NAME, int64_t>(e, #INS_NAME); \
+            define<INS_NAME, Memory::Immediate>(e, #INS_NAME); \
+            define<INS_NAME, Memory::Register>(e, #INS_NAME); \
+            define<INS_NAME, Memory::RegisterOffset>(e, #INS_NAME);
+#define COND_MOV_INS(INS_NAME) \
+            define<INS_NAME, Register, Register>(e, #INS_NAME); \
+            define<INS_NAME, Register, int64_t>(e, #INS_NAME);
+            NO_OPERAND_INS(NOP)
+            NO_OPERAND_INS(HALT)
+            NO_OPERAND_INS(BREAK)
+            NO_OPERAND_INS(CLF)
+            NO_OPERAND_INS(RET)
+            NO_OPERAND_INS(FENCE)
+            BINARY_ARITH_INS(MOD)
+            BINARY_ARITH_INS(ADD)
+            BINARY_ARITH_INS(SUB)
+            BINARY_ARITH_INS(MUL)
+            BINARY_ARITH_INS(DIV)
+            BINARY_ARITH_INS(IMUL)
+            BINARY_ARITH_INS(IDIV)
+            BINARY_ARITH_INS(AND)
+            BINARY_ARITH_INS(OR)
+            BINARY_ARITH_INS(XOR)
+            BINARY_ARITH_INS(LSH)
+            BINARY_ARITH_INS(RSH)
+            FLOAT_BINARY_ARITH_INS(FADD)
+            FLOAT_BINARY_ARITH_INS(FSUB)
+            FLOAT_BINARY_ARITH_INS(FMUL)
+            FLOAT_BINARY_ARITH_INS(FDIV)
+            UNARY_ARITH_INS(NOT)
+            UNARY_ARITH_INS(INC)
+            UNARY_ARITH_INS(DEC)
+            UNARY_ARITH_INS(NEG)
+            COND_JMP_INS(JZ)
+            COND_JMP_INS(JNZ)
+            COND_JMP_INS(JE)
+            COND_JMP_INS(JNE)
+            COND_JMP_INS(JG)
+            COND_JMP_INS(JGE)
+            COND_JMP_INS(JL)
+            COND_JMP_INS(JLE)
+            COND_JMP_INS(JA)
+            COND_JMP_INS(JAE)
+            COND_JMP_INS(JB)
+            COND_JMP_INS(JBE)
+            COND_JMP_INS(JO)
+            COND_JMP_INS(JNO)
+            COND_JMP_INS(JS)
+            COND_JMP_INS(JNS)
+            COND_MOV_INS(CMOVZ)
+            COND_MOV_INS(CMOVNZ)
+            COND_MOV_INS(CMOVE)
+            COND_MOV_INS(CMOVNE)
+            COND_MOV_INS(CMOVG)
+            COND_MOV_INS(CMOVGE)
+            COND_MOV_INS(CMOVL)
+            COND_MOV_INS(CMOVLE)
+            COND_MOV_INS(CMOVA)
+            COND_MOV_INS(CMOVAE)
+            COND_MOV_INS(CMOVB)
+            COND_MOV_INS(CMOVBE)
+            COND_MOV_INS(CMOVO)
+            COND_MOV_INS(CMOVNO)
+            COND_MOV_INS(CMOVS)
+            COND_MOV_INS(CMOVNS)
+#undef NO_OPERAND_INS
+#undef BINARY_ARITH_INS
+#undef FLOAT_BINARY_ARITH_INS
+#undef UNARY_ARITH_INS
+#undef COND_JMP_INS
+#undef COND_MOV_INS
+            define<JMP, Register>(e, "JMP");
+            define<JMP, int64_t>(e, "JMP");
+            define<CALL, Register>(e, "CALL");
+            define<CALL, int64_t>(e, "CALL");
+            define<LOOP, Register, Register>(e, "LOOP");
+            define<LOOP, Register, int64_t>(e, "LOOP");
+            define<CMP, Register, int64_t>(e, "CMP");
+            define<CMP, Register, Register>(e, "CMP");
+            define<CMP, Register, Memory::Immediate>(e, "CMP");
+            define<CMP, Register, Memory::Register>(e, "CMP");
+            define<CMP, Register, Memory::RegisterOffset>(e, "CMP");
+            define<FCMP, FloatRegister, double>(e, "FCMP");
+            define<FCMP, FloatRegister, FloatRegister>(e, "FCMP");
+            define<PUSH, int64_t>(e, "PUSH");
+            define<PUSH, Register>(e, "PUSH");
+            define<FPUSH, double>(e, "FPUSH");
+            define<FPUSH, FloatRegister>(e, "FPUSH");
+            define<POP, Register>(e, "POP");
+            define<FPOP, FloatRegister>(e, "FPOP");
+            define<PUTCHAR, Register>(e, "PUTCHAR");
+            define<GETCHAR, Register>(e, "GETCHAR");
+            define<RDPMC, Register, int64_t>(e, "RDPMC");
+            define<EXT, FloatRegister, Register>(e, "EXT");
+            define<NRW, Register, FloatRegister>(e, "NRW");
+            define<XADD, Memory::Immediate, Register>(e, "XADD");
+            define<XADD, Memory::Register, Register>(e, "XADD");
+            define<XADD, Memory::RegisterOffset, Register>(e, "XADD");
+            define<XCHG, Memory::Immediate, Register>(e, "XCHG");
+            define<XCHG, Memory::Register, Register>(e, "XCHG");
+            define<XCHG, Memory::RegisterOffset, Register>(e, "XCHG");
+            define<VADD, VectorRegister, VectorRegister>(e, "VADD");
+            define<VMUL, VectorRegister, VectorRegister>(e, "VMUL");
+            define<VFADD, VectorRegister, VectorRegister>(e, "VFADD");
+            define<VFMUL, VectorRegister, VectorRegister>(e, "VFMUL");
+            define<VLOAD, VectorRegister, Memory::Immediate>(e, "VLOAD");
+            define<VLOAD, VectorRegister, Memory::Register>(e, "VLOAD");
+            define<VLOAD, VectorRegister, Memory::RegisterOffset>(e, "VLOAD");
+            define<VSTORE, Memory::Immediate, VectorRegister>(e, "VSTORE");
+            define<VSTORE, Memory::Register, VectorRegister>(e, "VSTORE");
+            define<VSTORE, Memory::RegisterOffset, VectorRegister>(e, "VSTORE");
+            define<VBROADCAST, VectorRegister, int64_t>(e, "VBROADCAST");
+            define<VBROADCAST, VectorRegister, double>(e, "VBROADCAST");
+            define<VBROADCAST, VectorRegister, Register>(e, "VBROADCAST");
+            define<VBROADCAST, VectorRegister, FloatRegister>(e, "VBROADCAST");
+            define<VREDUCE, Register, VectorRegister>(e, "VREDUCE");
+            define<VFREDUCE, FloatRegister, VectorRegister>(e, "VFREDUCE");
+            define<LEA, Register, Memory::RegisterOffset>(e, "LEA");
+            define<LEA, Register, Memory::RegisterRegister>(e, "LEA");
+            define<LEA, Register, Memory::RegisterScaled>(e, "LEA");
+            define<LEA, Register, Memory::RegisterOffsetRegister>(e, "LEA");
+            define<LEA, Register, Memory::RegisterRegisterScaled>(e, "LEA");
+            define<LEA, Register, Memory::RegisterOffsetRegisterScaled>(e, "LEA");
+            // Host debug functions have no textual form, only the printing ones do
+            define<DBG>(e, "DBG");
+            define<DBG, Register>(e, "DBG");
+            define<DBG, FloatRegister>(e, "DBG");
+#define MOV_INS(DESTINATION, VALUE) \
+            define<MOV, DESTINATION, VALUE>(e, "MOV");
+            MOV_INS(Register, int64_t)
+            MOV_INS(Register, Register)
+            MOV_INS(Register, FloatRegister)
+            MOV_INS(Register, Memory::Immediate)
+            MOV_INS(Register, Memory::Register)
+            MOV_INS(Register, Memory::RegisterOffset)
+            MOV_INS(Register, Memory::RegisterScaled)
+            MOV_INS(Register, Memory::RegisterRegister)
+            MOV_INS(Register, Memory::RegisterOffsetRegister)
+            MOV_INS(Register, Memory::RegisterRegisterScaled)
+            MOV_INS(Register, Memory::RegisterOffsetRegisterScaled)
+            MOV_INS(FloatRegister, double)
+            MOV_INS(FloatRegister, FloatRegister)
+            MOV_INS(FloatRegister, Register)
+            MOV_INS(FloatRegister, Memory::Immediate)
+            MOV_INS(FloatRegister, Memory::Register)
+            MOV_INS(Memory::Immediate, int64_t)
+            MOV_INS(Memory::Immediate, Register)
+            MOV_INS(Memory::Immediate, FloatRegister)
+            MOV_INS(Memory::Register, int64_t)
+            MOV_INS(Memory::Register, Register)
+            MOV_INS(Memory::Register, FloatRegister)
+            MOV_INS(Memory::RegisterOffset, int64_t)
+            MOV_INS(Memory::RegisterOffset, Register)
+            MOV_INS(Memory::RegisterOffset, FloatRegister)
+            MOV_INS(Memory::RegisterScaled, int64_t)
+            MOV_INS(Memory::RegisterScaled, Register)
+            MOV_INS(Memory::RegisterScaled, FloatRegister)
+            MOV_INS(Memory::RegisterRegister, int64_t)
+            MOV_INS(Memory::RegisterRegister, Register)
+            MOV_INS(Memory::RegisterRegister, FloatRegister)
+            MOV_INS(Memory::RegisterOffsetRegister, int64_t)
+            MOV_INS(Memory::RegisterOffsetRegister, Register)
+            MOV_INS(Memory::RegisterOffsetRegister, FloatRegister)
+            MOV_INS(Memory::RegisterRegisterScaled, int64_t)
+            MOV_INS(Memory::RegisterRegisterScaled, Register)
+            MOV_INS(Memory::RegisterRegisterScaled, FloatRegister)
+            MOV_INS(Memory::RegisterOffsetRegisterScaled, int64_t)
+            MOV_INS(Memory::RegisterOffsetRegisterScaled, Register)
+            MOV_INS(Memory::RegisterOffsetRegisterScaled, FloatRegister)
+#undef MOV_INS
+            return e;
+        }();
+        return emitters;
+    }
+
+    bool Assembler::knownMnemonic(const std::string& mnemonic) {
+        auto it = emitters().lower_bound(Signature{mnemonic, {}});
+        return it != emitters().end() && it->first.first == mnemonic;
+    }
+
+    Program Assembler::assemble(const std::string& source) {
+        std::istringstream is(source);
+        return assemble(is);
+    }
+
+    Program Assembler::assemble(std::istream& is) {
+        lines_.clear();
+        labels_.clear();
+        symbols_.clear();
+        openSymbol_.reset();
+        pendingLabels_.clear();
+        instructionLines_.clear();
+        currentLine_ = 0;
+        instructionCnt_ = 0;
+        dataCnt_ = 0;
+
+        // First pass gives every label its address, so labels can be used before they are defined
+        std::string text;
+        std::size_t number = 1;
+        for (; std::getline(is, text); ++number) {
+            try {
+                parseLine(text, number);
+            } catch (const ParseError&) {
+                throw;
+            } catch (const std::exception& e) {
+                throw ParseError(number, e.what());
+            }
+        }
+        for (const auto& label : pendingLabels_) {
+            labels_[label] = instructionCnt_;
+        }
+        pendingLabels_.clear();
+        if (openSymbol_) {
+            throw ParseError(number - 1, "Missing .endfunction of " + openSymbol_->name);
+        }
+
+        ProgramBuilder pb(release_);
+        for (const auto& symbol : symbols_) {
+            pb.addSymbol(symbol.name, symbol.begin, symbol.end);
+        }
+        for (std::size_t pc = 0; pc < instructionLines_.size(); ++pc) {
+            pb.addLines(pc, pc + 1, instructionLines_[pc]);
+        }
+        for (const auto& line : lines_) {
+            try {
+                if (line.mnemonic[0] == '.') {
+                    addData(line, pb);
+                    continue;
+                }
+                if (release_ && line.mnemonic == "DBG") {
+                    continue;
+                }
+                std::vector<Value> operands;
+                Signature signature{line.mnemonic, {}};
+                for (const auto& operand : line.operands) {
+                    operands.push_back(parseOperand(operand, line.number));
+                    signature.second.push_back(operands.back().index());
+                }
+                auto it = emitters().find(signature);
+                if (it == emitters().end()) {
+                    std::string written;
+                    for (const auto& operand : operands) {
+                        written += (written.empty() ? " " : ", ")
+                                + Operand::typeToString(std::visit([](const auto& o) { return Operand(o).getType(); }, operand));
+                    }
+                    throw ParseError(line.number, "Unsupported operands " + line.mnemonic + written);
+                }
+                it->second(pb, operands);
+            } catch (const ParseError&) {
+                throw;
+            } catch (const std::exception& e) {
+                throw ParseError(line.number, e.what());
+            }
+        }
+        return pb.program();
+    }
+
+    void Assembler::parseLine(const std::string& text, std::size_t number) {
+        std::string line = trim(stripComment(text));
+        // Labels
+        while (!line.empty()) {
+            std::size_t end = 0;
+            while (end < line.size() && isIdentifierChar(line[end])) {
+                ++end;
+            }
+            if (end == 0 || end >= line.size() || line[end] != ':' || !isIdentifierStart(line[0])) {
+                break;
+            }
+            std::string label = line.substr(0, end);
+            if (labels_.count(label) || std::find(pendingLabels_.begin(), pendingLabels_.end(), label) != pendingLabels_.end()) {
+                throw ParseError(number, "Label " + label + " defined twice");
+            }
+            if (parseRegister(label) || parseFloatRegister(label) || parseVectorRegister(label)) {
+                throw ParseError(number, "Label " + label + " collides with register name");
+            }
+            pendingLabels_.push_back(label);
+            line = trim(line.substr(end + 1));
+        }
+        if (line.empty()) {
+            return;
+        }
+
+        Line result{number, {}, {}};
+        std::size_t split = line.find_first_of(" \t");
+        result.mnemonic = line.substr(0, split);
+        std::string rest = split == std::string::npos ? "" : trim(line.substr(split));
+        // Metadata of the instructions, pending labels are left for the next instruction or data
+        if (parseMetadata(result.mnemonic, rest, number)) {
+            return;
+        }
+
+        // Pending labels name whatever comes first, data or instruction
+        int64_t address;
+        if (result.mnemonic == ".string") {
+            std::string str;
+            try {
+                str = unescape(rest);
+            } catch (const std::exception& e) {
+                throw ParseError(number, e.what());
+            }
+            result.operands.push_back(rest);
+            address = dataCnt_;
+            dataCnt_ += str.size() + 1;
+        } else if (result.mnemonic == ".data" || result.mnemonic == ".double") {
+            result.operands = splitOperands(rest);
+            address = dataCnt_;
+            dataCnt_ += result.operands.size();
+        } else if (knownMnemonic(result.mnemonic)) {
+            if (!rest.empty()) {
+                result.operands = splitOperands(rest);
+            }
+            address = instructionCnt_;
+            if (!(release_ && result.mnemonic == "DBG")) {
+                ++instructionCnt_;
+                instructionLines_.push_back(currentLine_);
+            }
+        } else {
+            throw ParseError(number, "Unknown instruction or directive " + result.mnemonic);
+        }
+        for (const auto& label : pendingLabels_) {
+            labels_[label] = address;
+        }
+        pendingLabels_.clear();
+        lines_.push_back(std::move(result));
+    }
+
+    bool Assembler::parseMetadata(const std::string& mnemonic, const std::string& rest, std::size_t number) {
+        if (mnemonic == ".line") {
+            if (rest.empty() || !std::all_of(rest.begin(), rest.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+                throw ParseError(number, "Invalid line '" + rest + "'");
+            }
+            currentLine_ = std::stoul(rest);
+            return true;
+        }
+        if (mnemonic == ".function") {
+            if (openSymbol_) {
+                throw ParseError(number, "Function " + rest + " starts inside of " + openSymbol_->name);
+            }
+            if (rest.empty() || std::any_of(rest.begin(), rest.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); })) {
+                throw ParseError(number, "Invalid function name '" + rest + "'");
+            }
+            openSymbol_ = Program::Symbol{rest, instructionCnt_, instructionCnt_};
+            return true;
+        }
+        if (mnemonic == ".endfunction") {
+            if (!openSymbol_) {
+                throw ParseError(number, ".endfunction without .function");
+            }
+            if (openSymbol_->begin == instructionCnt_) {
+                throw ParseError(number, "Function " + openSymbol_->name + " has no instructions");
+            }
+            openSymbol_->end = instructionCnt_;
+            symbols_.push_back(std::move(*openSymbol_));
+            openSymbol_.reset();
+            return true;
+        }
+        return false;
+    }
+
+    void Assembler::addData(const Line& line, ProgramBuilder& pb) const {
+        if (line.mnemonic == ".string") {
+            pb.addData(unescape(line.operands.at(0)));
+        } else if (line.mnemonic == ".data") {
+            for (const auto& value : line.operands) {
+                pb.addData(parseInteger(value, line.number));
+            }
+        } else if (line.mnemonic == ".double") {
+            for (const auto& value : line.operands) {
+                std::size_t parsed = 0;
+                double d;
+                try {
+                    d = std::stod(value, &parsed);
+                } catch (const std::out_of_range&) {
+                    throw ParseError(line.number, "Float out of range " + value);
+                } catch (const std::invalid_argument&) {
+                    throw ParseError(line.number, "Invalid float " + value);
+                }
+                if (parsed != value.size()) {
+                    throw ParseError(line.number, "Invalid float " + value);
+                }
+                pb.addData(*reinterpret_cast<int64_t*>(&d));
+            }
+        }
+    }
+
+    int64_t Assembler::parseInteger(const std::string& text, std::size_t line) const {
+        if (!text.empty() && isIdentifierStart(text[0])) {
+            auto it = labels_.find(text);
+            if (it == labels_.end()) {
+                throw ParseError(line, "Unknown label " + text);
+            }
+            return it->second;
+        }
+        std::size_t parsed = 0;
+        int64_t value;
+        try {
+            value = std::stoll(text, &parsed, 0);
+        } catch (const std::out_of_range&) {
+            throw ParseError(line, "Integer out of range " + text);
+        } catch (const std::invalid_argument&) {
+            throw ParseError(line, "Invalid integer " + text);
+        }
+        if (parsed != text.size()) {
+            throw ParseError(line, "Invalid integer " + text);
+        }
+        return value;
+    }
+
+    Assembler::Value Assembler::parseOperand(const std::string& text, std::size_t line) const {
+        if (text.empty()) {
+            throw ParseError(line, "Missing operand");
+        }
+        bool memory = text.front() == '[';
+        if (memory && text.back() != ']') {
+            throw ParseError(line, "Missing ] in " + text);
+        }
+        std::string expr = memory ? trim(text.substr(1, text.size() - 2)) : text;
+
+        // Tokens are words (registers, numbers, labels) and the operators + - *
+        std::vector<std::string> tokens;
+        for (std::size_t i = 0; i < expr.size();) {
+            char c = expr[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+            } else if (c == '+' || c == '-' || c == '*') {
+                tokens.emplace_back(1, c);
+                ++i;
+            } else if (isIdentifierChar(c)) {
+                std::size_t begin = i;
+                while (i < expr.size() && isIdentifierChar(expr[i])) {
+                    ++i;
+                }
+                // Signed exponent of a float immediate, e.g. 1.5e-07
+                if (std::isdigit(static_cast<unsigned char>(c)) && expr.find('.', begin) < i
+                    && (expr[i - 1] == 'e' || expr[i - 1] == 'E') && i + 1 < expr.size()
+                    && (expr[i] == '+' || expr[i] == '-') && std::isdigit(static_cast<unsigned char>(expr[i + 1]))) {
+                    for (++i; i < expr.size() && std::isdigit(static_cast<unsigned char>(expr[i])); ++i) {}
+                }
+                tokens.push_back(expr.substr(begin, i - begin));
+            } else {
+                throw ParseError(line, std::string("Unexpected character '") + c + "' in " + text);
+            }
+        }
+
+        // Single float register or float immediate is not part of any address expression
+        if (!memory) {
+            std::size_t i = tokens.size() == 2 && tokens[0] == "-" ? 1 : 0;
+            if (tokens.size() == i + 1 && std::isdigit(static_cast<unsigned char>(tokens[i][0]))
+                && tokens[i].find('.') != std::string::npos) {
+                std::size_t parsed = 0;
+                double value;
+                try {
+                    value = std::stod(tokens[i], &parsed);
+                } catch (const std::out_of_range&) {
+                    throw ParseError(line, "Float out of range " + text);
+                } catch (const std::invalid_argument&) {
+                    throw ParseError(line, "Invalid float " + text);
+                }
+                if (parsed != tokens[i].size()) {
+                    throw ParseError(line, "Invalid float " + text);
+                }
+                return i ? -value : value;
+            }
+            if (tokens.size() == 1) {
+                if (auto fReg = parseFloatRegister(tokens[0])) {
+                    return *fReg;
+                }
+                if (auto vReg = parseVectorRegister(tokens[0])) {
+                    return *vReg;
+                }
+            }
+        }
+
+        // Parse the sum of terms, each being register, scaled register or immediate
+        struct Term {
+            std::optional<Register> reg;
+            int64_t value;
+            bool scaled;
+        };
+        std::vector<Term> terms;
+        for (std::size_t i = 0; i < tokens.size();) {
+            bool negative = false;
+            if (!terms.empty()) {
+                if (tokens[i] != "+" && tokens[i] != "-") {
+                    throw ParseError(line, "Expected + or - in " + text);
+                }
+                negative = tokens[i++] == "-";
+            }
+            if (i < tokens.size() && tokens[i] == "-") {
+                negative = !negative;
+                ++i;
+            }
+            if (i >= tokens.size()) {
+                throw ParseError(line, "Unexpected end of " + text);
+            }
+            // Negated register is the same as register scaled by -1
+            Term term{parseRegister(tokens[i]), 1, negative};
+            if (!term.reg) {
+                term.value = parseInteger(tokens[i], line);
+            }
+            ++i;
+            if (i < tokens.size() && tokens[i] == "*") {
+                if (!term.reg || i + 1 >= tokens.size()) {
+                    throw ParseError(line, "Only registers can be scaled in " + text);
+                }
+                ++i;
+                bool negativeScale = tokens[i] == "-";
+                if (negativeScale && ++i >= tokens.size()) {
+                    throw ParseError(line, "Unexpected end of " + text);
+                }
+                term.value = parseInteger(tokens[i++], line);
+                if (negativeScale) {
+                    term.value = -term.value;
+                }
+                term.scaled = true;
+            }
+            if (negative) {
+                term.value = -term.value;
+            }
+            terms.push_back(term);
+        }
+
+        auto isReg = [&](std::size_t i) { return terms.size() > i && terms[i].reg && !terms[i].scaled; };
+        auto isScaled = [&](std::size_t i) { return terms.size() > i && terms[i].reg && terms[i].scaled; };
+        auto isImm = [&](std::size_t i) { return terms.size() > i && !terms[i].reg; };
+
+        std::optional<Value> value;
+        if (terms.size() == 1 && isImm(0)) {
+            value = memory ? Value{Memory::Immediate(terms[0].value)} : Value{terms[0].value};
+        } else if (terms.size() == 1 && isReg(0)) {
+            value = memory ? Value{Memory::Register(*terms[0].reg)} : Value{*terms[0].reg};
+        } else if (terms.size() == 1 && isScaled(0)) {
+            value = RegisterScaled(*terms[0].reg, terms[0].value);
+        } else if (terms.size() == 2 && isReg(0) && isImm(1)) {
+            value = RegisterOffset(*terms[0].reg, terms[1].value);
+        } else if (terms.size() == 2 && isReg(0) && isReg(1)) {
+            value = RegisterRegister(*terms[0].reg, *terms[1].reg);
+        } else if (terms.size() == 2 && isReg(0) && isScaled(1)) {
+            value = RegisterRegisterScaled(*terms[0].reg, RegisterScaled(*terms[1].reg, terms[1].value));
+        } else if (terms.size() == 3 && isReg(0) && isImm(1) && isReg(2)) {
+            value = RegisterOffsetRegister(RegisterOffset(*terms[0].reg, terms[1].value), *terms[2].reg);
+        } else if (terms.size() == 3 && isReg(0) && isImm(1) && isScaled(2)) {
+            value = RegisterOffsetRegisterScaled(RegisterOffset(*terms[0].reg, terms[1].value),
+                                                 RegisterScaled(*terms[2].reg, terms[2].value));
+        } else {
+            throw ParseError(line, "Invalid operand " + text);
+        }
+
+        if (!memory || std::holds_alternative<Memory::Immediate>(*value) || std::holds_alternative<Memory::Register>(*value)) {
+            return *value;
+        }
+        return std::visit([&](const auto& v) -> Value {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_same_v<T, RegisterOffset>) {
+                return Memory::RegisterOffset(v);
+            } else if constexpr (std::is_same_v<T, RegisterRegister>) {
+                return Memory::RegisterRegister(v);
+            } else if constexpr (std::is_same_v<T, RegisterScaled>) {
+                return Memory::RegisterScaled(v);
+            } else if constexpr (std::is_same_v<T, RegisterOffsetRegister>) {
+                return Memory::RegisterOffsetRegister(v);
+            } else if constexpr (std::is_same_v<T, RegisterRegisterScaled>) {
+                return Memory::RegisterRegisterScaled(v);
+            } else if constexpr (std::is_same_v<T, RegisterOffsetRegisterScaled>) {
+                return Memory::RegisterOffsetRegisterScaled(v);
+            }
+            throw ParseError(line, "Invalid memory operand " + text);
+        }, *value);
+    }
+
+    void Assembler::disassemble(const Program& program, std::ostream& os) {
+        const auto& data = program.data();
+        for (std::size_t i = 0; i < data.size();) {
+            // Runs of printable characters ending with zero are written back as strings
+            std::size_t end = i;
+            while (end < data.size() && data[end] > 0 && data[end] < 128
+                   && (std::isprint(static_cast<int>(data[end])) || std::isspace(static_cast<int>(data[end])))) {
+                ++end;
+            }
+            if (end > i && end < data.size() && data[end] == 0) {
+                os << ".string \"";
+                for (; i < end; ++i) {
+                    os << escape(static_cast<char>(data[i]));
+                }
+                os << "\"\n";
+                ++i;
+                continue;
+            }
+            os << ".data " << data[i++];
+            for (std::size_t j = 1; j < 8 && i < data.size(); ++j) {
+                os << ", " << data[i++];
+            }
+            os << '\n';
+        }
+        std::size_t line = 0;
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            const auto* symbol = program.symbolAt(i);
+            if (symbol && symbol->begin == i) {
+                os << ".function " << symbol->name << '\n';
+            }
+            if (const auto* dbg = dynamic_cast<const DBG*>(program.at(i)); dbg && dbg->hasDebugFunction()) {
+                throw std::runtime_error("DBG at " + std::to_string(i) + " runs a host function and can't be disassembled");
+            }
+            if (program.lineAt(i) != line) {
+                line = program.lineAt(i);
+                os << ".line " << line << '\n';
+            }
+            os << std::left << std::setw(40) << program.at(i)->toString() << " ; " << i << '\n';
+            if (symbol && symbol->end == i + 1) {
+                os << ".endfunction\n";
+            }
+        }
+        os << std::flush;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../program.h"
+#include "../instruction.h"
+#include "programbuilder.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <variant>
+#include <unordered_map>
+#include <map>
+#include <functional>
+#include <stdexcept>
+#include <optional>
+
+namespace tiny::t86 {
+    /**
+     * Reads textual t86 assembly into a Program
+     *
+     * The accepted syntax is the one produced by Instruction::toString(),
+     * one instruction per line, so any listing written by disassemble() can be read back.
+     * On top of that it understands:
+     *   - labels ("loop:") which can be used in place of any immediate, typically as jump targets
+     *   - data directives (".data 1, 2, 3", ".string "Hello\n"", ".double 4.2"), a label in front
+     *     of a directive names the address of its first value
+     *   - ".function name" and ".endfunction" around the instructions of a function, which become
+     *     a symbol of the program
+     *   - ".line 12", source line of the following instructions, 0 when unknown
+     *   - comments starting with ';' or '#'
+     */
+    class Assembler {
+    public:
+        class ParseError;
+
+        Assembler(bool release = false) : release_(release) {}
+
+        Program assemble(std::istream& is);
+
+        Program assemble(const std::string& source);
+
+        // Writes the program in the form accepted by assemble()
+        static void disassemble(const Program& program, std::ostream& os);
+
+    private:
+        using Value = std::variant<int64_t, double, Register, FloatRegister, VectorRegister,
+                RegisterOffset, RegisterRegister, RegisterScaled,
+                RegisterOffsetRegister, RegisterRegisterScaled, RegisterOffsetRegisterScaled,
+                Memory::Immediate, Memory::Register, Memory::RegisterOffset, Memory::RegisterRegister, Memory::RegisterScaled,
+                Memory::RegisterOffsetRegister, Memory::RegisterRegisterScaled, Memory::RegisterOffsetRegisterScaled>;
+
+        struct Line {
+            std::size_t number;
+            std::string mnemonic;
+            std::vector<std::string> operands;
+        };
+
+        // Instructions are looked up by their mnemonic and the alternatives of the written operands
+        using Signature = std::pair<std::string, std::vector<std::size_t>>;
+
+        using Emitter = std::function<Label(ProgramBuilder&, const std::vector<Value>&)>;
+
+        static const std::map<Signature, Emitter>& emitters();
+
+        static bool knownMnemonic(const std::string& mnemonic);
+
+        template<typename T, typename... Args>
+        static void define(std::map<Signature, Emitter>& emitters, const std::string& mnemonic);
+
+        void parseLine(const std::string& text, std::size_t number);
+
+        void addData(const Line& line, ProgramBuilder& pb) const;
+
+        // Handles .function, .endfunction and .line, returns false for other lines
+        bool parseMetadata(const std::string& mnemonic, const std::string& rest, std::size_t number);
+
+        Value parseOperand(const std::string& text, std::size_t line) const;
+
+        int64_t parseInteger(const std::string& text, std::size_t line) const;
+
+        std::vector<Line> lines_;
+
+        std::unordered_map<std::string, int64_t> labels_;
+
+        // Labels waiting for the next instruction or data directive
+        std::vector<std::string> pendingLabels_;
+
+        std::vector<Program::Symbol> symbols_;
+
+        // Function whose .endfunction was not seen yet
+        std::optional<Program::Symbol> openSymbol_;
+
+        // Source line of every instruction, as set by the last .line
+        std::vector<std::size_t> instructionLines_;
+
+        std::size_t currentLine_{0};
+
+        std::size_t instructionCnt_{0};
+
+        std::size_t dataCnt_{0};
+
+        bool release_;
+    };
+
+    class Assembler::ParseError : public std::runtime_error {
+    public:
+        ParseError(std::size_t line, const std::string& message)
+                : std::runtime_error("Line " + std::to_string(line) + ": " + message) {}
+    };
+}
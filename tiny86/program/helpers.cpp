@@ -26,10 +26,18 @@ namespace tiny::t86 {
         return Register::StackBasePointer();
     }
 
+    Register CoreId() {
+        return Register::CoreId();
+    }
+
     FloatRegister FReg(size_t index) {
         return FloatRegister(index);
     }
 
+    VectorRegister VReg(size_t index) {
+        return VectorRegister(index);
+    }
+
     Memory::Register Mem(Register reg) {
         return Memory::Register(reg);
     }
@@ -19,8 +19,12 @@ namespace tiny::t86 {
 
     Register Bp();
 
+    Register CoreId();
+
     FloatRegister FReg(size_t index);
 
+    VectorRegister VReg(size_t index);
+
     // [reg]
     Memory::Register Mem(Register reg);
 
@@ -15,6 +15,8 @@ namespace tiny::t86 {
         ProgramBuilder(Program program, bool release = false)
                 : instructions_(program.moveInstructions()),
                   data_(program.data()),
+                  symbols_(program.symbols()),
+                  lines_(program.lines()),
                   release_(release) {}
 
         template<typename T>
@@ -56,8 +58,39 @@ namespace tiny::t86 {
             jmpInstruction->setDestination(destination);
         }
 
+        // Names instructions [begin, end), e.g. a function
+        void addSymbol(std::string name, std::size_t begin, std::size_t end) {
+            symbols_.push_back(Program::Symbol{std::move(name), begin, end});
+        }
+
+        // Source line of instructions [begin, end) which have none yet, so lines of nested constructs are kept
+        void addLines(std::size_t begin, std::size_t end, std::size_t line) {
+            if (line == 0) {
+                return;
+            }
+            if (lines_.size() < end) {
+                lines_.resize(end, 0);
+            }
+            for (std::size_t pc = begin; pc < end; ++pc) {
+                if (lines_[pc] == 0) {
+                    lines_[pc] = line;
+                }
+            }
+        }
+
+        // Current count of instructions, address of the next added one
+        std::size_t size() const {
+            return instructions_.size();
+        }
+
         Program program() {
-            return Program(std::move(instructions_), std::move(data_));
+            Program result(std::move(instructions_), std::move(data_));
+            for (auto& symbol : symbols_) {
+                result.addSymbol(std::move(symbol.name), symbol.begin, symbol.end);
+            }
+            symbols_.clear();
+            result.setLines(std::move(lines_));
+            return result;
         }
 
     private:
@@ -65,6 +98,10 @@ namespace tiny::t86 {
 
         std::vector<int64_t> data_;
 
+        std::vector<Program::Symbol> symbols_;
+
+        std::vector<std::size_t> lines_;
+
         bool release_;
     };
 }
@@ -1,14 +1,22 @@
 #include <cassert>
 
+#include <algorithm>
+
 #include "ram.h"
+#include "utils/stats_logger.h"
+
+using tiny::t86::StatsLogger;
 
-RAM::RAM(std::size_t memSize, std::size_t gatesCnt) : mem_(memSize, 0), gatesCnt_(gatesCnt) {}
+RAM::RAM(std::size_t memSize, std::size_t gatesCnt, std::size_t prefetchBufferSize)
+        : mem_(memSize, 0), gatesCnt_(gatesCnt), prefetchBufferSize_(prefetchBufferSize) {}
 
 void RAM::tick() {
     // writes and reads "linger" around for one tick after being finished
     for (auto writeIt = writes_.begin(); writeIt != writes_.end();) {
         auto& write = writeIt->second;
-        if (write.remainingCnt == 0) {
+        if (!write.scheduled) {
+            ++writeIt;
+        } else if (write.remainingCnt == 0) {
             // Remove from the helper lookup map
             writesById_.erase(write.id);
             // Remove from this map
@@ -21,20 +29,72 @@ void RAM::tick() {
 
     for (auto readIt = reads_.begin(); readIt != reads_.end();) {
         auto& read = readIt->second;
-        if (read.remainingCnt == 0) {
+        if (!read.scheduled) {
+            ++readIt;
+        } else if (read.remainingCnt == 0) {
+            readIt = reads_.erase(readIt);
+        } else if (--read.remainingCnt == 0 && read.prefetch) {
+            // Finished prefetch frees the gate right away
+            if (prefetched_.size() == prefetchBufferSize_) {
+                StatsLogger::instance().logPrefetchEvicted();
+                prefetched_.pop_front();
+            }
+            prefetched_.emplace_back(readIt->first, read.value);
             readIt = reads_.erase(readIt);
         } else {
-            --read.remainingCnt;
             ++readIt;
         }
     }
+
+    if (dram_) {
+        scheduleDram();
+    }
+}
+
+void RAM::setDramTiming(const DramTiming::Config& config) {
+    dram_.emplace(config);
+}
+
+void RAM::scheduleDram() {
+    for (const auto& started : dram_->schedule()) {
+        if (started.write) {
+            if (auto it = writes_.find(started.address); it != writes_.end() && !it->second.scheduled) {
+                it->second.scheduled = true;
+                it->second.remainingCnt = started.latency;
+            }
+        } else if (auto it = reads_.find(started.address); it != reads_.end() && !it->second.scheduled) {
+            it->second.scheduled = true;
+            it->second.remainingCnt = started.latency;
+        }
+    }
+}
+
+void RAM::startRead(std::size_t address, bool prefetch) {
+    if (dram_) {
+        reads_[address] = ReadEntry{0, mem_.at(address), prefetch, false};
+        dram_->enqueue(address, false);
+    } else {
+        reads_[address] = ReadEntry{flatLatency, mem_.at(address), prefetch};
+    }
 }
 
 std::optional<int64_t> RAM::read(std::size_t address) {
+    if (auto it = findPrefetched(address); it != prefetched_.end()) {
+        int64_t value = it->second;
+        prefetched_.erase(it);
+        StatsLogger::instance().logPrefetchUse(true);
+        return value;
+    }
+
     // Check reads
     if (auto it = reads_.find(address); it != reads_.end()) {
-        const auto& read = it->second;
-        if (read.remainingCnt == 0) {
+        auto& read = it->second;
+        if (read.prefetch) {
+            // Prefetch was issued, but too late
+            read.prefetch = false;
+            StatsLogger::instance().logPrefetchUse(false);
+        }
+        if (read.scheduled && read.remainingCnt == 0) {
             // Ready
             return read.value;
         } else {
@@ -47,23 +107,55 @@ std::optional<int64_t> RAM::read(std::size_t address) {
         // Start reading
         assert(reads_.find(address) == reads_.end());
         assert(writes_.find(address) == writes_.end() && "You should not read from address that is being written to");
-        reads_[address] = ReadEntry{5, mem_.at(address)};
+        startRead(address, false);
+        StatsLogger::instance().logDemandRead();
     }
 
     return std::nullopt;
 }
 
+bool RAM::prefetch(std::size_t address) {
+    if (prefetchBufferSize_ == 0 || isBusy() || address >= mem_.size() || reads_.find(address) != reads_.end()
+        || writes_.find(address) != writes_.end() || findPrefetched(address) != prefetched_.end()) {
+        return false;
+    }
+    startRead(address, true);
+    StatsLogger::instance().logPrefetchIssued();
+    return true;
+}
+
+std::deque<std::pair<std::size_t, int64_t>>::iterator RAM::findPrefetched(std::size_t address) {
+    return std::find_if(prefetched_.begin(), prefetched_.end(), [address](const auto& entry) { return entry.first == address; });
+}
+
 bool RAM::isBusy() const {
     return reads_.size() == gatesCnt_;
 }
 
 RAM::WriteId RAM::write(std::size_t address, int64_t value) {
     mem_.at(address) = value;
+    // Prefetched values must not get stale
+    if (auto it = findPrefetched(address); it != prefetched_.end()) {
+        it->second = value;
+    }
+    if (auto it = reads_.find(address); it != reads_.end() && it->second.prefetch) {
+        it->second.value = value;
+    }
     WriteId id = writeIdCounter++;
+    // Unscheduled write to the same address already has its request in DRAM queue
+    bool queued = false;
     if (auto it = writes_.find(address); it != writes_.end()) {
         writesById_.erase(it->second.id);
+        queued = !it->second.scheduled;
     }
-    writesById_.insert(std::make_pair(id, std::cref(writes_[address] = WriteEntry{id, 5, value})));
+    WriteEntry entry{id, flatLatency, value};
+    if (dram_) {
+        entry = WriteEntry{id, 0, value, false};
+        if (!queued) {
+            dram_->enqueue(address, true);
+        }
+    }
+    writesById_.insert(std::make_pair(id, std::cref(writes_[address] = entry)));
     return id;
 }
 
@@ -73,6 +165,10 @@ int64_t RAM::get(std::size_t address) const {
 
 void RAM::set(std::size_t address, int64_t value) {
     mem_.at(address) = value;
+    // Atomic instructions write through here, prefetched values must not get stale either
+    if (auto it = findPrefetched(address); it != prefetched_.end()) {
+        it->second = value;
+    }
 }
 
 std::size_t RAM::size() const {
@@ -3,15 +3,19 @@
 #include <array>
 #include <optional>
 #include <list>
+#include <deque>
 #include <cstdint>
 #include <unordered_map>
 #include <functional>
 
+#include "dram_timing.h"
+
 class RAM {
 public:
     using WriteId = size_t;
 
-    RAM(std::size_t memSize, std::size_t gatesCnt);
+    // Finished prefetches wait in the buffer of given size until a read asks for them
+    RAM(std::size_t memSize, std::size_t gatesCnt, std::size_t prefetchBufferSize = 0);
 
     void tick();
 
@@ -19,18 +23,29 @@ public:
 
     WriteId write(std::size_t address, int64_t value);
 
+    // Starts read of the address if there is a free gate, nothing is returned.
+    // Returns false when the read was not started (busy gates, invalid or already pending address)
+    bool prefetch(std::size_t address);
+
     bool isBusy() const;
 
+    // Without DRAM timing every access takes flatLatency ticks
+    void setDramTiming(const DramTiming::Config& config);
+
+    constexpr static std::size_t flatLatency = 5;
+
     std::size_t size() const;
 
     bool pending(WriteId id) const;
 
-public: /// These functions should be used only for debug purposes
+public: /// Access without any timing, for debugging and for the caches of a System, which do the timing themselves
     int64_t get(std::size_t address) const;
 
     void set(std::size_t address, int64_t value);
 
 private:
+    std::deque<std::pair<std::size_t, int64_t>>::iterator findPrefetched(std::size_t address);
+
     WriteId writeIdCounter {0};
 
     // TODO changeable mem size
@@ -41,18 +56,35 @@ private:
     struct ReadEntry {
         std::size_t remainingCnt;
         int64_t value;
+        // Started by prefetch and not asked for by read yet
+        bool prefetch{false};
+        // Waiting in DRAM queue while false, remainingCnt is not known yet
+        bool scheduled{true};
     };
 
     struct WriteEntry {
         WriteId id;
         std::size_t remainingCnt;
         int64_t value;
+        bool scheduled{true};
     };
 
+    void startRead(std::size_t address, bool prefetch);
+
+    // Starts service of requests chosen by DRAM scheduler
+    void scheduleDram();
+
     std::unordered_map<size_t, ReadEntry> reads_;
 
     std::unordered_map<size_t, WriteEntry> writes_;
 
+    std::size_t prefetchBufferSize_;
+
+    // Finished prefetches, oldest first
+    std::deque<std::pair<std::size_t, int64_t>> prefetched_;
+
+    std::optional<DramTiming> dram_;
+
     // Helper lookup map by id
     std::unordered_map<WriteId, std::reference_wrapper<const WriteEntry>> writesById_;
 };
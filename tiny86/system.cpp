@@ -0,0 +1,104 @@
+#include "system.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace tiny::t86 {
+    System::System(std::size_t coresCnt)
+            : ram_(Cpu::Config::instance().ramSize(), Cpu::Config::instance().ramGatesCount()),
+              bus_(Cpu::Config::instance().coherenceProtocol(), Cpu::Config::instance().coherenceLatency()) {
+        if (coresCnt == 0) {
+            throw std::invalid_argument("System needs at least one core");
+        }
+        if (coresCnt * Cpu::Config::instance().coreStackSize() >= ram_.size()) {
+            throw std::invalid_argument("Stacks of " + std::to_string(coresCnt) + " cores do not fit into the RAM");
+        }
+        if (auto dramTiming = Cpu::Config::instance().dramTiming()) {
+            ram_.setDramTiming(*dramTiming);
+        }
+        for (std::size_t i = 0; i < coresCnt; ++i) {
+            caches_.push_back(std::make_unique<CoherentCache>(bus_,
+                                                              Cpu::Config::instance().dataCacheSize(),
+                                                              Cpu::Config::instance().dataCacheAssociativity(),
+                                                              Cpu::Config::instance().dataCacheLineSize()));
+            loggers_.push_back(std::unique_ptr<StatsLogger>(new StatsLogger()));
+            cores_.push_back(std::make_unique<Cpu>(ram_, *caches_.back(), io_, i));
+        }
+    }
+
+    void System::start(const Program& program) {
+        // Stacks take the RAM above the globals, the cores grow them downwards from the end of the RAM
+        std::size_t free = ram_.size() - std::min(program.data().size(), ram_.size());
+        std::size_t stackSize = Cpu::Config::instance().coreStackSize();
+        if (stackSize == 0) {
+            stackSize = free / cores_.size();
+        }
+        if (stackSize == 0 || stackSize * cores_.size() > free) {
+            throw std::invalid_argument("Stacks of " + std::to_string(cores_.size())
+                                        + " cores do not fit into the RAM above the globals");
+        }
+        for (std::size_t i = 0; i < cores_.size(); ++i) {
+            StatsLogger::select(loggers_[i].get());
+            cores_[i]->start(Program::borrow(program));
+            cores_[i]->setStack(ram_.size() - i * stackSize, ram_.size() - (i + 1) * stackSize);
+        }
+        StatsLogger::select(nullptr);
+    }
+
+    void System::tick() {
+        StatsLogger::select(loggers_.front().get());
+        ram_.tick();
+        bus_.tick(ram_);
+        for (auto& cache : caches_) {
+            cache->tick(ram_);
+        }
+        // Cores tick after the bus, so a line filled in this tick can be used right away
+        for (std::size_t i = 0; i < cores_.size(); ++i) {
+            if (!cores_[i]->halted()) {
+                StatsLogger::select(loggers_[i].get());
+                cores_[i]->tick();
+            }
+        }
+        StatsLogger::select(nullptr);
+        ++ticks_;
+    }
+
+    bool System::halted() const {
+        return std::all_of(cores_.begin(), cores_.end(), [](const auto& core) {
+            return core->halted();
+        });
+    }
+
+    std::size_t System::retiredCount() const {
+        std::size_t retired = 0;
+        for (const auto& logger : loggers_) {
+            retired += logger->retiredCount();
+        }
+        return retired;
+    }
+
+    void System::printStats(std::ostream& os) const {
+        os << "------------------------------------------\n";
+        os << "Cores: " << cores_.size() << ", "
+           << (bus_.protocol() == CoherenceBus::Protocol::mesi ? "MESI" : "MSI") << " coherence\n";
+        os << "Total ticks: " << ticks_ << '\n';
+        os << "Total instructions executed: " << retiredCount() << '\n';
+        os << "Throughput: " << static_cast<double>(retiredCount()) / ticks_ << " instructions per tick\n";
+        for (std::size_t i = 0; i < cores_.size(); ++i) {
+            std::size_t ticks = loggers_[i]->tickCount();
+            std::size_t retired = loggers_[i]->retiredCount();
+            const auto& stats = caches_[i]->stats();
+            os << "  Core " << i << ": " << retired << " instructions retired, halted at tick " << ticks
+               << ", " << static_cast<double>(retired) / ticks << " instructions per tick\n";
+            os << "    Data cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+               << stats.upgrades << " upgrades, " << stats.invalidations << " invalidations, "
+               << stats.writebacks << " writebacks\n";
+        }
+        const auto& bus = bus_.stats();
+        os << "Coherence bus: " << bus.transactions << " transactions, "
+           << bus.cacheTransfers << " cache to cache, " << bus.memoryFills << " from memory, "
+           << bus.upgrades << " upgrades, busy " << 100.0 * bus.busyTicks / ticks_ << "% of ticks\n";
+        os << std::flush;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstddef>
+
+#include "cpu.h"
+#include "ram.h"
+#include "program.h"
+#include "io_channel.h"
+#include "cpu/coherent_cache.h"
+#include "cpu/coherence_bus.h"
+#include "utils/stats_logger.h"
+
+namespace tiny::t86 {
+    /**
+     * Cores with private coherent data caches sharing one RAM
+     *
+     * All cores run the same program in the same address space and tell themselves apart
+     * by the CoreId register, so they can coordinate through globals and atomic instructions.
+     * Every core logs into its own StatsLogger, the RAM and the bus log into the one of core 0.
+     * Sizes of the cores, caches and the RAM come from Cpu::Config.
+     */
+    class System {
+    public:
+        // Throws std::invalid_argument for no cores or when their stacks do not fit into the RAM
+        explicit System(std::size_t coresCnt);
+
+        std::size_t coresCount() const {
+            return cores_.size();
+        }
+
+        Cpu& core(std::size_t index) {
+            return *cores_.at(index);
+        }
+
+        IOChannel& io() {
+            return io_;
+        }
+
+        // The program has to outlive the system, its instructions are shared by the cores.
+        // Throws std::invalid_argument when the stacks of the cores do not fit into the RAM above the globals
+        void start(const Program& program);
+
+        void tick();
+
+        bool halted() const;
+
+        std::size_t tickCount() const {
+            return ticks_;
+        }
+
+        std::size_t retiredCount() const;
+
+        void printStats(std::ostream& os) const;
+
+    private:
+        RAM ram_;
+
+        CoherenceBus bus_;
+
+        // Shared by the cores, so their output is not reordered by separate buffers
+        IOChannel io_;
+
+        std::vector<std::unique_ptr<CoherentCache>> caches_;
+
+        std::vector<std::unique_ptr<StatsLogger>> loggers_;
+
+        std::vector<std::unique_ptr<Cpu>> cores_;
+
+        std::size_t ticks_{0};
+    };
+}
@@ -1,10 +1,24 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <filesystem>
+#include <optional>
+#include <functional>
+#include <cstdlib>
+#include <unistd.h>
 
 #include "utils/stats_logger.h"
+#include "utils/pipe_view_writer.h"
+#include "utils/host_profiler.h"
 #include "program.h"
+#include "program/assembler.h"
 #include "cpu.h"
+#include "system.h"
+#include "trace/trace_replay.h"
+#include "trace/dataflow_analyzer.h"
 #include "common/config.h"
 
 namespace tiny {
@@ -14,20 +28,272 @@ namespace tiny {
 
         using EXE = t86::Program;
 
+        // Annotated listing of the per-pc profile is written to this file
+        constexpr static const char* pcProfileConfigString = "-pcProfile";
+
+        // Per-pc profile as CSV is written to this file
+        constexpr static const char* pcProfileCsvConfigString = "-pcProfileCsv";
+
+        // Flat profile and call graph of the compiled functions are written to this file
+        constexpr static const char* functionProfileConfigString = "-functionProfile";
+
+        // Per source line profile of compiled programs is written to this file
+        constexpr static const char* lineProfileConfigString = "-lineProfile";
+
+        // Pipeline occupancy in Chrome trace-event JSON is written to this file
+        constexpr static const char* chromeTraceConfigString = "-chromeTrace";
+
+        // Per instruction stage timelines (Konata) are written to this file
+        constexpr static const char* pipeViewConfigString = "-pipeView";
+
+        // Format of -pipeView, kanata or o3 (gem5 O3PipeView)
+        constexpr static const char* pipeViewFormatConfigString = "-pipeViewFormat";
+
+        // Only ticks in from:to are written to -pipeView, both bounds are optional
+        constexpr static const char* pipeViewRangeConfigString = "-pipeViewRange";
+
+        // Host time spent in the phases of Cpu::tick is printed when set to non-empty value
+        constexpr static const char* hostProfileConfigString = "-hostProfile";
+
+        // Dynamic trace of retired instructions is written to this file
+        constexpr static const char* traceConfigString = "-trace";
+
+        // Instead of running, the program is replayed from this trace (recorded with -trace)
+        constexpr static const char* replayConfigString = "-replay";
+
+        // Comma separated aluCnt/reservationStationEntriesCnt/ramGatesCnt[/frontendStages] configurations for -replay
+        constexpr static const char* replayConfigsConfigString = "-replayConfigs";
+
+        // Limit study of the run is printed when set to non-empty value
+        constexpr static const char* limitStudyConfigString = "-limitStudy";
+
+        // Comma separated programs started on hardware threads 1, 2, ... next to the executable, *.t86 files
+        // are assembled, others are compiled with coRunCompiler
+        constexpr static const char* smtCoRunConfigString = "-smtCoRun";
+
+        // Comma separated core counts, the executable runs on a System of each size and the scaling is printed
+        constexpr static const char* coresConfigString = "-cores";
+
+        // GETCHAR reads from this file instead of the standard input
+        constexpr static const char* inputConfigString = "-input";
+
+        /** Compiles sources of -smtCoRun which are not t86 assembly, set by drivers which link a compiler
+         */
+        std::function<EXE(const std::string& source)> coRunCompiler;
+
         /** Runs the given executable.
 
             The signature is fixed, so the CPU has to take the program as a const ref.
          */
         void execute(EXE exe) {
+            config.setDefaultIfMissing(replayConfigString, "");
+            if (const std::string& path = config.get(replayConfigString); !path.empty()) {
+                replay(exe, path);
+                return;
+            }
+            config.setDefaultIfMissing(coresConfigString, "");
+            if (const std::string& cores = config.get(coresConfigString); !cores.empty()) {
+                runSystems(exe, cores);
+                return;
+            }
+
             t86::StatsLogger::instance().reset();
+            // Written during the run, so the trace of a long run is not kept in memory
+            config.setDefaultIfMissing(chromeTraceConfigString, "");
+            std::ofstream chromeTrace;
+            if (const std::string& path = config.get(chromeTraceConfigString); !path.empty()) {
+                chromeTrace.open(path);
+                t86::StatsLogger::instance().startChromeTrace(chromeTrace);
+            }
+            config.setDefaultIfMissing(hostProfileConfigString, "");
+            bool hostProfile = !config.get(hostProfileConfigString).empty();
+            t86::HostProfiler::instance().reset();
+            t86::HostProfiler::instance().enable(hostProfile);
+
+            config.setDefaultIfMissing(traceConfigString, "");
+            config.setDefaultIfMissing(limitStudyConfigString, "");
+            std::string tracePath = config.get(traceConfigString);
+            bool limitStudy = !config.get(limitStudyConfigString).empty();
+            std::optional<TemporaryFile> temporaryTrace;
+            if (limitStudy && tracePath.empty()) {
+                tracePath = temporaryTrace.emplace("t86-limit-study").path();
+            }
+            std::unique_ptr<t86::TraceWriter> traceWriter;
+            if (!tracePath.empty()) {
+                traceWriter = std::make_unique<t86::TraceWriter>(tracePath, exe.size());
+            }
 
             t86::Cpu cpu;
+            connectInput(cpu.io());
+            cpu.connectTraceWriter(traceWriter.get());
             cpu.start(std::move(exe));
+            startCoRun(cpu);
 
             while (!cpu.halted()) {
                 cpu.tick();
             }
+            traceWriter.reset();
+            t86::StatsLogger::instance().finishChromeTrace();
+            t86::HostProfiler::instance().enable(false);
             t86::StatsLogger::instance().processBasicStats(std::cerr);
+            t86::StatsLogger::instance().processTopDownStats(std::cerr);
+            if (hostProfile) {
+                t86::HostProfiler::instance().print(std::cerr, t86::StatsLogger::instance().retiredCount());
+            }
+
+            if (limitStudy) {
+                t86::TraceReader trace(tracePath);
+                t86::DataflowAnalyzer analyzer(cpu.program(), trace);
+                t86::DataflowAnalyzer::printResults(analyzer.analyze(analyzer.limitStudy()),
+                                                    t86::StatsLogger::instance().tickCount(), std::cerr);
+            }
+
+            config.setDefaultIfMissing(pcProfileConfigString, "");
+            config.setDefaultIfMissing(pcProfileCsvConfigString, "");
+            if (const std::string& path = config.get(pcProfileConfigString); !path.empty()) {
+                std::ofstream os(path);
+                t86::StatsLogger::instance().processPcProfile(os, &cpu.program());
+            }
+            if (const std::string& path = config.get(pcProfileCsvConfigString); !path.empty()) {
+                std::ofstream os(path);
+                t86::StatsLogger::instance().processPcProfileCsv(os, &cpu.program());
+            }
+            config.setDefaultIfMissing(functionProfileConfigString, "");
+            if (const std::string& path = config.get(functionProfileConfigString); !path.empty()) {
+                std::ofstream os(path);
+                t86::StatsLogger::instance().processFunctionProfile(os, cpu.program());
+            }
+            config.setDefaultIfMissing(lineProfileConfigString, "");
+            if (const std::string& path = config.get(lineProfileConfigString); !path.empty()) {
+                std::ofstream os(path);
+                t86::StatsLogger::instance().processLineProfile(os, cpu.program());
+            }
+            config.setDefaultIfMissing(pipeViewConfigString, "");
+            config.setDefaultIfMissing(pipeViewFormatConfigString, "kanata");
+            config.setDefaultIfMissing(pipeViewRangeConfigString, ":");
+            if (const std::string& path = config.get(pipeViewConfigString); !path.empty()) {
+                auto format = t86::PipeViewWriter::parseFormat(config.get(pipeViewFormatConfigString));
+                auto [from, to] = t86::PipeViewWriter::parseRange(config.get(pipeViewRangeConfigString));
+                std::ofstream os(path);
+                t86::StatsLogger::instance().processPipeView(os, format, from, to);
+            }
+        }
+
+        /** Every run reads -input from its beginning
+         */
+        void connectInput(t86::IOChannel& io) {
+            config.setDefaultIfMissing(inputConfigString, "");
+            if (const std::string& path = config.get(inputConfigString); !path.empty()) {
+                io.openInput(path);
+            }
+        }
+
+        /** Uniquely named file in the temporary directory, removed when it goes out of scope
+         */
+        class TemporaryFile {
+        public:
+            explicit TemporaryFile(const std::string& prefix) {
+                std::string path = (std::filesystem::temp_directory_path() / (prefix + ".XXXXXX")).string();
+                int fd = mkstemp(path.data());
+                if (fd < 0) {
+                    throw std::runtime_error("Can't create temporary file " + path);
+                }
+                close(fd);
+                path_ = path;
+            }
+
+            TemporaryFile(const TemporaryFile&) = delete;
+            TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+            ~TemporaryFile() {
+                std::error_code ec;
+                std::filesystem::remove(path_, ec);
+            }
+
+            const std::string& path() const { return path_; }
+
+        private:
+            std::string path_;
+        };
+
+        /** Starts the programs of -smtCoRun on the other hardware threads of the cpu
+         */
+        void startCoRun(t86::Cpu& cpu) {
+            config.setDefaultIfMissing(smtCoRunConfigString, "");
+            std::istringstream is(config.get(smtCoRunConfigString));
+            std::size_t thread = 1;
+            for (std::string path; std::getline(is, path, ','); ++thread) {
+                if (thread >= cpu.threadsCount()) {
+                    throw std::runtime_error(STR("Not enough hardware threads for " << path << ", set "
+                                                 << t86::Cpu::Config::smtThreadsConfigString << " to at least " << thread + 1));
+                }
+                std::ifstream file(path);
+                if (!file) {
+                    throw std::runtime_error("Can't open " + path);
+                }
+                if (std::filesystem::path(path).extension() == ".t86") {
+                    cpu.start(t86::Assembler().assemble(file), thread);
+                } else if (coRunCompiler) {
+                    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    cpu.start(coRunCompiler(source), thread);
+                } else {
+                    throw std::runtime_error("No compiler for " + path + ", only t86 assembly can be co-run here");
+                }
+            }
+        }
+
+        /** Runs the executable on systems with given core counts, one after another
+         */
+        void runSystems(const EXE& exe, const std::string& cores) {
+            struct Run {
+                std::size_t cores;
+                std::size_t ticks;
+                double throughput;
+            };
+            std::vector<Run> runs;
+            std::istringstream is(cores);
+            for (std::string item; std::getline(is, item, ',');) {
+                t86::System system(std::stoul(item));
+                connectInput(system.io());
+                system.start(exe);
+                while (!system.halted()) {
+                    system.tick();
+                }
+                system.printStats(std::cerr);
+                runs.push_back({system.coresCount(), system.tickCount(),
+                                static_cast<double>(system.retiredCount()) / system.tickCount()});
+            }
+            if (runs.size() < 2) {
+                return;
+            }
+            // Speedup fits programs splitting the work among the cores, throughput ones where every core does all of it
+            const Run& base = runs.front();
+            std::cerr << "Scaling against " << base.cores << " cores:\n";
+            for (const Run& run : runs) {
+                double speedup = static_cast<double>(base.ticks) / run.ticks;
+                double throughput = run.throughput / base.throughput;
+                std::cerr << "  " << run.cores << " cores: " << run.ticks << " ticks, speedup " << speedup
+                          << ", throughput " << throughput << "x, efficiency "
+                          << throughput * base.cores / run.cores << '\n';
+            }
+        }
+
+        /** Replays recorded trace of the executable in all requested configurations
+         */
+        void replay(const EXE& exe, const std::string& tracePath) {
+            t86::TraceReader trace(tracePath);
+            t86::TraceReplay replay(exe, trace);
+
+            config.setDefaultIfMissing(replayConfigsConfigString, "");
+            std::vector<t86::TraceReplay::Config> configs;
+            std::istringstream is(config.get(replayConfigsConfigString));
+            for (std::string item; std::getline(is, item, ',');) {
+                configs.push_back(t86::TraceReplay::Config::parse(item));
+            }
+            if (configs.empty()) {
+                configs.push_back(t86::TraceReplay::Config::fromCpuConfig());
+            }
+            t86::TraceReplay::printResults(replay.run(configs), std::cerr);
         }
 
     }; // Target
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "dataflow_analyzer.h"
+#include "../cpu.h"
+#include "../cpu/branch_predictors/naive_branch_predictor.h"
+
+namespace tiny::t86 {
+    DataflowAnalyzer::DataflowAnalyzer(const Program& program, const TraceReader& trace)
+            : trace_(trace), program_(program) {
+        if (program.size() != trace.programSize()) {
+            throw std::runtime_error("Trace was recorded from a program with " + std::to_string(trace.programSize())
+                                     + " instructions, given program has " + std::to_string(program.size()));
+        }
+    }
+
+    DataflowAnalyzer::Result DataflowAnalyzer::analyze(const Limits& limits) const {
+        Result result{limits.name};
+        NaiveBranchPredictor predictor;
+        // Tick in which the value of register / memory address is known
+        std::vector<std::size_t> registerReady(program_.registersCount(), 0);
+        std::unordered_map<uint64_t, std::size_t> memoryReady;
+        // Retirement ticks of instructions still in reservation station
+        std::deque<std::size_t> window;
+        std::vector<std::size_t> aluFree(limits.aluCnt.value_or(0), 0);
+        std::size_t lastFetch = 0;
+        std::size_t lastRetire = 0;
+        // Nothing after mispredicted jump can enter the pipeline before this tick
+        std::size_t controlBarrier = 0;
+        // Nothing after serializing instruction can enter the pipeline before it is finished
+        std::size_t serializeBarrier = 0;
+        // Tick in which all memory writes so far are finished
+        std::size_t writesDrained = 0;
+
+        for (const TraceRecord& record : trace_) {
+            if (record.pc >= program_.size()) {
+                throw std::runtime_error("Trace does not match the program, pc " + std::to_string(record.pc) + " out of range");
+            }
+            const StaticInstruction& info = program_.at(record.pc);
+
+            std::size_t start = std::max(controlBarrier, serializeBarrier);
+            if (limits.fetchBandwidth) {
+                start = lastFetch = std::max(lastFetch + 1, start);
+            }
+            if (limits.reservationStationEntriesCnt && window.size() == *limits.reservationStationEntriesCnt) {
+                start = std::max(start, window.front());
+                window.pop_front();
+            }
+            if (info.serializing) {
+                // Starts as the oldest instruction once all writes are finished, whatever the limits
+                start = std::max({start, lastRetire, writesDrained});
+            }
+            for (const auto& operand : info.operands) {
+                for (const auto& step : operand) {
+                    if (!step.memory) {
+                        start = std::max(start, registerReady[step.reg]);
+                    }
+                }
+            }
+            std::size_t memoryLatency = 0;
+            for (uint64_t address : record.memoryReads) {
+                auto it = memoryReady.find(address);
+                std::size_t written = it == memoryReady.end() ? 0 : it->second;
+                start = std::max(start, written);
+                // Value of a recent write is forwarded, otherwise it has to come from RAM
+                if (limits.memoryLatency && (it == memoryReady.end() || start >= written + limits.ramLatency)) {
+                    memoryLatency = limits.ramLatency;
+                }
+            }
+            // Operands are fetched (including memory) before the execution starts
+            std::size_t executionStart = start + memoryLatency;
+            if (info.needsAlu && !aluFree.empty()) {
+                auto alu = std::min_element(aluFree.begin(), aluFree.end());
+                executionStart = std::max(executionStart, *alu);
+                *alu = executionStart + info.executionLength;
+            }
+            std::size_t finish = executionStart + info.executionLength;
+
+            for (std::size_t reg : info.produces) {
+                registerReady[reg] = finish;
+            }
+            for (uint64_t address : record.memoryWrites) {
+                memoryReady[address] = finish;
+                writesDrained = std::max(writesDrained, finish + (limits.memoryLatency ? limits.ramLatency : 0));
+            }
+            lastRetire = std::max(lastRetire, finish);
+            if (info.serializing) {
+                serializeBarrier = finish;
+            }
+            if (limits.reservationStationEntriesCnt) {
+                window.push_back(lastRetire);
+            }
+            if (limits.branchPrediction) {
+                bool mispredicted = info.jump && predictor.nextGuess(record.pc, static_cast<const JumpInstruction&>(*info.instruction)) != record.target;
+                if (mispredicted || info.flushing) {
+                    controlBarrier = lastRetire;
+                }
+            }
+            ++result.instructions;
+        }
+        result.criticalPath = lastRetire;
+        return result;
+    }
+
+    std::vector<DataflowAnalyzer::Limits> DataflowAnalyzer::limitStudy() const {
+        const auto& cpuConfig = Cpu::Config::instance();
+        std::vector<Limits> result;
+        Limits limits{"Dataflow"};
+        result.push_back(limits);
+        limits.name = "+ fetch 1 per tick";
+        limits.fetchBandwidth = true;
+        result.push_back(limits);
+        limits.name = "+ memory latency";
+        limits.memoryLatency = true;
+        result.push_back(limits);
+        limits.name = "+ branch prediction";
+        limits.branchPrediction = true;
+        result.push_back(limits);
+        limits.name = "+ " + std::to_string(cpuConfig.reservationStationEntriesCnt()) + " RS entries";
+        limits.reservationStationEntriesCnt = cpuConfig.reservationStationEntriesCnt();
+        result.push_back(limits);
+        limits.name = "+ " + std::to_string(cpuConfig.aluCnt()) + " ALUs";
+        limits.aluCnt = cpuConfig.aluCnt();
+        result.push_back(limits);
+        return result;
+    }
+
+    std::vector<DataflowAnalyzer::Result> DataflowAnalyzer::analyze(const std::vector<Limits>& limits) const {
+        std::vector<Result> result;
+        for (const auto& limit : limits) {
+            result.push_back(analyze(limit));
+        }
+        return result;
+    }
+
+    void DataflowAnalyzer::printResults(const std::vector<Result>& results, std::size_t actualTicks, std::ostream& os) {
+        os << "------------------------------------------\n";
+        os << "Limit study (limits are added one by one):\n";
+        os << std::left << std::setw(24) << "Limits" << std::right << std::setw(12) << "Ticks"
+           << std::setw(8) << "IPC" << std::setw(12) << "Of actual" << "\n";
+        auto line = [&](const std::string& name, std::size_t ticks, std::size_t instructions) {
+            os << std::left << std::setw(24) << name << std::right << std::setw(12) << ticks
+               << std::setw(8) << std::fixed << std::setprecision(3)
+               << (ticks ? static_cast<double>(instructions) / ticks : 0)
+               << std::setw(10) << std::setprecision(2) << (actualTicks ? 100.0 * ticks / actualTicks : 0) << " %"
+               << std::defaultfloat << "\n";
+        };
+        std::size_t instructions = 0;
+        for (const auto& result : results) {
+            line(result.name, result.criticalPath, result.instructions);
+            instructions = result.instructions;
+        }
+        line("Actual", actualTicks, instructions);
+        os << std::flush;
+    }
+}
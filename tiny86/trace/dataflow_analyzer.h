@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <iostream>
+
+#include "../program.h"
+#include "../ram.h"
+#include "trace_reader.h"
+#include "static_program.h"
+
+namespace tiny::t86 {
+    /**
+     * Limit study of a recorded run
+     *
+     * Every instruction of the trace is scheduled as soon as its inputs are known - registers
+     * through produces() of the last writer, memory through the last store to the same address
+     * and, without perfect prediction, everything after a mispredicted jump waits for the jump.
+     * Serializing instructions (FENCE, atomics, RDPMC) order the run regardless of the limits,
+     * they start after everything before them and everything after them waits for them.
+     * The longest such chain is the critical path, with everything else ideal it is the best
+     * the program can ever run in. The resources of the real cpu are then added one by one,
+     * so it can be seen which of them costs the most compared to the real tick count.
+     */
+    class DataflowAnalyzer {
+    public:
+        struct Limits {
+            std::string name;
+
+            // One instruction enters the pipeline per tick
+            bool fetchBandwidth{false};
+
+            // Memory reads not forwarded from recent stores wait for RAM
+            bool memoryLatency{false};
+
+            // Instructions after mispredicted jump wait until it is resolved
+            bool branchPrediction{false};
+
+            // Empty means infinite
+            std::optional<std::size_t> reservationStationEntriesCnt{};
+
+            std::optional<std::size_t> aluCnt{};
+
+            std::size_t ramLatency{RAM::flatLatency};
+        };
+
+        struct Result {
+            std::string name;
+
+            std::size_t criticalPath{0};
+
+            std::size_t instructions{0};
+
+            double ipc() const {
+                return criticalPath ? static_cast<double>(instructions) / criticalPath : 0;
+            }
+        };
+
+        // Throws std::runtime_error if the trace was not recorded from given program
+        DataflowAnalyzer(const Program& program, const TraceReader& trace);
+
+        Result analyze(const Limits& limits) const;
+
+        // From pure dataflow to all limits of the current cpu configuration
+        std::vector<Limits> limitStudy() const;
+
+        std::vector<Result> analyze(const std::vector<Limits>& limits) const;
+
+        static void printResults(const std::vector<Result>& results, std::size_t actualTicks, std::ostream& os);
+
+    private:
+        const TraceReader& trace_;
+
+        StaticProgram program_;
+    };
+}
@@ -0,0 +1,69 @@
+#include "static_program.h"
+#include "../instruction.h"
+#include "../cpu.h"
+
+namespace tiny::t86 {
+    StaticProgram::StaticProgram(const Program& program) {
+        instructions_.reserve(program.size());
+        for (std::size_t pc = 0; pc < program.size(); ++pc) {
+            const Instruction* instruction = program.at(pc);
+            StaticInstruction info{instruction, instruction->needsAlu(),
+                                   Cpu::Config::instance().getExecutionLength(instruction)};
+            // Walk the requirements the same way reservation station does, with dummy values
+            for (Operand operand : instruction->operands()) {
+                auto& steps = info.operands.emplace_back();
+                while (!operand.isFetched()) {
+                    Requirement requirement = operand.requirement();
+                    if (requirement.isRegisterRead()) {
+                        Register reg = requirement.getRegisterRead();
+                        // Program counter is always known when entering reservation station
+                        if (reg != Register::ProgramCounter()) {
+                            steps.push_back({false, registerIndex(reg)});
+                        }
+                        operand.supply(static_cast<int64_t>(0));
+                    } else if (requirement.isFloatRegisterRead()) {
+                        steps.push_back({false, registerIndex(requirement.getFloatRegisterRead())});
+                        operand.supply(0.0);
+                    } else if (requirement.isVectorRegisterRead()) {
+                        steps.push_back({false, registerIndex(requirement.getVectorRegisterRead())});
+                        operand.supply(VectorRegister::Value{});
+                    } else {
+                        steps.push_back({true, 0});
+                        operand.supply(static_cast<int64_t>(0));
+                    }
+                }
+            }
+            info.immediateWrites = true;
+            for (const Product& product : instruction->produces()) {
+                if (product.isRegister()) {
+                    if (product.getRegister() != Register::ProgramCounter()) {
+                        info.produces.push_back(registerIndex(product.getRegister()));
+                    }
+                } else if (product.isFloatRegister()) {
+                    info.produces.push_back(registerIndex(product.getFloatRegister()));
+                } else if (product.isVectorRegister()) {
+                    info.produces.push_back(registerIndex(product.getVectorRegister()));
+                } else if (product.isMemoryRegister()) {
+                    info.immediateWrites = false;
+                }
+            }
+            info.jump = dynamic_cast<const JumpInstruction*>(instruction) != nullptr;
+            info.flushing = instruction->type() == Instruction::Type::DBG || instruction->type() == Instruction::Type::BREAK;
+            info.serializing = instruction->serializing();
+            info.halt = instruction->type() == Instruction::Type::HALT;
+            instructions_.push_back(std::move(info));
+        }
+    }
+
+    std::size_t StaticProgram::registerIndex(Register reg) {
+        return registerIndices_.emplace(reg, registerIndices_.size()).first->second;
+    }
+
+    std::size_t StaticProgram::registerIndex(FloatRegister fReg) {
+        return registerIndices_.emplace(fReg, registerIndices_.size()).first->second;
+    }
+
+    std::size_t StaticProgram::registerIndex(VectorRegister vReg) {
+        return registerIndices_.emplace(vReg, registerIndices_.size()).first->second;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <variant>
+
+#include "../program.h"
+#include "../cpu/register.h"
+
+namespace tiny::t86 {
+    /**
+     * What an instruction reads and writes, as needed by trace analyses
+     *
+     * Registers are given dense indices (shared by general purpose, special and float registers)
+     * so the analyses can keep their state in plain vectors.
+     */
+    struct StaticInstruction {
+        // What instruction needs to be supplied with, in order, the same way reservation station asks for it
+        struct Step {
+            bool memory;
+            // Dense index of the register
+            std::size_t reg;
+        };
+
+        const Instruction* instruction;
+        bool needsAlu;
+        std::size_t executionLength;
+        std::vector<std::vector<Step>> operands{};
+        // Written registers, program counter is left out
+        std::vector<std::size_t> produces{};
+        // Written addresses are known as soon as the instruction enters reservation station
+        bool immediateWrites{false};
+        bool jump{false};
+        // DBG and BREAK clear the pipeline on retirement
+        bool flushing{false};
+        // Starts only as the oldest instruction with all writes drained, nothing after it is dispatched meanwhile
+        bool serializing{false};
+        bool halt{false};
+    };
+
+    class StaticProgram {
+    public:
+        explicit StaticProgram(const Program& program);
+
+        std::size_t size() const {
+            return instructions_.size();
+        }
+
+        const StaticInstruction& at(std::size_t pc) const {
+            return instructions_[pc];
+        }
+
+        std::size_t registersCount() const {
+            return registerIndices_.size();
+        }
+
+    private:
+        std::size_t registerIndex(Register reg);
+
+        std::size_t registerIndex(FloatRegister fReg);
+
+        std::size_t registerIndex(VectorRegister vReg);
+
+        std::vector<StaticInstruction> instructions_;
+
+        std::map<std::variant<Register, FloatRegister, VectorRegister>, std::size_t> registerIndices_;
+    };
+}
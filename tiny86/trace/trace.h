@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace tiny::t86 {
+    /**
+     * One retired instruction of a dynamic trace
+     *
+     * The trace carries no timing and no values, only what is needed
+     * to follow the program again - where it went and what memory it touched.
+     */
+    struct TraceRecord {
+        enum class Branch : uint8_t {
+            none, notTaken, taken
+        };
+
+        uint64_t pc{0};
+
+        // Effective addresses of memory operands, in the order they were read
+        std::vector<uint64_t> memoryReads;
+
+        std::vector<uint64_t> memoryWrites;
+
+        Branch branch{Branch::none};
+
+        // Destination of the taken branch, pc + 1 otherwise
+        uint64_t target{0};
+
+        void clear() {
+            memoryReads.clear();
+            memoryWrites.clear();
+            branch = Branch::none;
+            target = 0;
+        }
+    };
+
+    /**
+     * Layout of the binary trace file
+     *
+     * Header is the magic, version byte and varint count of program instructions.
+     * Every record then starts with a flags byte:
+     *   - bits 0-1 branch outcome
+     *   - bit 2 set when the pc does not follow the previous one, signed varint pc delta follows
+     *   - bits 3-4 and 5-6 count of memory reads and writes, value 3 means varint count follows
+     * followed by the memory addresses as signed varint deltas against the previous address in the trace
+     * and for taken branches the signed varint delta of target against the pc.
+     */
+    namespace trace {
+        constexpr static char magic[] = {'T', '8', '6', 'T'};
+
+        constexpr static uint8_t version = 1;
+
+        constexpr static uint8_t branchMask = 0x3;
+
+        constexpr static uint8_t pcJumpFlag = 0x4;
+
+        constexpr static unsigned readsShift = 3;
+
+        constexpr static unsigned writesShift = 5;
+
+        constexpr static uint8_t countMask = 0x3;
+
+        // Count of addresses that does not fit into flags
+        constexpr static uint8_t countEscape = 0x3;
+
+        inline uint64_t zigzag(int64_t value) {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
+
+        inline int64_t unzigzag(uint64_t value) {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace_reader.h"
+
+namespace tiny::t86 {
+    namespace {
+        uint64_t readVarint(const uint8_t*& position, const uint8_t* end) {
+            uint64_t value = 0;
+            for (unsigned shift = 0; ; shift += 7) {
+                if (position == end || shift >= 64) {
+                    throw TraceReader::ParseError("truncated record");
+                }
+                uint8_t byte = *position++;
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+        }
+    }
+
+    TraceReader::TraceReader(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Can't open trace file " + path);
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Can't stat trace file " + path);
+        }
+        size_ = st.st_size;
+        if (size_ != 0) {
+            void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (mapped == MAP_FAILED) {
+                throw std::runtime_error("Can't map trace file " + path);
+            }
+            data_ = static_cast<const uint8_t*>(mapped);
+            madvise(mapped, size_, MADV_SEQUENTIAL);
+        } else {
+            close(fd);
+        }
+
+        try {
+            if (size_ < sizeof(trace::magic) + 1 || std::memcmp(data_, trace::magic, sizeof(trace::magic)) != 0) {
+                throw ParseError("missing header");
+            }
+            if (data_[sizeof(trace::magic)] != trace::version) {
+                throw ParseError("unsupported version " + std::to_string(data_[sizeof(trace::magic)]));
+            }
+            const uint8_t* position = data_ + sizeof(trace::magic) + 1;
+            programSize_ = readVarint(position, data_ + size_);
+            recordsOffset_ = position - data_;
+        } catch (...) {
+            // Destructor is not run for partially constructed reader
+            if (data_) {
+                munmap(const_cast<uint8_t*>(data_), size_);
+            }
+            throw;
+        }
+    }
+
+    TraceReader::~TraceReader() {
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+            data_ = nullptr;
+        }
+    }
+
+    TraceReader::Iterator TraceReader::begin() const {
+        return Iterator(data_ + recordsOffset_, data_ + size_);
+    }
+
+    TraceReader::Iterator TraceReader::end() const {
+        return Iterator(data_ + size_, data_ + size_);
+    }
+
+    TraceReader::Iterator::Iterator(const uint8_t* position, const uint8_t* end)
+            : position_(position), next_(position), end_(end) {
+        // So that the first record at pc 0 is sequential
+        record_.pc = static_cast<uint64_t>(-1);
+        decode();
+    }
+
+    void TraceReader::Iterator::decode() {
+        position_ = next_;
+        if (position_ == end_) {
+            return;
+        }
+        uint8_t flags = *next_++;
+        uint64_t pc = record_.pc + 1;
+        record_.clear();
+        if (flags & trace::pcJumpFlag) {
+            pc += trace::unzigzag(getVarint());
+        }
+        record_.pc = pc;
+        getAddresses(record_.memoryReads, (flags >> trace::readsShift) & trace::countMask);
+        getAddresses(record_.memoryWrites, (flags >> trace::writesShift) & trace::countMask);
+        record_.branch = static_cast<TraceRecord::Branch>(flags & trace::branchMask);
+        if (record_.branch == TraceRecord::Branch::taken) {
+            record_.target = pc + trace::unzigzag(getVarint());
+        } else {
+            record_.target = pc + 1;
+        }
+    }
+
+    uint64_t TraceReader::Iterator::getVarint() {
+        return readVarint(next_, end_);
+    }
+
+    void TraceReader::Iterator::getAddresses(std::vector<uint64_t>& addresses, uint8_t count) {
+        std::size_t cnt = count == trace::countEscape ? getVarint() : count;
+        for (std::size_t i = 0; i < cnt; ++i) {
+            previousAddress_ += trace::unzigzag(getVarint());
+            addresses.push_back(previousAddress_);
+        }
+    }
+}
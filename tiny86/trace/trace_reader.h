@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+
+#include "trace.h"
+
+namespace tiny::t86 {
+    /**
+     * Reads trace written by TraceWriter
+     *
+     * The file is memory mapped and decoded lazily by the iterator,
+     * so even long traces can be walked through without loading them whole.
+     * More iterators (and readers) can walk the same trace independently.
+     */
+    class TraceReader {
+    public:
+        class ParseError;
+
+        class Iterator;
+
+        // Throws std::runtime_error if the file can't be mapped, ParseError for unknown format
+        explicit TraceReader(const std::string& path);
+
+        TraceReader(const TraceReader&) = delete;
+
+        TraceReader& operator=(const TraceReader&) = delete;
+
+        ~TraceReader();
+
+        // Count of instructions of the traced program
+        std::size_t programSize() const {
+            return programSize_;
+        }
+
+        Iterator begin() const;
+
+        Iterator end() const;
+
+    private:
+        const uint8_t* data_{nullptr};
+
+        std::size_t size_{0};
+
+        // Start of the first record
+        std::size_t recordsOffset_{0};
+
+        std::size_t programSize_{0};
+    };
+
+    class TraceReader::ParseError : public std::runtime_error {
+    public:
+        explicit ParseError(const std::string& message) : std::runtime_error("Invalid trace: " + message) {}
+    };
+
+    class TraceReader::Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = TraceRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TraceRecord*;
+        using reference = const TraceRecord&;
+
+        Iterator() = default;
+
+        reference operator*() const {
+            return record_;
+        }
+
+        pointer operator->() const {
+            return &record_;
+        }
+
+        Iterator& operator++() {
+            decode();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return position_ == other.position_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class TraceReader;
+
+        Iterator(const uint8_t* position, const uint8_t* end);
+
+        // Decodes record at next_, position_ becomes end_ when there is none
+        void decode();
+
+        uint64_t getVarint();
+
+        void getAddresses(std::vector<uint64_t>& addresses, uint8_t count);
+
+        const uint8_t* position_{nullptr};
+
+        const uint8_t* next_{nullptr};
+
+        const uint8_t* end_{nullptr};
+
+        TraceRecord record_;
+
+        uint64_t previousAddress_{0};
+    };
+}
@@ -0,0 +1,414 @@
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "trace_replay.h"
+#include "../cpu.h"
+#include "../cpu/branch_predictors/naive_branch_predictor.h"
+
+namespace tiny::t86 {
+    TraceReplay::Config TraceReplay::Config::fromCpuConfig() {
+        const auto& cpuConfig = Cpu::Config::instance();
+        Config result{cpuConfig.aluCnt(), cpuConfig.reservationStationEntriesCnt(), cpuConfig.ramGatesCount()};
+        result.frontendStages = cpuConfig.frontendStages() + cpuConfig.renameLatency();
+        return result;
+    }
+
+    TraceReplay::Config TraceReplay::Config::parse(const std::string& text) {
+        std::istringstream is(text);
+        Config result{};
+        char slash1 = 0, slash2 = 0, slash3 = '/';
+        bool valid = static_cast<bool>(is >> result.aluCnt >> slash1 >> result.reservationStationEntriesCnt >> slash2 >> result.ramGatesCnt);
+        if (valid && !is.eof()) {
+            valid = static_cast<bool>(is >> slash3 >> result.frontendStages);
+        }
+        if (!valid || slash1 != '/' || slash2 != '/' || slash3 != '/' || !is.eof()
+            || !result.aluCnt || !result.reservationStationEntriesCnt || !result.ramGatesCnt || !result.frontendStages) {
+            throw std::invalid_argument("Invalid replay configuration '" + text
+                                        + "', expected aluCnt/reservationStationEntriesCnt/ramGatesCnt[/frontendStages]");
+        }
+        return result;
+    }
+
+    std::string TraceReplay::Config::toString() const {
+        return std::to_string(aluCnt) + "/" + std::to_string(reservationStationEntriesCnt) + "/" + std::to_string(ramGatesCnt)
+               + "/" + std::to_string(frontendStages);
+    }
+
+    TraceReplay::TraceReplay(const Program& program, const TraceReader& trace)
+            : trace_(trace), program_(program) {
+        if (program.size() != trace.programSize()) {
+            throw std::runtime_error("Trace was recorded from a program with " + std::to_string(trace.programSize())
+                                     + " instructions, given program has " + std::to_string(program.size()));
+        }
+    }
+
+    /**
+     * State of a single replay, mirrors the phases of Cpu::tick
+     */
+    class TraceReplay::Run {
+    public:
+        Run(const TraceReplay& replay, const Config& config)
+                : replay_(replay), config_(config),
+                  predictor_(config.branchPredictor ? config.branchPredictor() : std::make_unique<NaiveBranchPredictor>()),
+                  next_(replay.trace_.begin()), end_(replay.trace_.end()),
+                  frontend_(config.frontendStages),
+                  producers_(replay.program_.registersCount(), none), freeAlus_(config.aluCnt) {}
+
+        Result run() {
+            while (!halted_) {
+                ++result_.ticks;
+                ramTick();
+                executeAndRetire();
+                if (halted_) {
+                    break;
+                }
+                fetchOperandsAndStartExecution();
+                if (frontend_.back() && window_.size() < config_.reservationStationEntriesCnt && !serializing()) {
+                    dispatch(std::move(*frontend_.back()));
+                    frontend_.back().reset();
+                }
+                for (std::size_t i = frontend_.size() - 1; i > 0; --i) {
+                    if (!frontend_[i]) {
+                        std::swap(frontend_[i], frontend_[i - 1]);
+                    }
+                }
+                if (!frontend_.front()) {
+                    fetchNext();
+                }
+                if (window_.empty() && std::none_of(frontend_.begin(), frontend_.end(), [](const auto& stage) { return stage.has_value(); })) {
+                    // Trace ended without HALT (e.g. it was cut short)
+                    break;
+                }
+            }
+            result_.config = config_.toString();
+            return result_;
+        }
+
+    private:
+        constexpr static std::size_t none = static_cast<std::size_t>(-1);
+
+        enum class State {
+            preparing, ready, executing, retiring
+        };
+
+        struct InFlight {
+            std::size_t seq;
+            const StaticInstruction* info;
+            TraceRecord record;
+            bool mispredicted{false};
+            State state{State::preparing};
+            // Next step of every operand
+            std::vector<std::size_t> progress{};
+            // Memory steps are matched with the recorded reads in operand order
+            std::vector<std::size_t> firstRead{};
+            // Producers of register steps as they were when entering reservation station, flattened
+            std::vector<std::size_t> producers{};
+            std::vector<std::size_t> firstStep{};
+            std::size_t remaining{0};
+        };
+
+        struct RamRead {
+            uint64_t address;
+            std::size_t remaining;
+        };
+
+        struct RetiredWrite {
+            uint64_t address;
+            std::size_t lastTick;
+        };
+
+        void ramTick() {
+            for (auto it = ramReads_.begin(); it != ramReads_.end();) {
+                if (it->remaining == 0) {
+                    it = ramReads_.erase(it);
+                } else {
+                    --(it++)->remaining;
+                }
+            }
+            while (!retiredWrites_.empty() && retiredWrites_.front().lastTick < result_.ticks) {
+                retiredWrites_.pop_front();
+            }
+        }
+
+        void executeAndRetire() {
+            for (auto& entry : window_) {
+                if (entry.state == State::executing) {
+                    if (entry.remaining != 0) {
+                        --entry.remaining;
+                    }
+                    if (entry.remaining == 0) {
+                        entry.state = State::retiring;
+                        if (entry.info->needsAlu) {
+                            ++freeAlus_;
+                        }
+                    }
+                }
+            }
+            while (!window_.empty() && window_.front().state == State::retiring) {
+                retire(window_.front());
+                window_.pop_front();
+                if (halted_) {
+                    return;
+                }
+            }
+        }
+
+        void retire(const InFlight& entry) {
+            ++result_.instructions;
+            for (uint64_t address : entry.record.memoryWrites) {
+                retiredWrites_.push_back({address, result_.ticks + config_.ramLatency});
+            }
+            if (entry.record.branch == TraceRecord::Branch::taken) {
+                predictor_->registerBranchTaken(entry.record.pc, entry.record.target);
+            } else if (entry.record.branch == TraceRecord::Branch::notTaken) {
+                predictor_->registerBranchNotTaken(entry.record.pc);
+            }
+            if (entry.mispredicted) {
+                ++result_.mispredicts;
+            }
+            if (entry.mispredicted || entry.info->flushing) {
+                // Cpu would clear everything fetched after this one
+                frontendBlocked_ = false;
+            }
+            if (entry.info->halt) {
+                halted_ = true;
+            }
+        }
+
+        void fetchOperandsAndStartExecution() {
+            for (auto& entry : window_) {
+                switch (entry.state) {
+                    case State::preparing: {
+                        bool fetched = true;
+                        for (std::size_t i = 0; i < entry.info->operands.size(); ++i) {
+                            const auto& steps = entry.info->operands[i];
+                            while (entry.progress[i] < steps.size()) {
+                                const StaticInstruction::Step& step = steps[entry.progress[i]];
+                                bool available = step.memory
+                                        ? readMemory(entry, readAddress(entry, i))
+                                        : registerReady(entry.producers[entry.firstStep[i] + entry.progress[i]]);
+                                if (!available) {
+                                    fetched = false;
+                                    break;
+                                }
+                                ++entry.progress[i];
+                            }
+                        }
+                        if (fetched) {
+                            entry.state = State::ready;
+                        }
+                        break;
+                    }
+                    case State::ready:
+                        // Same as ReservationStation::serializingReady, a single core owns every line
+                        if (entry.info->serializing && (&entry != &window_.front() || !retiredWrites_.empty())) {
+                            break;
+                        }
+                        if (entry.info->needsAlu) {
+                            if (!freeAlus_) {
+                                break;
+                            }
+                            --freeAlus_;
+                        }
+                        entry.state = State::executing;
+                        entry.remaining = entry.info->executionLength;
+                        break;
+                    case State::executing:
+                    case State::retiring:
+                        break;
+                }
+            }
+        }
+
+        // Serializing instruction in the window holds the dispatch of the later ones
+        bool serializing() const {
+            return std::any_of(window_.begin(), window_.end(), [](const InFlight& entry) { return entry.info->serializing; });
+        }
+
+        uint64_t readAddress(const InFlight& entry, std::size_t operand) const {
+            const auto& steps = entry.info->operands[operand];
+            std::size_t index = entry.firstRead[operand];
+            for (std::size_t i = 0; i < entry.progress[operand]; ++i) {
+                index += steps[i].memory;
+            }
+            if (index >= entry.record.memoryReads.size()) {
+                throw std::runtime_error("Trace does not match the program, missing memory read at pc " + std::to_string(entry.record.pc));
+            }
+            return entry.record.memoryReads[index];
+        }
+
+        const InFlight* inFlight(std::size_t seq) const {
+            if (window_.empty() || seq < window_.front().seq) {
+                return nullptr;
+            }
+            return &window_[seq - window_.front().seq];
+        }
+
+        bool registerReady(std::size_t producer) const {
+            if (producer == none) {
+                return true;
+            }
+            const InFlight* entry = inFlight(producer);
+            return !entry || entry->state == State::retiring;
+        }
+
+        // Same decisions as Cpu::readMemory
+        bool readMemory(const InFlight& reader, uint64_t address) {
+            for (auto it = window_.rbegin(); it != window_.rend(); ++it) {
+                if (it->seq >= reader.seq || it->record.memoryWrites.empty()) {
+                    continue;
+                }
+                bool executed = it->state == State::retiring;
+                if (!executed && !it->info->immediateWrites) {
+                    // Write with unknown address before us
+                    return false;
+                }
+            }
+            for (auto it = window_.rbegin(); it != window_.rend(); ++it) {
+                if (it->seq >= reader.seq) {
+                    continue;
+                }
+                for (uint64_t written : it->record.memoryWrites) {
+                    if (written == address) {
+                        // Forwarded once the value is known
+                        return it->state == State::retiring;
+                    }
+                }
+            }
+            for (const auto& write : retiredWrites_) {
+                if (write.address == address) {
+                    return true;
+                }
+            }
+            for (const auto& read : ramReads_) {
+                if (read.address == address) {
+                    return read.remaining == 0;
+                }
+            }
+            if (ramReads_.size() < config_.ramGatesCnt) {
+                ramReads_.push_back({address, config_.ramLatency});
+            }
+            return false;
+        }
+
+        void dispatch(InFlight&& entry) {
+            entry.progress.assign(entry.info->operands.size(), 0);
+            entry.firstRead.resize(entry.info->operands.size());
+            entry.firstStep.resize(entry.info->operands.size());
+            std::size_t reads = 0;
+            for (std::size_t i = 0; i < entry.info->operands.size(); ++i) {
+                entry.firstRead[i] = reads;
+                entry.firstStep[i] = entry.producers.size();
+                for (const StaticInstruction::Step& step : entry.info->operands[i]) {
+                    reads += step.memory;
+                    entry.producers.push_back(step.memory ? none : producers_[step.reg]);
+                }
+            }
+            bool hasSteps = !entry.producers.empty();
+            for (std::size_t reg : entry.info->produces) {
+                producers_[reg] = entry.seq;
+            }
+            if (!hasSteps) {
+                entry.state = State::ready;
+            }
+            window_.push_back(std::move(entry));
+        }
+
+        void fetchNext() {
+            if (frontendBlocked_ || next_ == end_) {
+                return;
+            }
+            const TraceRecord& record = *next_;
+            if (record.pc >= replay_.program_.size()) {
+                throw std::runtime_error("Trace does not match the program, pc " + std::to_string(record.pc) + " out of range");
+            }
+            InFlight entry{seq_++, &replay_.program_.at(record.pc), record};
+            if (entry.info->jump) {
+                const auto& jump = static_cast<const JumpInstruction&>(*entry.info->instruction);
+                entry.mispredicted = predictor_->nextGuess(record.pc, jump) != record.target;
+            }
+            // Fetch would continue on a path that is not in the trace
+            frontendBlocked_ = entry.mispredicted || entry.info->flushing || entry.info->halt;
+            frontend_.front() = std::move(entry);
+            ++next_;
+        }
+
+        const TraceReplay& replay_;
+
+        const Config& config_;
+
+        std::unique_ptr<BranchPredictor> predictor_;
+
+        TraceReader::Iterator next_;
+
+        TraceReader::Iterator end_;
+
+        // Fetch first, the last stage dispatches
+        std::vector<std::optional<InFlight>> frontend_;
+
+        // Reservation station, ordered by seq without gaps
+        std::deque<InFlight> window_;
+
+        // Seq of the last dispatched producer of every register
+        std::vector<std::size_t> producers_;
+
+        std::vector<RamRead> ramReads_;
+
+        std::deque<RetiredWrite> retiredWrites_;
+
+        std::size_t freeAlus_;
+
+        std::size_t seq_{0};
+
+        bool frontendBlocked_{false};
+
+        bool halted_{false};
+
+        Result result_;
+    };
+
+    TraceReplay::Result TraceReplay::run(const Config& config) const {
+        return Run(*this, config).run();
+    }
+
+    std::vector<TraceReplay::Result> TraceReplay::run(const std::vector<Config>& configs) const {
+        std::vector<Result> results(configs.size());
+        std::vector<std::exception_ptr> errors(configs.size());
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < configs.size(); ++i) {
+            threads.emplace_back([&, i]() {
+                try {
+                    results[i] = run(configs[i]);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        return results;
+    }
+
+    void TraceReplay::printResults(const std::vector<Result>& results, std::ostream& os) {
+        os << "------------------------------------------\n";
+        os << "Trace replay (aluCnt/reservationStationEntriesCnt/ramGatesCnt/frontendStages):\n";
+        os << std::setw(14) << "Config" << std::setw(12) << "Ticks" << std::setw(14) << "Instructions"
+           << std::setw(12) << "Mispredicts" << std::setw(8) << "IPC" << "\n";
+        for (const auto& result : results) {
+            os << std::setw(14) << result.config << std::setw(12) << result.ticks << std::setw(14) << result.instructions
+               << std::setw(12) << result.mispredicts << std::setw(8) << std::fixed << std::setprecision(3) << result.ipc()
+               << std::defaultfloat << "\n";
+        }
+        os << std::flush;
+    }
+}
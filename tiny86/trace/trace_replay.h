@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <iostream>
+
+#include "../program.h"
+#include "../ram.h"
+#include "../cpu/branchpredictor.h"
+#include "trace_reader.h"
+#include "static_program.h"
+
+namespace tiny::t86 {
+    /**
+     * Timing only model of the cpu driven by a recorded trace
+     *
+     * Follows the same pipeline as Cpu::tick - frontend of configurable depth, reservation station
+     * with in order retirement, limited ALUs and RAM gates, store to load forwarding
+     * and branch prediction - but no values are ever computed, addresses and branch outcomes
+     * come from the trace. Instructions on mispredicted path are not in the trace,
+     * so the frontend just waits for the jump to retire instead of fetching them.
+     *
+     * The replay does not modify itself, so one instance can run many configurations at once.
+     */
+    class TraceReplay {
+    public:
+        struct Config {
+            std::size_t aluCnt;
+
+            std::size_t reservationStationEntriesCnt;
+
+            std::size_t ramGatesCnt;
+
+            std::size_t ramLatency{RAM::flatLatency};
+
+            // Fetch, decode and rename stages together
+            std::size_t frontendStages{2};
+
+            std::function<std::unique_ptr<BranchPredictor>()> branchPredictor{};
+
+            // Configuration the Cpu would be created with
+            static Config fromCpuConfig();
+
+            // Reads "aluCnt/reservationStationEntriesCnt/ramGatesCnt[/frontendStages]", throws std::invalid_argument
+            static Config parse(const std::string& text);
+
+            std::string toString() const;
+        };
+
+        struct Result {
+            std::string config;
+
+            std::size_t ticks{0};
+
+            std::size_t instructions{0};
+
+            std::size_t mispredicts{0};
+
+            double ipc() const {
+                return ticks ? static_cast<double>(instructions) / ticks : 0;
+            }
+        };
+
+        // Throws std::runtime_error if the trace was not recorded from given program
+        TraceReplay(const Program& program, const TraceReader& trace);
+
+        Result run(const Config& config) const;
+
+        // Every configuration is replayed in its own thread
+        std::vector<Result> run(const std::vector<Config>& configs) const;
+
+        static void printResults(const std::vector<Result>& results, std::ostream& os);
+
+    private:
+        class Run;
+
+        const TraceReader& trace_;
+
+        StaticProgram program_;
+    };
+}
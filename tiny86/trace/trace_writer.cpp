@@ -0,0 +1,69 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "trace_writer.h"
+
+namespace tiny::t86 {
+    TraceWriter::TraceWriter(const std::string& path, std::size_t programSize)
+            : os_(path, std::ios::binary) {
+        if (!os_) {
+            throw std::runtime_error("Can't open trace file " + path);
+        }
+        buffer_.reserve(bufferSize);
+        for (char c : trace::magic) {
+            putByte(c);
+        }
+        putByte(trace::version);
+        putVarint(programSize);
+    }
+
+    TraceWriter::~TraceWriter() {
+        flush();
+    }
+
+    void TraceWriter::write(const TraceRecord& record) {
+        auto count = [](const std::vector<uint64_t>& addresses) {
+            return static_cast<uint8_t>(std::min<std::size_t>(addresses.size(), trace::countEscape));
+        };
+        bool pcJump = record.pc != previousPc_ + 1;
+        uint8_t flags = static_cast<uint8_t>(record.branch)
+                | (pcJump ? trace::pcJumpFlag : 0)
+                | (count(record.memoryReads) << trace::readsShift)
+                | (count(record.memoryWrites) << trace::writesShift);
+        putByte(flags);
+        if (pcJump) {
+            putVarint(trace::zigzag(record.pc - (previousPc_ + 1)));
+        }
+        putAddresses(record.memoryReads);
+        putAddresses(record.memoryWrites);
+        if (record.branch == TraceRecord::Branch::taken) {
+            putVarint(trace::zigzag(record.target - record.pc));
+        }
+        previousPc_ = record.pc;
+        ++recordsCnt_;
+    }
+
+    void TraceWriter::flush() {
+        os_.write(buffer_.data(), buffer_.size());
+        os_.flush();
+        buffer_.clear();
+    }
+
+    void TraceWriter::putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            putByte(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        putByte(static_cast<uint8_t>(value));
+    }
+
+    void TraceWriter::putAddresses(const std::vector<uint64_t>& addresses) {
+        if (addresses.size() >= trace::countEscape) {
+            putVarint(addresses.size());
+        }
+        for (uint64_t address : addresses) {
+            putVarint(trace::zigzag(address - previousAddress_));
+            previousAddress_ = address;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace tiny::t86 {
+    /**
+     * Streams trace records into a file
+     *
+     * Records are encoded into an in-memory buffer which is written out once full,
+     * so the cost per retired instruction stays at a few bytes of encoding.
+     */
+    class TraceWriter {
+    public:
+        constexpr static std::size_t bufferSize = 1 << 16;
+
+        // Throws std::runtime_error if the file can't be opened
+        TraceWriter(const std::string& path, std::size_t programSize);
+
+        TraceWriter(const TraceWriter&) = delete;
+
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        ~TraceWriter();
+
+        void write(const TraceRecord& record);
+
+        void flush();
+
+        std::size_t recordsCount() const {
+            return recordsCnt_;
+        }
+
+    private:
+        void putByte(uint8_t byte) {
+            if (buffer_.size() == bufferSize) {
+                flush();
+            }
+            buffer_.push_back(static_cast<char>(byte));
+        }
+
+        void putVarint(uint64_t value);
+
+        void putAddresses(const std::vector<uint64_t>& addresses);
+
+        std::ofstream os_;
+
+        std::vector<char> buffer_;
+
+        uint64_t previousPc_{static_cast<uint64_t>(-1)};
+
+        uint64_t previousAddress_{0};
+
+        std::size_t recordsCnt_{0};
+    };
+}
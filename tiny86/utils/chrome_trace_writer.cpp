@@ -0,0 +1,233 @@
+#include <sstream>
+#include <map>
+#include <algorithm>
+
+#include "chrome_trace_writer.h"
+#include "../instruction.h"
+
+namespace tiny::t86 {
+    ChromeTraceWriter::ChromeTraceWriter(std::ostream& os, Lookup lookup)
+            : os_(os), lookup_(std::move(lookup)) {
+        os_ << "[";
+        writeProcessName(frontendPid, "Frontend");
+        writeProcessName(reservationStationPid, "Reservation station");
+        writeProcessName(aluPid, "ALU");
+        writeTrackName(frontendPid, fetch_.tid, "Fetch");
+    }
+
+    void ChromeTraceWriter::tick(std::size_t tick, const StatsLogger::TickStats& stats) {
+        update(fetch_, tick, stats.instructionFetchPc, "Fetch");
+        while (decode_.size() < stats.instructionDecodePcs.size()) {
+            decode_.push_back(Track{frontendPid, decode_.size() + 1});
+            writeTrackName(frontendPid, decode_.back().tid, decode_.size() == 1 ? "Decode" : "Decode " + std::to_string(decode_.size()));
+        }
+        for (std::size_t stage = 0; stage < decode_.size(); ++stage) {
+            update(decode_[stage], tick, stage < stats.instructionDecodePcs.size() ? stats.instructionDecodePcs[stage] : std::nullopt, "Decode");
+        }
+
+        std::map<std::size_t, const char*> phases;
+        for (const auto& [id, phase] : stats.reservationStationPhases()) {
+            phases[id] = StatsLogger::phaseName(phase);
+        }
+
+        // Mispredicted jump is being retired, it still holds its slot
+        for (std::size_t id : stats.mispredictedRSEntries) {
+            auto it = slotOf_.find(id);
+            writeInstant("Mispredict", tick, it == slotOf_.end() ? nullptr : &slots_[it->second],
+                         "\"id\":" + std::to_string(id));
+        }
+
+        // Entries which left the reservation station free their slots,
+        // retirement happens at the start of the tick so the slot can be reused in the same one
+        for (auto it = slotOf_.begin(); it != slotOf_.end();) {
+            if (!phases.count(it->first)) {
+                update(slots_[it->second], tick, std::nullopt, nullptr);
+                if (std::find(stats.retiredRSEntries.begin(), stats.retiredRSEntries.end(), it->first) != stats.retiredRSEntries.end()) {
+                    writeInstant("Retire", tick, &slots_[it->second], "\"id\":" + std::to_string(it->first));
+                }
+                it = slotOf_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const auto& [id, phase] : phases) {
+            std::size_t slot = assignTrack(slots_, slotOf_, id, reservationStationPid, "Slot ");
+            update(slots_[slot], tick, id, phase);
+        }
+
+        std::map<std::size_t, bool> usingAlu;
+        for (std::size_t id : stats.executingRSEntries) {
+            if (lookup_(id).instruction->needsAlu()) {
+                usingAlu[id] = true;
+            }
+        }
+        for (auto it = aluOf_.begin(); it != aluOf_.end();) {
+            if (!usingAlu.count(it->first)) {
+                update(alus_[it->second], tick, std::nullopt, nullptr);
+                it = aluOf_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const auto& [id, used] : usingAlu) {
+            std::size_t alu = assignTrack(alus_, aluOf_, id, aluPid, "ALU ");
+            update(alus_[alu], tick, id, "Executing");
+        }
+
+        if (!stats.clearedSpeculationEntries.empty()) {
+            writeInstant("Flush", tick, nullptr,
+                         "\"squashed\":" + std::to_string(stats.clearedSpeculationEntries.size()));
+        }
+
+        for (std::size_t id : stats.retiredRSEntries) {
+            writePending(id);
+        }
+        for (std::size_t id : stats.clearedSpeculationEntries) {
+            writePending(id);
+        }
+    }
+
+    void ChromeTraceWriter::finish(std::size_t endTick) {
+        if (finished_) {
+            return;
+        }
+        update(fetch_, endTick, std::nullopt, nullptr);
+        for (auto& track : decode_) {
+            update(track, endTick, std::nullopt, nullptr);
+        }
+        for (auto& track : slots_) {
+            update(track, endTick, std::nullopt, nullptr);
+        }
+        for (auto& track : alus_) {
+            update(track, endTick, std::nullopt, nullptr);
+        }
+        // Instructions still in flight at the end of the run
+        std::vector<std::size_t> ids;
+        for (const auto& [id, slices] : pending_) {
+            ids.push_back(id);
+        }
+        std::sort(ids.begin(), ids.end());
+        for (std::size_t id : ids) {
+            writePending(id);
+        }
+        os_ << "\n]\n" << std::flush;
+        finished_ = true;
+    }
+
+    void ChromeTraceWriter::update(Track& track, std::size_t tick, std::optional<std::size_t> id, const char* name) {
+        if (track.slice && id && track.slice->id == *id && track.slice->name == name) {
+            return;
+        }
+        if (track.slice) {
+            writeSlice(track, tick);
+            track.slice.reset();
+        }
+        if (id) {
+            track.slice = Slice{*id, name, tick};
+        }
+    }
+
+    void ChromeTraceWriter::writeSlice(const Track& track, std::size_t end) {
+        const Slice& slice = *track.slice;
+        StatsLogger::InstructionInfo info = lookup_(slice.id);
+        // Squashed instructions stay squashed, any other one might still be
+        if (info.squashed) {
+            writeSlice(track.pid, track.tid, slice, end, info);
+        } else {
+            pending_[slice.id].push_back(PendingSlice{track.pid, track.tid, slice, end});
+        }
+    }
+
+    void ChromeTraceWriter::writeSlice(int pid, std::size_t tid, const Slice& slice, std::size_t end,
+                                       const StatsLogger::InstructionInfo& info) {
+        beginEvent();
+        os_ << "{\"name\":\"" << slice.name << "\",\"cat\":\"" << (info.squashed ? "squashed" : "retired") << "\""
+            << ",\"ph\":\"X\",\"ts\":" << slice.start << ",\"dur\":" << end - slice.start
+            << ",\"pid\":" << pid << ",\"tid\":" << tid;
+        if (info.squashed) {
+            os_ << ",\"cname\":\"grey\"";
+        }
+        os_ << ",\"args\":{\"id\":" << slice.id << ",\"pc\":" << info.pc
+            << ",\"instruction\":\"" << escape(info.instruction->toString()) << "\"}}";
+    }
+
+    void ChromeTraceWriter::writePending(std::size_t id) {
+        auto it = pending_.find(id);
+        if (it == pending_.end()) {
+            return;
+        }
+        StatsLogger::InstructionInfo info = lookup_(id);
+        for (const auto& pending : it->second) {
+            writeSlice(pending.pid, pending.tid, pending.slice, pending.end, info);
+        }
+        pending_.erase(it);
+    }
+
+    void ChromeTraceWriter::writeInstant(const char* name, std::size_t tick, const Track* track, const std::string& args) {
+        beginEvent();
+        os_ << "{\"name\":\"" << name << "\",\"ph\":\"i\",\"ts\":" << tick;
+        if (track) {
+            os_ << ",\"s\":\"t\",\"pid\":" << track->pid << ",\"tid\":" << track->tid;
+        } else {
+            os_ << ",\"s\":\"g\",\"pid\":" << frontendPid << ",\"tid\":0";
+        }
+        os_ << ",\"args\":{" << args << "}}";
+    }
+
+    void ChromeTraceWriter::writeTrackName(int pid, std::size_t tid, const std::string& name) {
+        beginEvent();
+        os_ << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+            << ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+        beginEvent();
+        os_ << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+            << ",\"args\":{\"sort_index\":" << tid << "}}";
+    }
+
+    void ChromeTraceWriter::writeProcessName(int pid, const std::string& name) {
+        beginEvent();
+        os_ << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+        beginEvent();
+        os_ << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"sort_index\":" << pid << "}}";
+    }
+
+    void ChromeTraceWriter::beginEvent() {
+        os_ << (firstEvent_ ? "\n" : ",\n");
+        firstEvent_ = false;
+    }
+
+    std::size_t ChromeTraceWriter::assignTrack(std::vector<Track>& tracks, std::unordered_map<std::size_t, std::size_t>& assigned,
+                                               std::size_t id, int pid, const char* name) {
+        if (auto it = assigned.find(id); it != assigned.end()) {
+            return it->second;
+        }
+        for (std::size_t i = 0; i < tracks.size(); ++i) {
+            if (!tracks[i].slice) {
+                assigned.emplace(id, i);
+                return i;
+            }
+        }
+        tracks.push_back(Track{pid, tracks.size()});
+        writeTrackName(pid, tracks.back().tid, name + std::to_string(tracks.back().tid));
+        assigned.emplace(id, tracks.size() - 1);
+        return tracks.size() - 1;
+    }
+
+    std::string ChromeTraceWriter::escape(const std::string& text) {
+        std::ostringstream result;
+        for (char c : text) {
+            switch (c) {
+                case '"': result << "\\\""; break;
+                case '\\': result << "\\\\"; break;
+                case '\n': result << "\\n"; break;
+                case '\t': result << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        result << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xf] << "0123456789abcdef"[c & 0xf];
+                    } else {
+                        result << c;
+                    }
+            }
+        }
+        return result.str();
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stats_logger.h"
+
+namespace tiny::t86 {
+    /**
+     * Writes pipeline occupancy as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+     *
+     * Ticks are fed one by one and every slice is written out as soon as it ends and its instruction
+     * retired or was squashed, so only the instructions currently in the pipeline are kept in memory.
+     * One tick is shown as one microsecond. There is a track for fetch, every decode stage, every
+     * reservation station slot and every ALU; slices in reservation station slots are the phases
+     * of the instruction (preparing, stalls, executing, ...), squashed instructions are grey.
+     * Retirements, flushes and mispredicts are instant events.
+     */
+    class ChromeTraceWriter {
+    public:
+        using Lookup = std::function<StatsLogger::InstructionInfo(std::size_t id)>;
+
+        ChromeTraceWriter(std::ostream& os, Lookup lookup);
+
+        ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+
+        ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+
+        void tick(std::size_t tick, const StatsLogger::TickStats& stats);
+
+        // Closes all open slices, nothing can be written afterwards
+        void finish(std::size_t endTick);
+
+    private:
+        struct Slice {
+            std::size_t id;
+            const char* name;
+            std::size_t start;
+        };
+
+        // Either frontend stage, reservation station slot or ALU
+        struct Track {
+            int pid;
+            std::size_t tid;
+            std::optional<Slice> slice{};
+        };
+
+        // Slice of an instruction which has not left the pipeline yet, so it is not known whether it is squashed
+        struct PendingSlice {
+            int pid;
+            std::size_t tid;
+            Slice slice;
+            std::size_t end;
+        };
+
+        constexpr static int frontendPid = 1;
+
+        constexpr static int reservationStationPid = 2;
+
+        constexpr static int aluPid = 3;
+
+        // Ends the slice in progress if it differs and starts the new one
+        void update(Track& track, std::size_t tick, std::optional<std::size_t> id, const char* name);
+
+        // Slice of an instruction still in the pipeline waits in pending_
+        void writeSlice(const Track& track, std::size_t end);
+
+        void writeSlice(int pid, std::size_t tid, const Slice& slice, std::size_t end,
+                        const StatsLogger::InstructionInfo& info);
+
+        // Instruction retired or was squashed, its pending slices are written
+        void writePending(std::size_t id);
+
+        // Without track the event is global
+        void writeInstant(const char* name, std::size_t tick, const Track* track, const std::string& args);
+
+        void writeTrackName(int pid, std::size_t tid, const std::string& name);
+
+        void writeProcessName(int pid, const std::string& name);
+
+        void beginEvent();
+
+        // Track of given id, new one is created if there is no free track
+        std::size_t assignTrack(std::vector<Track>& tracks, std::unordered_map<std::size_t, std::size_t>& assigned,
+                                std::size_t id, int pid, const char* name);
+
+        static std::string escape(const std::string& text);
+
+        std::ostream& os_;
+
+        Lookup lookup_;
+
+        bool firstEvent_{true};
+
+        bool finished_{false};
+
+        Track fetch_{frontendPid, 0};
+
+        // One per decode stage, created when the stage is used for the first time
+        std::vector<Track> decode_;
+
+        std::vector<Track> slots_;
+
+        // Instruction id -> index to slots_
+        std::unordered_map<std::size_t, std::size_t> slotOf_;
+
+        std::vector<Track> alus_;
+
+        std::unordered_map<std::size_t, std::size_t> aluOf_;
+
+        // By instruction id
+        std::unordered_map<std::size_t, std::vector<PendingSlice>> pending_;
+    };
+}
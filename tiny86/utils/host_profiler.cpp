@@ -0,0 +1,113 @@
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+
+#include "host_profiler.h"
+
+#ifdef T86_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    tiny::t86::HostProfiler::countAllocation();
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+namespace tiny::t86 {
+    HostProfiler& HostProfiler::instance() {
+        static HostProfiler instance;
+        return instance;
+    }
+
+    void HostProfiler::reset() {
+        phases_ = {};
+        ratCopies_ = 0;
+    }
+
+    const char* HostProfiler::phaseName(Phase phase) {
+        switch (phase) {
+            case Phase::tick:
+                return "Cpu::tick (total)";
+            case Phase::ramTick:
+                return "RAM::tick";
+            case Phase::removeFinishedWrites:
+                return "MemoryWritesManager::removeFinished";
+            case Phase::executeAndRetire:
+                return "ReservationStation::executeAndRetire";
+            case Phase::fetchAndStartExecution:
+                return "ReservationStation::fetchAndStartExecution";
+            case Phase::dispatch:
+                return "Decode -> ReservationStation::add";
+            case Phase::fetch:
+                return "Fetch";
+            case Phase::count:
+                break;
+        }
+        return "";
+    }
+
+    void HostProfiler::print(std::ostream& os, std::size_t retiredInstructions) const {
+        const auto& total = phases_[static_cast<std::size_t>(Phase::tick)];
+        os << "------------------------------------------\n";
+        os << "Host profile:\n";
+        os << std::left << std::setw(46) << "Phase" << std::right << std::setw(10) << "Calls"
+           << std::setw(14) << "Time [ms]" << std::setw(9) << "%" << std::setw(14) << "Allocations" << "\n";
+        uint64_t phasesTime = 0;
+        for (std::size_t i = 0; i < phases_.size(); ++i) {
+            const auto& stats = phases_[i];
+            if (i != static_cast<std::size_t>(Phase::tick)) {
+                phasesTime += stats.nanoseconds;
+            }
+            os << std::left << std::setw(46) << phaseName(static_cast<Phase>(i)) << std::right
+               << std::setw(10) << stats.calls
+               << std::setw(14) << std::fixed << std::setprecision(3) << stats.nanoseconds / 1e6
+               << std::setw(9) << std::setprecision(2) << (total.nanoseconds ? 100.0 * stats.nanoseconds / total.nanoseconds : 0)
+               << std::setw(14);
+            if (countsAllocations()) {
+                os << stats.allocations;
+            } else {
+                os << "-";
+            }
+            os << std::defaultfloat << "\n";
+        }
+        uint64_t other = total.nanoseconds > phasesTime ? total.nanoseconds - phasesTime : 0;
+        os << std::left << std::setw(46) << "Other (stats logging, timer overhead)" << std::right << std::setw(10) << ""
+           << std::setw(14) << std::fixed << std::setprecision(3) << other / 1e6
+           << std::setw(9) << std::setprecision(2) << (total.nanoseconds ? 100.0 * other / total.nanoseconds : 0)
+           << std::defaultfloat << "\n";
+        os << "RAT copies: " << ratCopies_ << "\n";
+        if (!countsAllocations()) {
+            os << "Allocations are counted only when built with T86_COUNT_ALLOCATIONS\n";
+        }
+        if (total.nanoseconds) {
+            os << "Simulated ticks per second: " << std::fixed << std::setprecision(0)
+               << total.calls / (total.nanoseconds / 1e9) << "\n" << std::defaultfloat;
+        }
+        if (retiredInstructions) {
+            os << "Host ns per simulated instruction: " << std::fixed << std::setprecision(1)
+               << static_cast<double>(total.nanoseconds) / retiredInstructions << "\n" << std::defaultfloat;
+        }
+        os << std::flush;
+    }
+}
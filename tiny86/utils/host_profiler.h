@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace tiny::t86 {
+    /**
+     * Measures where the simulator itself spends host time
+     *
+     * Phases of Cpu::tick are timed with steady_clock by Scope objects, which cost
+     * a single branch while the profiler is disabled. Besides time it counts calls,
+     * copies of RegisterAllocationTable and heap allocations - those only when built
+     * with T86_COUNT_ALLOCATIONS, which replaces global operator new.
+     */
+    class HostProfiler {
+    public:
+        enum class Phase {
+            tick,
+            ramTick,
+            removeFinishedWrites,
+            executeAndRetire,
+            fetchAndStartExecution,
+            dispatch,
+            fetch,
+            count
+        };
+
+        static HostProfiler& instance();
+
+        static bool enabled() {
+            return enabled_;
+        }
+
+        void enable(bool enabled) {
+            enabled_ = enabled;
+        }
+
+        void reset();
+
+        class Scope {
+        public:
+            explicit Scope(Phase phase) : phase_(phase) {
+                if (enabled_) {
+                    allocations_ = allocationCnt_.load(std::memory_order_relaxed);
+                    start_ = std::chrono::steady_clock::now();
+                }
+            }
+
+            Scope(const Scope&) = delete;
+
+            Scope& operator=(const Scope&) = delete;
+
+            ~Scope() {
+                if (enabled_) {
+                    auto end = std::chrono::steady_clock::now();
+                    auto& stats = instance().phases_[static_cast<std::size_t>(phase_)];
+                    ++stats.calls;
+                    stats.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+                    stats.allocations += allocationCnt_.load(std::memory_order_relaxed) - allocations_;
+                }
+            }
+
+        private:
+            Phase phase_;
+
+            std::chrono::steady_clock::time_point start_;
+
+            std::size_t allocations_{0};
+        };
+
+        void countRatCopy() {
+            if (enabled_) {
+                ++ratCopies_;
+            }
+        }
+
+        // Called from replaced operator new
+        static void countAllocation() {
+            allocationCnt_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static constexpr bool countsAllocations() {
+#ifdef T86_COUNT_ALLOCATIONS
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        void print(std::ostream& os, std::size_t retiredInstructions) const;
+
+    private:
+        struct PhaseStats {
+            std::size_t calls{0};
+            uint64_t nanoseconds{0};
+            std::size_t allocations{0};
+        };
+
+        static const char* phaseName(Phase phase);
+
+        HostProfiler() = default;
+
+        inline static bool enabled_{false};
+
+        inline static std::atomic<std::size_t> allocationCnt_{0};
+
+        std::array<PhaseStats, static_cast<std::size_t>(Phase::count)> phases_{};
+
+        std::size_t ratCopies_{0};
+    };
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+#include "pipe_view_writer.h"
+#include "../instruction.h"
+
+namespace tiny::t86 {
+    namespace {
+        const char* kanataStage(StatsLogger::Phase phase) {
+            switch (phase) {
+                case StatsLogger::Phase::preparing:
+                    return "Pr";
+                case StatsLogger::Phase::registerStall:
+                    return "Sr";
+                case StatsLogger::Phase::memoryStall:
+                    return "Sm";
+                case StatsLogger::Phase::waitingForSerialization:
+                    return "Ws";
+                case StatsLogger::Phase::waitingForAlu:
+                    return "Wa";
+                case StatsLogger::Phase::executing:
+                    return "X";
+                case StatsLogger::Phase::waitingForRetirement:
+                    return "Wr";
+            }
+            return "";
+        }
+    }
+
+    PipeViewWriter::PipeViewWriter(std::ostream& os, Lookup lookup, Format format, std::size_t from, std::size_t to)
+            : os_(os), lookup_(std::move(lookup)), format_(format), from_(from), to_(to) {
+        if (format_ == Format::kanata) {
+            os_ << "Kanata\t0004\n";
+        }
+    }
+
+    void PipeViewWriter::tick(std::size_t tick, const StatsLogger::TickStats& stats) {
+        for (std::size_t id : retiring_) {
+            remove(id, tick, false);
+        }
+        retiring_.clear();
+
+        if (stats.instructionFetchPc) {
+            auto [it, inserted] = inFlight_.try_emplace(*stats.instructionFetchPc);
+            if (inserted) {
+                it->second.fetch = tick;
+            }
+            setStage(it->first, it->second, tick, "F");
+        }
+        for (const auto& id : stats.instructionDecodePcs) {
+            if (!id) {
+                continue;
+            }
+            auto& instruction = inFlight_[*id];
+            if (!instruction.decode) {
+                instruction.decode = tick;
+            }
+            setStage(*id, instruction, tick, "Dc");
+        }
+        for (const auto& [id, phase] : stats.reservationStationPhases()) {
+            auto& instruction = inFlight_[id];
+            if (!instruction.dispatch) {
+                instruction.dispatch = tick;
+            }
+            if (phase == StatsLogger::Phase::executing && !instruction.issue) {
+                instruction.issue = tick;
+            }
+            if (phase == StatsLogger::Phase::waitingForRetirement && !instruction.complete) {
+                instruction.complete = tick;
+            }
+            setStage(id, instruction, tick, kanataStage(phase));
+        }
+        for (std::size_t id : stats.retiredRSEntries) {
+            auto& instruction = inFlight_[id];
+            if (!instruction.complete) {
+                instruction.complete = tick;
+            }
+            setStage(id, instruction, tick, "Rt");
+            retiring_.push_back(id);
+        }
+        for (std::size_t id : stats.clearedSpeculationEntries) {
+            remove(id, tick, true);
+        }
+    }
+
+    void PipeViewWriter::finish(std::size_t endTick) {
+        for (std::size_t id : retiring_) {
+            remove(id, endTick, false);
+        }
+        retiring_.clear();
+        os_ << std::flush;
+    }
+
+    void PipeViewWriter::setStage(std::size_t id, InFlight& instruction, std::size_t tick, const char* stage) {
+        // Instructions already in flight when the range starts are written in its first tick
+        if (format_ != Format::kanata || !inRange(tick) || (instruction.fileId && instruction.stage == stage)) {
+            instruction.stage = stage;
+            return;
+        }
+        kanataCycle(tick);
+        if (!instruction.fileId) {
+            instruction.fileId = nextFileId_++;
+            StatsLogger::InstructionInfo info = lookup_(id);
+            os_ << "I\t" << *instruction.fileId << "\t" << id << "\t" << info.thread << "\n";
+            os_ << "L\t" << *instruction.fileId << "\t0\t" << info.pc << ": " << info.instruction->toString() << "\n";
+        } else if (instruction.stage) {
+            os_ << "E\t" << *instruction.fileId << "\t0\t" << instruction.stage << "\n";
+        }
+        os_ << "S\t" << *instruction.fileId << "\t0\t" << stage << "\n";
+        instruction.stage = stage;
+    }
+
+    void PipeViewWriter::remove(std::size_t id, std::size_t tick, bool squashed) {
+        auto it = inFlight_.find(id);
+        if (it == inFlight_.end()) {
+            return;
+        }
+        const InFlight& instruction = it->second;
+        if (!squashed) {
+            ++retiredCnt_;
+        }
+        if (format_ == Format::kanata) {
+            if (instruction.fileId && inRange(tick)) {
+                kanataCycle(tick);
+                os_ << "E\t" << *instruction.fileId << "\t0\t" << instruction.stage << "\n";
+                os_ << "R\t" << *instruction.fileId << "\t" << (squashed ? id : retiredCnt_) << "\t" << (squashed ? 1 : 0) << "\n";
+            }
+        } else if (instruction.fetch < to_ && tick >= from_) {
+            writeO3(id, instruction, tick, squashed);
+        }
+        inFlight_.erase(it);
+    }
+
+    void PipeViewWriter::kanataCycle(std::size_t tick) {
+        if (!lastCycle_) {
+            os_ << "C=\t" << tick << "\n";
+        } else if (*lastCycle_ != tick) {
+            os_ << "C\t" << tick - *lastCycle_ << "\n";
+        }
+        lastCycle_ = tick;
+    }
+
+    void PipeViewWriter::writeO3(std::size_t id, const InFlight& instruction, std::size_t retire, bool squashed) {
+        auto time = [](std::optional<std::size_t> tick) {
+            return tick ? *tick * o3TicksPerCycle : 0;
+        };
+        StatsLogger::InstructionInfo info = lookup_(id);
+        os_ << "O3PipeView:fetch:" << time(instruction.fetch) << ":0x" << std::hex << std::setw(8) << std::setfill('0') << info.pc
+            << std::dec << std::setfill(' ') << ":0:" << id << ":" << info.instruction->toString() << "\n";
+        os_ << "O3PipeView:decode:" << time(instruction.decode) << "\n";
+        os_ << "O3PipeView:rename:" << time(instruction.dispatch) << "\n";
+        os_ << "O3PipeView:dispatch:" << time(instruction.dispatch) << "\n";
+        os_ << "O3PipeView:issue:" << time(instruction.issue) << "\n";
+        os_ << "O3PipeView:complete:" << time(instruction.complete) << "\n";
+        os_ << "O3PipeView:retire:" << (squashed ? 0 : time(retire)) << ":store:0\n";
+    }
+
+    PipeViewWriter::Format PipeViewWriter::parseFormat(const std::string& text) {
+        if (text == "kanata") {
+            return Format::kanata;
+        }
+        if (text == "o3") {
+            return Format::o3PipeView;
+        }
+        throw std::invalid_argument("Unknown pipe view format '" + text + "', expected kanata or o3");
+    }
+
+    std::pair<std::size_t, std::size_t> PipeViewWriter::parseRange(const std::string& text) {
+        std::size_t colon = text.find(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("Invalid tick range '" + text + "', expected from:to");
+        }
+        auto parse = [&](const std::string& part, std::size_t otherwise) {
+            if (part.empty()) {
+                return otherwise;
+            }
+            if (!std::all_of(part.begin(), part.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+                throw std::invalid_argument("Invalid tick range '" + text + "', expected from:to");
+            }
+            return static_cast<std::size_t>(std::stoull(part));
+        };
+        return {parse(text.substr(0, colon), 0),
+                parse(text.substr(colon + 1), std::numeric_limits<std::size_t>::max())};
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stats_logger.h"
+
+namespace tiny::t86 {
+    enum class PipeViewFormat {
+        kanata, o3PipeView
+    };
+
+    /**
+     * Writes per instruction stage timelines for pipeline viewers like Konata
+     *
+     * Two formats are supported:
+     *   - Kanata log (Konata's own), with every phase of StatsLogger as a stage and squashed instructions flushed
+     *   - gem5 O3PipeView, stages are mapped to fetch, decode, rename = dispatch (entering reservation station),
+     *     issue (start of execution), complete and retire, squashed instructions have retire tick 0.
+     *     Ticks are multiplied by o3TicksPerCycle.
+     * Instructions are identified by their StatsLogger id. Only ticks in the [from, to) range are written,
+     * so a window of a long run can be looked at.
+     */
+    class PipeViewWriter {
+    public:
+        using Format = PipeViewFormat;
+
+        using Lookup = std::function<StatsLogger::InstructionInfo(std::size_t id)>;
+
+        constexpr static std::size_t o3TicksPerCycle = 1000;
+
+        PipeViewWriter(std::ostream& os, Lookup lookup, Format format,
+                       std::size_t from = 0, std::size_t to = std::numeric_limits<std::size_t>::max());
+
+        PipeViewWriter(const PipeViewWriter&) = delete;
+
+        PipeViewWriter& operator=(const PipeViewWriter&) = delete;
+
+        void tick(std::size_t tick, const StatsLogger::TickStats& stats);
+
+        void finish(std::size_t endTick);
+
+        // "kanata" or "o3", throws std::invalid_argument otherwise
+        static Format parseFormat(const std::string& text);
+
+        // "from:to" with both optional, throws std::invalid_argument
+        static std::pair<std::size_t, std::size_t> parseRange(const std::string& text);
+
+    private:
+        struct InFlight {
+            // Kanata
+            std::optional<std::size_t> fileId;
+            const char* stage{nullptr};
+
+            // O3PipeView
+            std::size_t fetch{0};
+            std::optional<std::size_t> decode;
+            std::optional<std::size_t> dispatch;
+            std::optional<std::size_t> issue;
+            std::optional<std::size_t> complete;
+        };
+
+        bool inRange(std::size_t tick) const {
+            return tick >= from_ && tick < to_;
+        }
+
+        void setStage(std::size_t id, InFlight& instruction, std::size_t tick, const char* stage);
+
+        // Retired or squashed, instruction is forgotten afterwards
+        void remove(std::size_t id, std::size_t tick, bool squashed);
+
+        void kanataCycle(std::size_t tick);
+
+        void writeO3(std::size_t id, const InFlight& instruction, std::size_t retire, bool squashed);
+
+        std::ostream& os_;
+
+        Lookup lookup_;
+
+        Format format_;
+
+        std::size_t from_;
+
+        std::size_t to_;
+
+        std::unordered_map<std::size_t, InFlight> inFlight_;
+
+        // Retired in previous tick, so the retirement is visible as its own stage
+        std::vector<std::size_t> retiring_;
+
+        std::optional<std::size_t> lastCycle_;
+
+        std::size_t nextFileId_{0};
+
+        std::size_t retiredCnt_{0};
+    };
+}
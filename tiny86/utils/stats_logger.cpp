@@ -1,32 +1,130 @@
 #include "stats_logger.h"
 
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_set>
 #include <cassert>
 #include "../instruction.h"
+#include "../program.h"
+#include "chrome_trace_writer.h"
+#include "pipe_view_writer.h"
 
 namespace tiny::t86 {
     void StatsLogger::logInstructionFetch(std::size_t id) {
         currentTick().instructionFetchPc = id;
+        fetchTicks_.emplace(id, ticks_.size() - 1);
     }
 
-    void StatsLogger::logInstructionDecode(std::size_t id) {
-        currentTick().instructionDecodePc = id;
+    void StatsLogger::logInstructionDecode(std::size_t stage, std::size_t id) {
+        auto& stages = currentTick().instructionDecodePcs;
+        if (stages.size() <= stage) {
+            stages.resize(stage + 1);
+        }
+        stages[stage] = id;
+    }
+
+    void StatsLogger::logDispatchReady() {
+        currentTick().dispatchReady = true;
+    }
+
+    void StatsLogger::logInstructionCacheAccess(InstructionCache::Access access) {
+        currentTick().instructionCacheAccess = access;
+    }
+
+    void StatsLogger::logLoopBufferDelivery() {
+        ++loopBufferDeliveries_;
+    }
+
+    void StatsLogger::logDemandRead() {
+        ++prefetchStats_.demandReads;
+    }
+
+    void StatsLogger::logPrefetchIssued() {
+        ++prefetchStats_.issued;
+    }
+
+    void StatsLogger::logPrefetchUse(bool timely) {
+        ++(timely ? prefetchStats_.timely : prefetchStats_.late);
+    }
+
+    void StatsLogger::logPrefetchEvicted() {
+        ++prefetchStats_.evicted;
+    }
+
+    void StatsLogger::logLoadRetirement(bool correctlyPredicted) {
+        ++valuePredictionStats_.loads;
+        valuePredictionStats_.correct += correctlyPredicted;
+    }
+
+    void StatsLogger::logValueMispredict() {
+        ++valuePredictionStats_.wrong;
+    }
+
+    void StatsLogger::logDramAccess(std::size_t bank, DramTiming::RowOutcome outcome, bool write) {
+        auto& stats = dramStats_;
+        ++(write ? stats.writes : stats.reads);
+        if (stats.bankAccesses.size() <= bank) {
+            stats.bankAccesses.resize(bank + 1);
+            stats.bankRowHits.resize(bank + 1);
+        }
+        ++stats.bankAccesses[bank];
+        switch (outcome) {
+            case DramTiming::RowOutcome::hit:
+                ++stats.rowHits;
+                ++stats.bankRowHits[bank];
+                break;
+            case DramTiming::RowOutcome::empty:
+                ++stats.rowEmpty;
+                break;
+            case DramTiming::RowOutcome::conflict:
+                ++stats.rowConflicts;
+                break;
+        }
+    }
+
+    void StatsLogger::logDramBankConflict() {
+        ++dramStats_.bankConflicts;
+    }
+
+    void StatsLogger::logDramQueued(std::size_t count) {
+        dramStats_.queuedTicks += count;
     }
 
     void StatsLogger::logStallRetirement(std::size_t id) {
         currentTick().stallRetirementRSEntries.push_back(id);
     }
 
+    StatsLogger* StatsLogger::selected_ = nullptr;
+
     StatsLogger& StatsLogger::instance() {
+        if (selected_) {
+            return *selected_;
+        }
         static StatsLogger instance;
         return instance;
     }
 
+    void StatsLogger::select(StatsLogger* logger) {
+        selected_ = logger;
+    }
+
+    void StatsLogger::logStallSerialization(std::size_t id) {
+        currentTick().stallSerializationRSEntries.push_back(id);
+    }
+
     void StatsLogger::logNoAluAvailable(std::size_t id) {
         currentTick().stallNoAluRSEntries.push_back(id);
     }
 
+    StatsLogger::StatsLogger() = default;
+
+    StatsLogger::~StatsLogger() = default;
+
     void StatsLogger::newTick() {
+        if (chromeTrace_ && !ticks_.empty()) {
+            chromeTrace_->tick(ticks_.size() - 1, ticks_.back());
+        }
         ticks_.emplace_back();
     }
 
@@ -56,6 +154,12 @@ namespace tiny::t86 {
         os << "Average instruction latency: " << 1 / throughput << " ticks\n";
         os << "Global averages:\n";
         processAverageLifetime(os, accumulativeInstructionLifeTime, totalInstructions);
+        processInstructionCacheStats(os);
+        processLoopBufferStats(os);
+        processPrefetchStats(os);
+        processValuePredictionStats(os);
+        processDramStats(os);
+        processThreadStats(os);
         std::cerr << std::flush;
     }
 
@@ -81,9 +185,654 @@ namespace tiny::t86 {
         }
     }
 
+    void StatsLogger::processInstructionCacheStats(std::ostream& os) {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t stalls = 0;
+        for (const auto& tick : ticks_) {
+            if (!tick.instructionCacheAccess) {
+                continue;
+            }
+            hits += *tick.instructionCacheAccess == InstructionCache::Access::hit;
+            misses += *tick.instructionCacheAccess == InstructionCache::Access::miss;
+            stalls += tick.fetchStalled();
+        }
+        if (hits + misses == 0) {
+            return;
+        }
+        os << "Instruction cache:\n";
+        os << "  Hits: " << hits << ", misses: " << misses
+           << " (" << 100.0 * misses / (hits + misses) << " % miss rate)\n";
+        os << "  Fetch stalled: " << stalls << " ticks (" << 100.0 * stalls / ticks_.size() << " % of ticks)\n";
+    }
+
+    void StatsLogger::processLoopBufferStats(std::ostream& os) {
+        if (loopBufferDeliveries_ == 0) {
+            return;
+        }
+        std::size_t fetched = instructions_.size() + squashedInstructions_.size();
+        os << "Loop buffer:\n";
+        os << "  Delivered: " << loopBufferDeliveries_ << " instructions ("
+           << 100.0 * loopBufferDeliveries_ / fetched << " % of fetched ones)\n";
+    }
+
+    void StatsLogger::processPrefetchStats(std::ostream& os) {
+        const auto& stats = prefetchStats_;
+        if (stats.issued == 0) {
+            return;
+        }
+        std::size_t useful = stats.timely + stats.late;
+        auto percent = [](std::size_t part, std::size_t total) {
+            return total ? 100.0 * part / total : 0;
+        };
+        os << "Prefetcher:\n";
+        os << "  Issued: " << stats.issued << ", useful: " << useful
+           << " (" << percent(useful, stats.issued) << " % accuracy), evicted unused: " << stats.evicted << "\n";
+        os << "  Timely: " << stats.timely << ", late: " << stats.late
+           << " (" << percent(stats.timely, useful) << " % timeliness)\n";
+        // Reads which were not prefetched had to start their own RAM read
+        os << "  Coverage: " << percent(useful, useful + stats.demandReads) << " % of RAM reads\n";
+    }
+
+    void StatsLogger::processValuePredictionStats(std::ostream& os) {
+        const auto& stats = valuePredictionStats_;
+        if (stats.loads == 0) {
+            return;
+        }
+        std::size_t predicted = stats.correct + stats.wrong;
+        auto percent = [](std::size_t part, std::size_t total) {
+            return total ? 100.0 * part / total : 0;
+        };
+        os << "Value predictor:\n";
+        // Replayed loads retire once more without prediction, so they are counted only once
+        os << "  Loads: " << stats.loads << ", predicted: " << predicted
+           << " (" << percent(predicted, stats.loads) << " % coverage)\n";
+        os << "  Correct: " << stats.correct << ", replayed: " << stats.wrong
+           << " (" << percent(stats.correct, predicted) << " % accuracy)\n";
+    }
+
+    void StatsLogger::processThreadStats(std::ostream& os) {
+        std::size_t threadsCnt = instructionThreads_.empty()
+                ? 0 : *std::max_element(instructionThreads_.begin(), instructionThreads_.end()) + 1;
+        if (threadsCnt < 2) {
+            return;
+        }
+        std::vector<std::size_t> retired(threadsCnt);
+        std::vector<std::size_t> squashed(threadsCnt);
+        for (const auto& [id, ins] : instructions_) {
+            ++retired[instructionThreads_[id]];
+        }
+        for (const auto& [id, ins] : squashedInstructions_) {
+            ++squashed[instructionThreads_[id]];
+        }
+        os << "Hardware threads:\n";
+        for (std::size_t thread = 0; thread < threadsCnt; ++thread) {
+            // Thread which did not halt ran until the end
+            std::size_t ticks = ticks_.size();
+            if (auto it = threadHalts_.find(thread); it != threadHalts_.end()) {
+                ticks = it->second;
+            }
+            os << "  Thread " << thread << ": " << retired[thread] << " instructions retired, "
+               << squashed[thread] << " squashed, halted at tick " << ticks
+               << ", " << static_cast<double>(retired[thread]) / ticks << " instructions per tick\n";
+        }
+    }
+
+    void StatsLogger::processDramStats(std::ostream& os) {
+        const auto& stats = dramStats_;
+        std::size_t accesses = stats.reads + stats.writes;
+        if (accesses == 0) {
+            return;
+        }
+        os << "DRAM:\n";
+        os << "  Accesses: " << accesses << " (" << stats.reads << " reads, " << stats.writes << " writes)\n";
+        os << "  Row hits: " << stats.rowHits << " (" << 100.0 * stats.rowHits / accesses << " %), empty: "
+           << stats.rowEmpty << ", conflicts: " << stats.rowConflicts << "\n";
+        os << "  Bank conflicts: " << stats.bankConflicts << " requests waited for busy bank\n";
+        os << "  Average queue wait: " << static_cast<double>(stats.queuedTicks) / accesses << " ticks\n";
+        os << "  Per bank (accesses / row hits):";
+        for (std::size_t bank = 0; bank < stats.bankAccesses.size(); ++bank) {
+            os << " " << stats.bankAccesses[bank] << "/" << stats.bankRowHits[bank];
+        }
+        os << "\n";
+    }
+
+    void StatsLogger::processTopDownStats(std::ostream& os) {
+        TopDown topDown = getTopDown();
+        std::size_t totalTicks = ticks_.size();
+        auto line = [&](const char* name, std::size_t ticks) {
+            os << std::left << std::setw(28) << name << std::right << std::setw(10) << ticks
+               << std::setw(9) << std::fixed << std::setprecision(2)
+               << (totalTicks ? 100.0 * ticks / totalTicks : 0) << " %\n" << std::defaultfloat;
+        };
+        os << "------------------------------------------\n";
+        os << "Top-down breakdown of " << totalTicks << " dispatch slots (ticks):\n";
+        line("  Retiring", topDown.retiring);
+        line("  Bad speculation", topDown.badSpeculation);
+        line("    Frontend refill", topDown.badSpeculationRefill);
+        line("  Frontend bound", topDown.frontendBound);
+        line("    Instruction cache", topDown.frontendInstructionCacheBound);
+        line("  Backend bound", topDown.backendBound());
+        line("    Memory (RAM read)", topDown.backendMemoryBound);
+        line("    ALU", topDown.backendAluBound);
+        line("    Dependency (register)", topDown.backendDependencyBound);
+        line("    Core (execution, retire)", topDown.backendCoreBound);
+        if (topDown.redirects) {
+            os << "Pipeline flushes: " << topDown.redirects << ", "
+               << static_cast<double>(topDown.badSpeculationRefill) / topDown.redirects << " refill ticks per flush\n";
+        }
+        os << std::flush;
+    }
+
+    StatsLogger::TopDown StatsLogger::getTopDown() const {
+        // Every tick at most one instruction moves from decode to reservation station,
+        // the tick is classified by what happened to that slot
+        TopDown topDown;
+        std::unordered_set<std::size_t> dispatched;
+        bool recovering = false;
+        bool decodeOccupied = false;
+        bool fetchStalled = false;
+        bool previousFetchStalled = false;
+        for (const auto& tick : ticks_) {
+            if (!tick.clearedSpeculationEntries.empty()) {
+                recovering = true;
+                ++topDown.redirects;
+            }
+            std::optional<std::size_t> dispatchedId;
+            for (std::size_t id : tick.operandFetchingRSEntries) {
+                if (dispatched.insert(id).second) {
+                    dispatchedId = id;
+                }
+            }
+            if (dispatchedId) {
+                recovering = false;
+                if (instructions_.count(*dispatchedId)) {
+                    ++topDown.retiring;
+                } else {
+                    ++topDown.badSpeculation;
+                }
+            } else if (recovering) {
+                // Refilling the pipeline after it was flushed
+                ++topDown.badSpeculation;
+                ++topDown.badSpeculationRefill;
+            } else if (!decodeOccupied) {
+                ++topDown.frontendBound;
+                if (fetchStalled) {
+                    ++topDown.frontendInstructionCacheBound;
+                }
+            } else if (!tick.stallRAMReadRSEntries.empty()) {
+                ++topDown.backendMemoryBound;
+            } else if (!tick.stallNoAluRSEntries.empty()) {
+                ++topDown.backendAluBound;
+            } else if (!tick.stallRegisterFetchRSEntries.empty() || !tick.stallFloatRegisterFetchRSEntries.empty()
+                    || !tick.stallVectorRegisterFetchRSEntries.empty()) {
+                ++topDown.backendDependencyBound;
+            } else {
+                ++topDown.backendCoreBound;
+            }
+            // Decode is logged at the end of the tick, so it tells what is available for the next one
+            decodeOccupied = tick.dispatchReady;
+            // Stalled fetch empties the decode slot one tick later
+            fetchStalled = previousFetchStalled;
+            previousFetchStalled = tick.fetchStalled();
+        }
+        return topDown;
+    }
+
+    void StatsLogger::startChromeTrace(std::ostream& os) {
+        finishChromeTrace();
+        chromeTrace_ = std::make_unique<ChromeTraceWriter>(os, [this](std::size_t id) { return instructionInfo(id); });
+    }
+
+    void StatsLogger::finishChromeTrace() {
+        if (!chromeTrace_) {
+            return;
+        }
+        if (!ticks_.empty()) {
+            chromeTrace_->tick(ticks_.size() - 1, ticks_.back());
+        }
+        chromeTrace_->finish(ticks_.size());
+        chromeTrace_.reset();
+    }
+
+    void StatsLogger::processPipeView(std::ostream& os, PipeViewWriter::Format format,
+                                      std::size_t from, std::size_t to) {
+        PipeViewWriter writer(os, [this](std::size_t id) { return instructionInfo(id); }, format, from, to);
+        for (std::size_t tick = 0; tick < ticks_.size(); ++tick) {
+            writer.tick(tick, ticks_[tick]);
+        }
+        writer.finish(ticks_.size());
+    }
+
+    StatsLogger::InstructionInfo StatsLogger::instructionInfo(std::size_t id) const {
+        if (auto it = instructions_.find(id); it != instructions_.end()) {
+            return {it->second.first, it->second.second, false, instructionThreads_.at(id)};
+        }
+        const auto& [pc, instruction] = squashedInstructions_.at(id);
+        return {pc, instruction, true, instructionThreads_.at(id)};
+    }
+
+    const char* StatsLogger::phaseName(Phase phase) {
+        switch (phase) {
+            case Phase::preparing:
+                return "Preparing";
+            case Phase::registerStall:
+                return "Register stall";
+            case Phase::memoryStall:
+                return "Memory stall";
+            case Phase::waitingForSerialization:
+                return "Waiting for serialization";
+            case Phase::waitingForAlu:
+                return "Waiting for ALU";
+            case Phase::executing:
+                return "Executing";
+            case Phase::waitingForRetirement:
+                return "Waiting for retirement";
+        }
+        return "";
+    }
+
+    std::map<std::size_t, StatsLogger::Phase> StatsLogger::TickStats::reservationStationPhases() const {
+        std::map<std::size_t, Phase> phases;
+        for (std::size_t id : operandFetchingRSEntries) {
+            phases[id] = Phase::preparing;
+        }
+        for (std::size_t id : operandFetchingStallRSEntries) {
+            phases[id] = stallRAMReadRSEntries.count(id) ? Phase::memoryStall : Phase::registerStall;
+        }
+        for (std::size_t id : stallSerializationRSEntries) {
+            phases[id] = Phase::waitingForSerialization;
+        }
+        for (std::size_t id : stallNoAluRSEntries) {
+            phases[id] = Phase::waitingForAlu;
+        }
+        for (std::size_t id : executingRSEntries) {
+            phases[id] = Phase::executing;
+        }
+        for (std::size_t id : stallRetirementRSEntries) {
+            phases[id] = Phase::waitingForRetirement;
+        }
+        return phases;
+    }
+
+    void StatsLogger::processPcProfile(std::ostream& os, const Program* program) {
+        auto profiles = getPcProfiles();
+        bool lines = program && !program->lines().empty();
+        std::size_t totalTime = 0;
+        for (const auto& profile : profiles) {
+            totalTime += profile.lifeTime.totalTime();
+        }
+        os << "------------------------------------------\n";
+        os << "Hot spots (ticks summed over all retired instances, hottest first):\n";
+        os << std::right
+           << std::setw(6) << "PC";
+        if (lines) {
+            os << std::setw(6) << "Line";
+        }
+        os << std::setw(9) << "Retired"
+           << std::setw(9) << "Ticks"
+           << std::setw(7) << "%"
+           << std::setw(8) << "Fetch"
+           << std::setw(8) << "Decode"
+           << std::setw(8) << "Prepare"
+           << std::setw(8) << "RegStl"
+           << std::setw(8) << "MemStl"
+           << std::setw(8) << "AluStl"
+           << std::setw(8) << "Exec"
+           << std::setw(8) << "RetStl"
+           << std::setw(8) << "Mispr"
+           << "  Instruction\n";
+        for (const auto& profile : profiles) {
+            const auto& lt = profile.lifeTime;
+            double share = totalTime ? 100.0 * lt.totalTime() / totalTime : 0;
+            os << std::setw(6) << profile.pc;
+            if (lines) {
+                std::size_t line = program->lineAt(profile.pc);
+                os << std::setw(6) << (line ? std::to_string(line) : "?");
+            }
+            os << std::setw(9) << profile.retired
+               << std::setw(9) << lt.totalTime()
+               << std::setw(7) << std::fixed << std::setprecision(2) << share << std::defaultfloat
+               << std::setw(8) << lt.fetch
+               << std::setw(8) << lt.decode
+               << std::setw(8) << lt.preparing
+               << std::setw(8) << profile.registerStalls()
+               << std::setw(8) << profile.memoryStalls()
+               << std::setw(8) << lt.waitingForAlu
+               << std::setw(8) << lt.executing
+               << std::setw(8) << lt.waitingForRetirement
+               << std::setw(8) << profile.mispredicts
+               << "  " << profile.instruction->toString() << '\n';
+        }
+        os << std::flush;
+    }
+
+    void StatsLogger::processPcProfileCsv(std::ostream& os, const Program* program) {
+        bool lines = program && !program->lines().empty();
+        os << "pc,instruction,retired,ticks,fetch,decode,preparing,operand_fetch_stalls,register_stalls,"
+              "memory_stalls,alu_stalls,executing,retirement_stalls,retirement,mispredicts"
+           << (lines ? ",line\n" : "\n");
+        for (const auto& profile : getPcProfiles()) {
+            const auto& lt = profile.lifeTime;
+            os << profile.pc << ",\"" << profile.instruction->toString() << "\","
+               << profile.retired << ','
+               << lt.totalTime() << ','
+               << lt.fetch << ','
+               << lt.decode << ','
+               << lt.preparing << ','
+               << lt.fetchingStalls << ','
+               << profile.registerStalls() << ','
+               << profile.memoryStalls() << ','
+               << lt.waitingForAlu << ','
+               << lt.executing << ','
+               << lt.waitingForRetirement << ','
+               << lt.retirement << ','
+               << profile.mispredicts;
+            if (lines) {
+                os << ',' << program->lineAt(profile.pc);
+            }
+            os << '\n';
+        }
+        os << std::flush;
+    }
+
+    std::vector<StatsLogger::PcProfile> StatsLogger::getPcProfiles() {
+        std::map<std::size_t, PcProfile> byPc;
+        for (const auto& [id, ins] : instructions_) {
+            const auto& [pc, instruction] = ins;
+            auto& profile = byPc.try_emplace(pc, PcProfile{pc, instruction}).first->second;
+            profile.lifeTime += getInstructionLifeTime(id);
+            ++profile.retired;
+        }
+        for (const auto& tick : ticks_) {
+            for (std::size_t id : tick.mispredictedRSEntries) {
+                if (auto it = instructions_.find(id); it != instructions_.end()) {
+                    ++byPc.at(it->second.first).mispredicts;
+                }
+            }
+        }
+        std::vector<PcProfile> profiles;
+        profiles.reserve(byPc.size());
+        for (auto& [pc, profile] : byPc) {
+            profiles.push_back(std::move(profile));
+        }
+        std::stable_sort(profiles.begin(), profiles.end(), [](const PcProfile& a, const PcProfile& b) {
+            return a.lifeTime.totalTime() > b.lifeTime.totalTime();
+        });
+        return profiles;
+    }
+
+    void StatsLogger::processFunctionProfile(std::ostream& os, const Program& program) {
+        auto profiles = getFunctionProfiles(program);
+        const auto& functions = profiles.functions;
+        std::size_t totalTicks = 0;
+        std::vector<std::size_t> executed;
+        for (std::size_t i = 0; i < functions.size(); ++i) {
+            totalTicks += functions[i].selfTicks;
+            if (functions[i].selfRetired) {
+                executed.push_back(i);
+            }
+        }
+        auto share = [totalTicks](std::size_t ticks) {
+            return totalTicks ? 100.0 * ticks / totalTicks : 0;
+        };
+        auto perCall = [](std::size_t ticks, std::size_t calls) {
+            return calls ? static_cast<double>(ticks) / calls : 0;
+        };
+
+        std::stable_sort(executed.begin(), executed.end(), [&](std::size_t a, std::size_t b) {
+            return functions[a].selfTicks > functions[b].selfTicks;
+        });
+        os << "------------------------------------------\n";
+        os << "Flat profile (each tick goes to the next instruction to retire):\n";
+        os << std::right
+           << std::setw(7) << "%"
+           << std::setw(9) << "Self"
+           << std::setw(10) << "Inclusive"
+           << std::setw(8) << "Calls"
+           << std::setw(10) << "Self/call"
+           << std::setw(10) << "Incl/call"
+           << std::setw(9) << "Retired"
+           << std::setw(8) << "RegStl"
+           << std::setw(8) << "MemStl"
+           << std::setw(8) << "Mispr"
+           << "  Function\n";
+        for (std::size_t i : executed) {
+            const auto& f = functions[i];
+            os << std::setw(7) << std::fixed << std::setprecision(2) << share(f.selfTicks)
+               << std::setw(9) << f.selfTicks
+               << std::setw(10) << f.inclusiveTicks
+               << std::setw(8) << f.calls
+               << std::setw(10) << perCall(f.selfTicks, f.calls)
+               << std::setw(10) << perCall(f.inclusiveTicks, f.calls) << std::defaultfloat
+               << std::setw(9) << f.selfRetired
+               << std::setw(8) << f.registerStalls
+               << std::setw(8) << f.memoryStalls
+               << std::setw(8) << f.mispredicts
+               << "  " << f.name << '\n';
+        }
+
+        std::stable_sort(executed.begin(), executed.end(), [&](std::size_t a, std::size_t b) {
+            return functions[a].inclusiveTicks > functions[b].inclusiveTicks;
+        });
+        os << "\nCall graph (ticks of the callee and everything it called, per caller):\n";
+        for (std::size_t i : executed) {
+            const auto& f = functions[i];
+            os << std::left << std::setw(24) << f.name << std::right
+               << " inclusive " << f.inclusiveTicks
+               << " (" << std::fixed << std::setprecision(2) << share(f.inclusiveTicks) << std::defaultfloat << " %)"
+               << ", self " << f.selfTicks << ", " << f.calls << " calls\n";
+            for (const auto& [edge, stats] : profiles.edges) {
+                if (edge.second == i) {
+                    os << "    called by  " << std::left << std::setw(24) << functions[edge.first].name << std::right
+                       << std::setw(8) << stats.calls << " calls" << std::setw(10) << stats.ticks << " ticks\n";
+                }
+            }
+            for (const auto& [edge, stats] : profiles.edges) {
+                if (edge.first == i) {
+                    os << "    calls      " << std::left << std::setw(24) << functions[edge.second].name << std::right
+                       << std::setw(8) << stats.calls << " calls" << std::setw(10) << stats.ticks << " ticks\n";
+                }
+            }
+        }
+        os << std::flush;
+    }
+
+    StatsLogger::FunctionProfiles StatsLogger::getFunctionProfiles(const Program& program) {
+        const auto& symbols = program.symbols();
+        FunctionProfiles result;
+        result.functions.resize(symbols.size() + 1);
+        for (std::size_t i = 0; i < symbols.size(); ++i) {
+            result.functions[i].name = symbols[i].name;
+        }
+        std::size_t outside = symbols.size();
+        result.functions[outside].name = "<outside functions>";
+        auto functionAt = [&](std::size_t pc) {
+            const auto* symbol = program.symbolAt(pc);
+            return symbol ? static_cast<std::size_t>(symbol - symbols.data()) : outside;
+        };
+
+        auto mispredicted = getMispredicted();
+        std::vector<std::size_t> stack;
+        bool calling = false;
+        // Instruction which last counted the function, so recursion is counted once
+        std::vector<std::size_t> countedBy(result.functions.size(), std::numeric_limits<std::size_t>::max());
+        std::set<std::pair<std::size_t, std::size_t>> countedEdges;
+        for (const auto& [id, ticks] : getChargedTicks()) {
+            const auto& [pc, instruction] = instructions_.at(id);
+            std::size_t function = functionAt(pc);
+            if (stack.empty()) {
+                stack.push_back(function);
+            } else if (calling) {
+                ++result.functions[function].calls;
+                ++result.edges[{stack.back(), function}].calls;
+                stack.push_back(function);
+            } else {
+                // Jumped from one function to other without a call, e.g. into main
+                stack.back() = function;
+            }
+            calling = false;
+
+            auto lifeTime = getInstructionLifeTime(id);
+            auto& self = result.functions[function];
+            self.selfTicks += ticks;
+            ++self.selfRetired;
+            self.registerStalls += lifeTime.registerStalls();
+            self.memoryStalls += lifeTime.memoryStalls();
+            self.mispredicts += mispredicted.count(id);
+
+            countedEdges.clear();
+            for (std::size_t i = 0; i < stack.size(); ++i) {
+                auto& f = result.functions[stack[i]];
+                if (countedBy[stack[i]] != id) {
+                    countedBy[stack[i]] = id;
+                    f.inclusiveTicks += ticks;
+                    ++f.inclusiveRetired;
+                }
+                if (i > 0 && countedEdges.emplace(stack[i - 1], stack[i]).second) {
+                    result.edges[{stack[i - 1], stack[i]}].ticks += ticks;
+                }
+            }
+
+            if (instruction->type() == Instruction::Type::CALL) {
+                calling = true;
+            } else if (instruction->type() == Instruction::Type::RET && !stack.empty()) {
+                stack.pop_back();
+            }
+        }
+        return result;
+    }
+
+    void StatsLogger::processLineProfile(std::ostream& os, const Program& program) {
+        auto profiles = getLineProfiles(program);
+        std::size_t totalTicks = 0;
+        for (const auto& profile : profiles) {
+            totalTicks += profile.ticks;
+        }
+        os << "------------------------------------------\n";
+        os << "Source lines (each tick goes to the next instruction to retire, hottest first):\n";
+        os << std::right
+           << std::setw(6) << "Line"
+           << std::setw(9) << "Retired"
+           << std::setw(9) << "Ticks"
+           << std::setw(7) << "%"
+           << std::setw(10) << "Pipeline"
+           << std::setw(8) << "RegStl"
+           << std::setw(8) << "MemStl"
+           << std::setw(8) << "Mispr"
+           << "  Function\n";
+        for (const auto& profile : profiles) {
+            double share = totalTicks ? 100.0 * profile.ticks / totalTicks : 0;
+            std::string functions;
+            for (const auto& name : profile.functions) {
+                functions += (functions.empty() ? "" : ", ") + name;
+            }
+            os << std::setw(6) << (profile.line ? std::to_string(profile.line) : "?")
+               << std::setw(9) << profile.retired
+               << std::setw(9) << profile.ticks
+               << std::setw(7) << std::fixed << std::setprecision(2) << share << std::defaultfloat
+               << std::setw(10) << profile.pipelineTicks
+               << std::setw(8) << profile.registerStalls
+               << std::setw(8) << profile.memoryStalls
+               << std::setw(8) << profile.mispredicts
+               << "  " << functions << '\n';
+        }
+        os << std::flush;
+    }
+
+    std::vector<StatsLogger::LineProfile> StatsLogger::getLineProfiles(const Program& program) {
+        auto mispredicted = getMispredicted();
+        std::map<std::size_t, LineProfile> byLine;
+        for (const auto& [id, ticks] : getChargedTicks()) {
+            std::size_t pc = instructions_.at(id).first;
+            std::size_t line = program.lineAt(pc);
+            auto& profile = byLine.try_emplace(line, LineProfile{line}).first->second;
+            const auto* symbol = program.symbolAt(pc);
+            profile.functions.insert(symbol ? symbol->name : "<outside functions>");
+            auto lifeTime = getInstructionLifeTime(id);
+            ++profile.retired;
+            profile.ticks += ticks;
+            profile.pipelineTicks += lifeTime.totalTime();
+            profile.registerStalls += lifeTime.registerStalls();
+            profile.memoryStalls += lifeTime.memoryStalls();
+            profile.mispredicts += mispredicted.count(id);
+        }
+        std::vector<LineProfile> profiles;
+        profiles.reserve(byLine.size());
+        for (auto& [line, profile] : byLine) {
+            profiles.push_back(std::move(profile));
+        }
+        std::stable_sort(profiles.begin(), profiles.end(), [](const LineProfile& a, const LineProfile& b) {
+            return a.ticks > b.ticks;
+        });
+        return profiles;
+    }
+
+    std::map<std::size_t, std::size_t> StatsLogger::getChargedTicks() const {
+        // Ids are given in program order, so retirement order of a thread is ascending id
+        std::map<std::size_t, std::size_t> retirementTicks;
+        for (std::size_t tick = 0; tick < ticks_.size(); ++tick) {
+            for (std::size_t id : ticks_[tick].retiredRSEntries) {
+                bool otherThread = id < instructionThreads_.size() && instructionThreads_[id] != 0;
+                if (!otherThread && instructions_.count(id)) {
+                    retirementTicks.emplace(id, tick);
+                }
+            }
+        }
+        std::size_t lastRetirement = 0;
+        for (auto& [id, tick] : retirementTicks) {
+            std::size_t retiredAt = tick + 1;
+            tick = retiredAt - lastRetirement;
+            lastRetirement = retiredAt;
+        }
+        return retirementTicks;
+    }
+
+    std::unordered_set<std::size_t> StatsLogger::getMispredicted() const {
+        std::unordered_set<std::size_t> mispredicted;
+        for (const auto& tick : ticks_) {
+            for (std::size_t id : tick.mispredictedRSEntries) {
+                if (instructions_.count(id)) {
+                    mispredicted.insert(id);
+                }
+            }
+        }
+        return mispredicted;
+    }
+
+    std::size_t StatsLogger::InstructionLifeTime::registerStalls() const {
+        std::size_t total = 0;
+        for (const auto& [reg, count] : waitingForRegisterFetch) {
+            total += count;
+        }
+        for (const auto& [fReg, count] : waitingForFloatRegisterFetch) {
+            total += count;
+        }
+        for (const auto& [vReg, count] : waitingForVectorRegisterFetch) {
+            total += count;
+        }
+        return total;
+    }
+
+    std::size_t StatsLogger::InstructionLifeTime::memoryStalls() const {
+        std::size_t total = 0;
+        for (const auto& [address, count] : waitingForMemoryRead) {
+            total += count;
+        }
+        return total;
+    }
+
     void StatsLogger::reset() {
         ticks_.clear();
         instructions_.clear();
+        squashedInstructions_.clear();
+        fetchTicks_.clear();
+        instructionThreads_.clear();
+        threadHalts_.clear();
+        prefetchStats_ = {};
+        loopBufferDeliveries_ = 0;
+        valuePredictionStats_ = {};
+        dramStats_ = {};
         id_ = 0;
     }
 
@@ -107,6 +856,10 @@ namespace tiny::t86 {
         currentTick().stallFloatRegisterFetchRSEntries[id].insert(fReg);
     }
 
+    void StatsLogger::logStallVectorRegisterFetch(std::size_t id, VectorRegister vReg) {
+        currentTick().stallVectorRegisterFetchRSEntries[id].insert(vReg);
+    }
+
     void StatsLogger::logStallRAMRead(std::size_t id, std::size_t address) {
         currentTick().stallRAMReadRSEntries[id].insert(address);
     }
@@ -142,6 +895,14 @@ namespace tiny::t86 {
             os << "      Average float register fetch stalls: " << static_cast<double>(totalWaitingForFloatRegisters) / totalCount << " ticks\n";
         }
 
+        std::size_t totalWaitingForVectorRegisters = 0;
+        for (const auto& [reg, count] : lt.waitingForVectorRegisterFetch) {
+            totalWaitingForVectorRegisters += count;
+        }
+        if (totalWaitingForVectorRegisters != 0) {
+            os << "      Average vector register fetch stalls: " << static_cast<double>(totalWaitingForVectorRegisters) / totalCount << " ticks\n";
+        }
+
         std::size_t totalWaitingForMemory = 0;
         for (const auto& [address, count] : lt.waitingForMemoryRead) {
             totalWaitingForMemory += count;
@@ -150,24 +911,43 @@ namespace tiny::t86 {
             os << "      Average memory read stalls: " << static_cast<double>(totalWaitingForMemory) / totalCount << " ticks\n";
         }
 
+        if (lt.waitingForSerialization != 0) {
+            os << "    Average waiting for serialization: " << static_cast<double>(lt.waitingForSerialization) / totalCount << " ticks\n";
+        }
         os << "    Average waiting for ALU: " << static_cast<double>(lt.waitingForAlu) / totalCount << " ticks\n"
            << "    Average executing: " << static_cast<double>(lt.executing) / totalCount << " ticks\n"
            << "    Average waiting for retirement: " << static_cast<double>(lt.waitingForRetirement) / totalCount << " ticks\n"
            << "    Average retirement: " << static_cast<double>(lt.retirement) / totalCount << " ticks\n";
     }
 
-    std::size_t StatsLogger::registerNewInstruction(std::size_t pc, const Instruction* instruction) {
+    std::size_t StatsLogger::registerNewInstruction(std::size_t pc, const Instruction* instruction, std::size_t thread) {
         instructions_.emplace(id_, std::make_pair(pc, instruction));
+        instructionThreads_.push_back(thread);
         return id_++;
     }
 
     void StatsLogger::logClearSpeculation(std::size_t id) {
-        instructions_.erase(id);
+        currentTick().clearedSpeculationEntries.push_back(id);
+        if (auto it = instructions_.find(id); it != instructions_.end()) {
+            squashedInstructions_.insert(*it);
+            instructions_.erase(it);
+        }
+    }
+
+    void StatsLogger::logMispredict(std::size_t id) {
+        currentTick().mispredictedRSEntries.push_back(id);
+    }
+
+    void StatsLogger::logThreadHalt(std::size_t thread) {
+        threadHalts_[thread] = ticks_.size();
     }
 
     StatsLogger::InstructionLifeTime StatsLogger::getInstructionLifeTime(std::size_t id) {
         InstructionLifeTime lifeTime;
         auto it = ticks_.cbegin();
+        if (auto fetchTick = fetchTicks_.find(id); fetchTick != fetchTicks_.end()) {
+            it += fetchTick->second;
+        }
         // Skip to where the instruction appears for the first time
         while(it != ticks_.end() && it->instructionFetchPc != id) {
             ++it;
@@ -177,7 +957,7 @@ namespace tiny::t86 {
             ++lifeTime.fetch;
             ++it;
         }
-        while(it != ticks_.end() && it->instructionDecodePc == id) {
+        while(it != ticks_.end() && std::find(it->instructionDecodePcs.begin(), it->instructionDecodePcs.end(), id) != it->instructionDecodePcs.end()) {
             ++lifeTime.decode;
             ++it;
         }
@@ -198,6 +978,11 @@ namespace tiny::t86 {
                     ++lifeTime.waitingForFloatRegisterFetch[fReg];
                 }
             }
+            if (auto vrsIt = it->stallVectorRegisterFetchRSEntries.find(id); vrsIt != it->stallVectorRegisterFetchRSEntries.end()) {
+                for (VectorRegister vReg : vrsIt->second) {
+                    ++lifeTime.waitingForVectorRegisterFetch[vReg];
+                }
+            }
             if (auto memIt = it->stallRAMReadRSEntries.find(id); memIt != it->stallRAMReadRSEntries.end()) {
                 for (std::size_t address : memIt->second) {
                     ++lifeTime.waitingForMemoryRead[address];
@@ -205,9 +990,15 @@ namespace tiny::t86 {
             }
             ++it;
         }
-        while(it != ticks_.end() &&
-              std::find(it->stallNoAluRSEntries.begin(), it->stallNoAluRSEntries.end(), id) != it->stallNoAluRSEntries.end()) {
-            ++lifeTime.waitingForAlu;
+        // Ready instruction can wait for serialization and for an ALU in any order
+        while(it != ticks_.end()) {
+            if (std::find(it->stallSerializationRSEntries.begin(), it->stallSerializationRSEntries.end(), id) != it->stallSerializationRSEntries.end()) {
+                ++lifeTime.waitingForSerialization;
+            } else if (std::find(it->stallNoAluRSEntries.begin(), it->stallNoAluRSEntries.end(), id) != it->stallNoAluRSEntries.end()) {
+                ++lifeTime.waitingForAlu;
+            } else {
+                break;
+            }
             ++it;
         }
         while(it != ticks_.end() && std::find(it->executingRSEntries.begin(), it->executingRSEntries.end(), id) != it->executingRSEntries.end()) {
@@ -1,30 +1,83 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <optional>
+#include <limits>
+#include <memory>
 
 #include "../cpu/register.h"
+#include "../cpu/instruction_cache.h"
+#include "../dram_timing.h"
 
 namespace tiny::t86 {
     // Forward declare instruction
     class Instruction;
 
+    class Program;
+
+    class ChromeTraceWriter;
+
+    // PipeViewWriter::Format, defined with the writer
+    enum class PipeViewFormat;
+
     class StatsLogger {
     public:
         static StatsLogger& instance();
 
+        // Cores of a System log separately, instance() returns the selected logger, nullptr selects the global one
+        static void select(StatsLogger* logger);
+
         // Resets all the stats, should be called before every new run
         void reset();
 
         void newTick();
 
-        std::size_t registerNewInstruction(std::size_t pc, const Instruction* instruction);
+        std::size_t registerNewInstruction(std::size_t pc, const Instruction* instruction, std::size_t thread = 0);
 
         void logInstructionFetch(std::size_t id);
 
-        void logInstructionDecode(std::size_t id);
+        // Stage 0 follows the fetch, rename stages are logged as decode ones
+        void logInstructionDecode(std::size_t stage, std::size_t id);
+
+        // An instruction can be dispatched in the next tick, from the last frontend stage or the loop buffer
+        void logDispatchReady();
+
+        // Only logged when the cpu has an instruction cache
+        void logInstructionCacheAccess(InstructionCache::Access access);
+
+        // Instruction went from the loop buffer straight to the reservation station
+        void logLoopBufferDelivery();
+
+        // RAM read started on behalf of an instruction
+        void logDemandRead();
+
+        void logPrefetchIssued();
+
+        // Read asked for prefetched address, timely if the prefetch has already finished
+        void logPrefetchUse(bool timely);
+
+        // Prefetched value dropped from the buffer before anyone asked for it
+        void logPrefetchEvicted();
+
+        // Instruction which read memory retired, only logged when the cpu predicts values
+        void logLoadRetirement(bool correctlyPredicted);
+
+        // Predicted value differed from the one read, the load is replayed
+        void logValueMispredict();
+
+        // DRAM bank started to serve a request
+        void logDramAccess(std::size_t bank, DramTiming::RowOutcome outcome, bool write);
+
+        // Request had to wait, because its bank was serving other one
+        void logDramBankConflict();
+
+        // Requests left waiting in DRAM queue at the end of the tick
+        void logDramQueued(std::size_t count);
 
         void logNoAluAvailable(std::size_t id);
 
@@ -35,12 +88,18 @@ namespace tiny::t86 {
 
         void logStallFloatRegisterFetch(std::size_t id, FloatRegister fReg);
 
+        void logStallVectorRegisterFetch(std::size_t id, VectorRegister vReg);
+
         // Waiting for RAM read
         void logStallRAMRead(std::size_t id, std::size_t address);
 
         // Waiting for previous instructions to be retired
         void logStallRetirement(std::size_t id);
 
+        // Serializing instruction has its operands, but waits until it is the oldest one with writes drained
+        // (and for atomics, until its cache line is held) before it executes
+        void logStallSerialization(std::size_t id);
+
         void logOperandFetching(std::size_t id);
 
         void logExecuting(std::size_t id);
@@ -49,15 +108,72 @@ namespace tiny::t86 {
 
         void logClearSpeculation(std::size_t id);
 
+        // Jump was resolved to a different destination than predicted
+        void logMispredict(std::size_t id);
+
+        // Hardware thread retired its HALT
+        void logThreadHalt(std::size_t thread);
+
         std::size_t tickCount() const;
 
+        // Instructions which were not squashed
+        std::size_t retiredCount() const {
+            return instructions_.size();
+        }
+
         void processBasicStats(std::ostream& os);
 
         void processDetailedStats(std::ostream& os);
 
+        // Classifies every tick (dispatch slot) as retiring, bad speculation, frontend or backend bound
+        void processTopDownStats(std::ostream& os);
+
+        // Statistics per static instruction (pc), hottest first, with source lines when the program has them
+        void processPcProfile(std::ostream& os, const Program* program = nullptr);
+
+        // Same as processPcProfile, as CSV
+        void processPcProfileCsv(std::ostream& os, const Program* program = nullptr);
+
+        // Flat and call graph profile of the functions (symbols) of the program run by hardware thread 0
+        void processFunctionProfile(std::ostream& os, const Program& program);
+
+        // Statistics of the program run by hardware thread 0 rolled up to its source lines, hottest first
+        void processLineProfile(std::ostream& os, const Program& program);
+
+        // Streams pipeline occupancy in Chrome trace-event format to os as the ticks are finished,
+        // should be called after reset and before the run, see ChromeTraceWriter
+        void startChromeTrace(std::ostream& os);
+
+        // Writes the last tick and closes the trace, os of startChromeTrace can be closed afterwards
+        void finishChromeTrace();
+
+        // Stage timelines for pipeline viewers, see PipeViewWriter
+        void processPipeView(std::ostream& os, PipeViewFormat format,
+                             std::size_t from = 0, std::size_t to = std::numeric_limits<std::size_t>::max());
+
+        struct InstructionInfo {
+            std::size_t pc;
+            const Instruction* instruction;
+            // Removed by logClearSpeculation
+            bool squashed;
+            // Hardware thread which fetched it
+            std::size_t thread;
+        };
+
+        // Works for both retired and squashed instructions
+        InstructionInfo instructionInfo(std::size_t id) const;
+
+        // What reservation station entry did during the tick
+        enum class Phase {
+            preparing, registerStall, memoryStall, waitingForSerialization, waitingForAlu, executing, waitingForRetirement
+        };
+
+        static const char* phaseName(Phase phase);
+
         struct TickStats {
             std::optional<std::size_t> instructionFetchPc;
-            std::optional<std::size_t> instructionDecodePc;
+            // Indexed by stage, empty stages are nullopt
+            std::vector<std::optional<std::size_t>> instructionDecodePcs;
             std::vector<std::size_t> activeRSEntries;
 
             std::vector<std::size_t> operandFetchingRSEntries;
@@ -65,6 +181,9 @@ namespace tiny::t86 {
             std::map<std::size_t, std::set<std::size_t>> stallRAMReadRSEntries;
             std::map<std::size_t, std::set<Register>> stallRegisterFetchRSEntries;
             std::map<std::size_t, std::set<FloatRegister>> stallFloatRegisterFetchRSEntries;
+            std::map<std::size_t, std::set<VectorRegister>> stallVectorRegisterFetchRSEntries;
+
+            std::vector<std::size_t> stallSerializationRSEntries;
 
             std::vector<std::size_t> stallNoAluRSEntries;
 
@@ -72,6 +191,23 @@ namespace tiny::t86 {
 
             std::vector<std::size_t> stallRetirementRSEntries;
             std::vector<std::size_t> retiredRSEntries;
+
+            std::vector<std::size_t> mispredictedRSEntries;
+
+            // Instructions thrown away from any stage of the pipeline
+            std::vector<std::size_t> clearedSpeculationEntries;
+
+            std::optional<InstructionCache::Access> instructionCacheAccess;
+
+            bool dispatchReady{false};
+
+            bool fetchStalled() const {
+                return instructionCacheAccess && !InstructionCache::ready(*instructionCacheAccess);
+            }
+
+            // Entries log more states in one tick (e.g. preparing and stall), the most specific one is kept.
+            // Retired entries are not included, they left the reservation station at the start of the tick
+            std::map<std::size_t, Phase> reservationStationPhases() const;
         };
 
     protected:
@@ -84,16 +220,23 @@ namespace tiny::t86 {
             std::size_t fetchingStalls{0};
             std::map<Register, std::size_t> waitingForRegisterFetch;
             std::map<FloatRegister, std::size_t> waitingForFloatRegisterFetch;
+            std::map<VectorRegister, std::size_t> waitingForVectorRegisterFetch;
             std::map<std::size_t, std::size_t> waitingForMemoryRead;
+            std::size_t waitingForSerialization{0};
             std::size_t waitingForAlu{0};
             std::size_t executing{0};
             std::size_t waitingForRetirement{0};
             std::size_t retirement{0}; // Every retirement will take only one cycle, so this is excess for now, but maybe in future?
 
             std::size_t totalTime() const {
-                return fetch + decode + preparing + waitingForAlu + executing + waitingForRetirement + retirement;
+                return fetch + decode + preparing + waitingForSerialization + waitingForAlu + executing + waitingForRetirement
+                       + retirement;
             }
 
+            std::size_t registerStalls() const;
+
+            std::size_t memoryStalls() const;
+
             InstructionLifeTime& operator += (const InstructionLifeTime& other) {
                 fetch += other.fetch;
                 decode += other.decode;
@@ -105,9 +248,13 @@ namespace tiny::t86 {
                 for (const auto& [reg, count] : other.waitingForFloatRegisterFetch) {
                     waitingForFloatRegisterFetch[reg] += count;
                 }
+                for (const auto& [reg, count] : other.waitingForVectorRegisterFetch) {
+                    waitingForVectorRegisterFetch[reg] += count;
+                }
                 for (const auto& [address, count] : other.waitingForMemoryRead) {
                     waitingForMemoryRead[address] += count;
                 }
+                waitingForSerialization += other.waitingForSerialization;
                 waitingForAlu += other.waitingForAlu;
                 executing += other.executing;
                 waitingForRetirement += other.waitingForRetirement;
@@ -118,16 +265,189 @@ namespace tiny::t86 {
 
         InstructionLifeTime getInstructionLifeTime(std::size_t id);
 
+        struct PcProfile {
+            std::size_t pc;
+            const Instruction* instruction;
+            std::size_t retired{0};
+            std::size_t mispredicts{0};
+            InstructionLifeTime lifeTime{};
+
+            std::size_t registerStalls() const {
+                return lifeTime.registerStalls();
+            }
+
+            std::size_t memoryStalls() const {
+                return lifeTime.memoryStalls();
+            }
+        };
+
+        struct TopDown {
+            std::size_t retiring{0};
+            std::size_t badSpeculation{0};
+            // Part of badSpeculation spent refilling the frontend after a flush
+            std::size_t badSpeculationRefill{0};
+            // Flushes of the pipeline (mispredicts, value replays, ...)
+            std::size_t redirects{0};
+            std::size_t frontendBound{0};
+            // Part of frontendBound caused by instruction cache misses
+            std::size_t frontendInstructionCacheBound{0};
+            std::size_t backendMemoryBound{0};
+            std::size_t backendAluBound{0};
+            std::size_t backendDependencyBound{0};
+            // Waiting for execution to finish or for in order retirement
+            std::size_t backendCoreBound{0};
+
+            std::size_t backendBound() const {
+                return backendMemoryBound + backendAluBound + backendDependencyBound + backendCoreBound;
+            }
+        };
+
+        TopDown getTopDown() const;
+
+        // Sorted by total time spent in pipeline, descending
+        std::vector<PcProfile> getPcProfiles();
+
+        struct FunctionProfile {
+            std::string name;
+            std::size_t calls{0};
+            // Ticks are split among retired instructions, each gets the ticks since the previous retirement
+            std::size_t selfTicks{0};
+            // Self and everything called from the function, recursion is counted once
+            std::size_t inclusiveTicks{0};
+            std::size_t selfRetired{0};
+            std::size_t inclusiveRetired{0};
+            std::size_t registerStalls{0};
+            std::size_t memoryStalls{0};
+            std::size_t mispredicts{0};
+        };
+
+        struct CallEdge {
+            std::size_t calls{0};
+            // Inclusive ticks of the callee while called from the caller
+            std::size_t ticks{0};
+        };
+
+        struct FunctionProfiles {
+            // Indexed as the symbols of the program, code outside of them is the last one
+            std::vector<FunctionProfile> functions;
+            // By (caller, callee)
+            std::map<std::pair<std::size_t, std::size_t>, CallEdge> edges;
+        };
+
+        // Follows the calls and returns of the retired instructions of thread 0 on a shadow call stack
+        FunctionProfiles getFunctionProfiles(const Program& program);
+
+        struct LineProfile {
+            // 0 for instructions without a source line
+            std::size_t line;
+            // Symbols the instructions of the line are in, more of them when the line was inlined
+            std::set<std::string> functions{};
+            std::size_t retired{0};
+            // Ticks charged as in the function profile
+            std::size_t ticks{0};
+            // Ticks summed over the lifetimes, as in the pc profile
+            std::size_t pipelineTicks{0};
+            std::size_t registerStalls{0};
+            std::size_t memoryStalls{0};
+            std::size_t mispredicts{0};
+        };
+
+        // Sorted by charged ticks, descending
+        std::vector<LineProfile> getLineProfiles(const Program& program);
+
+        // Retired instructions of thread 0 by id (the retirement order), each with the ticks since the previous retirement
+        std::map<std::size_t, std::size_t> getChargedTicks() const;
+
+        // Ids of jumps which mispredicted and were not squashed themselves
+        std::unordered_set<std::size_t> getMispredicted() const;
+
         static void processAverageLifetime(std::ostream& os, const InstructionLifeTime& lt, std::size_t totalCount);
 
-        StatsLogger() = default;
+        // Prints nothing when the cpu has no instruction cache
+        void processInstructionCacheStats(std::ostream& os);
+
+        // Prints nothing when the loop buffer delivered nothing
+        void processLoopBufferStats(std::ostream& os);
+
+        // Prints nothing when no prefetch was issued
+        void processPrefetchStats(std::ostream& os);
+
+        // Prints nothing when the cpu does not predict values
+        void processValuePredictionStats(std::ostream& os);
+
+        // Prints nothing without DRAM timing
+        void processDramStats(std::ostream& os);
+
+        // Prints nothing when only one hardware thread fetched
+        void processThreadStats(std::ostream& os);
+
+        friend class System;
+
+        StatsLogger();
+
+    public:
+        ~StatsLogger();
+
+    protected:
+
+        static StatsLogger* selected_;
 
         std::vector<TickStats> ticks_;
 
+        // Set between startChromeTrace and finishChromeTrace
+        std::unique_ptr<ChromeTraceWriter> chromeTrace_;
+
         // Each instruction gets its id
         std::size_t id_{0};
 
         // Some ids might be missing, as wrongly speculated ones will be removed
         std::unordered_map<std::size_t, std::pair<std::size_t, const Instruction*>> instructions_;
+
+        // Wrongly speculated instructions removed from instructions_
+        std::unordered_map<std::size_t, std::pair<std::size_t, const Instruction*>> squashedInstructions_;
+
+        struct PrefetchStats {
+            std::size_t demandReads{0};
+            std::size_t issued{0};
+            std::size_t timely{0};
+            std::size_t late{0};
+            std::size_t evicted{0};
+        };
+
+        PrefetchStats prefetchStats_;
+
+        std::size_t loopBufferDeliveries_{0};
+
+        struct ValuePredictionStats {
+            std::size_t loads{0};
+            std::size_t correct{0};
+            std::size_t wrong{0};
+        };
+
+        ValuePredictionStats valuePredictionStats_;
+
+        struct DramStats {
+            std::size_t reads{0};
+            std::size_t writes{0};
+            std::size_t rowHits{0};
+            std::size_t rowEmpty{0};
+            std::size_t rowConflicts{0};
+            std::size_t bankConflicts{0};
+            // Sum of requests waiting in the queue over all ticks
+            std::size_t queuedTicks{0};
+            std::vector<std::size_t> bankAccesses;
+            std::vector<std::size_t> bankRowHits;
+        };
+
+        DramStats dramStats_;
+
+        // Hardware thread of each instruction, indexed by id
+        std::vector<std::size_t> instructionThreads_;
+
+        // Tick in which the thread halted, by thread
+        std::map<std::size_t, std::size_t> threadHalts_;
+
+        // Tick in which the instruction was fetched for the first time, lifetimes are looked up from there
+        std::unordered_map<std::size_t, std::size_t> fetchTicks_;
     };
 }
@@ -22,7 +22,7 @@ namespace tinyc
         Load_Imm_i * ptr = new Load_Imm_i();
         ptr->m_value = ast->value;
         ptr->m_type = ResultType::Integer;
-        m_block->m_block.push_back(ptr);
+        AddInstruction(ptr);
         m_last = ptr;
     }
     
@@ -31,7 +31,7 @@ namespace tinyc
         Load_Imm_d * ptr = new Load_Imm_d();
         ptr->m_value = ast->value;
         ptr->m_type = ResultType::Double;
-        m_block->m_block.push_back(ptr);
+        AddInstruction(ptr);
         m_last = ptr;
     }
     
@@ -40,7 +40,7 @@ namespace tinyc
         Load_Imm_c * ptr = new Load_Imm_c();
         ptr->m_value = ast->value;
         ptr->m_type = ResultType::Char;
-        m_block->m_block.push_back(ptr);
+        AddInstruction(ptr);
         m_last = ptr;
     }
     
@@ -64,7 +64,7 @@ namespace tinyc
     void ASTtoIR::NewBlock()
     {
         if (m_block->m_block.empty())
-            m_block->m_block.push_back(new NOP());
+            AddInstruction(new NOP());
         m_fun->m_blocks.push_back(m_block);
         m_block = new Block();
     }
@@ -77,7 +77,7 @@ namespace tinyc
             Load * ptr = new Load();
             ptr->m_address = m_last;
             ptr->m_type = GetType(ast->type());
-            m_block->m_block.push_back(ptr);
+            AddInstruction(ptr);
             m_last = ptr;
         }
     }
@@ -127,12 +127,43 @@ namespace tinyc
         }
         m_last = allocation;
 
-        allocation->m_type = GetType(ast->type());
+        ResultType type = GetType(ast->type());
+        int64_t size = 1;
+        if (ASTArrayType * array = dynamic_cast<ASTArrayType*>(ast->varType.get()))
+        {
+            type = GetType(array->base->type());
+            size = array->size;
+        }
+        allocation->m_type = type;
+        if (Alloc_g * global = dynamic_cast<Alloc_g*>(allocation))
+        {
+            global->m_type = type;
+            global->m_size = size;
+        }
+        else if (Alloc_l * local = dynamic_cast<Alloc_l*>(allocation))
+        {
+            local->m_type = type;
+            local->m_size = size;
+        }
 
         m_env->AddVar(ast->name->name,allocation);
 
         if (ast->value == nullptr)
             m_last = allocation;
+        else if (ASTArrayValue * values = dynamic_cast<ASTArrayValue*>(ast->value.get()))
+        {
+            for (int i = 0; i < values->values.size(); i++)
+            {
+                visitChild(values->values[i]);
+                Instruction * value = AssignCast(type,m_last->m_type,m_last);
+                Store * store = new Store();
+                store->m_type = ResultType::Void;
+                store->m_address = ElementAddress(allocation,i);
+                store->m_value = value;
+                AddInstruction(store);
+            }
+            m_last = allocation;
+        }
         else
         {
             visitChild(ast->value);
@@ -140,7 +171,7 @@ namespace tinyc
             store->m_type = ResultType::Void;
             store->m_address = allocation;
             store->m_value = m_last;
-            m_block->m_block.push_back(store);
+            AddInstruction(store);
         }
     }
     
@@ -152,6 +183,7 @@ namespace tinyc
         m_block->m_block.clear();
 
         Function * fun = new Function(ast->name.name());
+        fun->m_line = ast->location().line();
         Block * prev = m_block;
         m_block = new Block();
         
@@ -174,7 +206,7 @@ namespace tinyc
         visitChild(ast->body);
 
         if (m_block->m_block.empty())
-            m_block->m_block.push_back(new NOP());
+            AddInstruction(new NOP());
         fun->m_blocks.push_back(m_block);
         m_block = prev;
 
@@ -208,10 +240,10 @@ namespace tinyc
                 Load_Imm_i * ptr = new Load_Imm_i();
                 ptr->m_value = 0;
                 ptr->m_type = ResultType::Integer;
-                m_block->m_block.push_back(ptr);
+                AddInstruction(ptr);
                 NEq * cmp = new NEq(m_last,ptr,ResultType::Integer);
                 cmp->SetCmpJump(true);
-                m_block->m_block.push_back(cmp);
+                AddInstruction(cmp);
                 m_last = cmp;
             }
         }
@@ -225,14 +257,14 @@ namespace tinyc
 
         Jump_cond * cond_jump = new Jump_cond();
         cond_jump->m_cond = m_last;
-        m_block->m_block.push_back(cond_jump);
+        AddInstruction(cond_jump);
 
         NewBlock();
 
         cond_jump->m_true = m_block;
         visitChild(ast->trueCase);
         Jump * jump_true = new Jump();
-        m_block->m_block.push_back(jump_true);
+        AddInstruction(jump_true);
 
         NewBlock();
 
@@ -240,7 +272,7 @@ namespace tinyc
         if (ast->falseCase != nullptr){
             visitChild(ast->falseCase);
             Jump * jump_false = new Jump();
-            m_block->m_block.push_back(jump_false);
+            AddInstruction(jump_false);
             NewBlock();
             jump_false->m_label = m_block;
         }
@@ -253,10 +285,10 @@ namespace tinyc
         Load_Imm_i * ptr = new Load_Imm_i();
         ptr->m_value = val;
         ptr->m_type = ResultType::Integer;
-        m_block->m_block.push_back(ptr);
+        AddInstruction(ptr);
         Eq * cmp = new Eq(m_last,ptr,ResultType::Integer);
         cmp->SetCmpJump(true);
-        m_block->m_block.push_back(cmp);
+        AddInstruction(cmp);
         m_last = cmp;
     }
 
@@ -271,7 +303,7 @@ namespace tinyc
         store->m_type = ResultType::Void;
         store->m_address = allocation;
         store->m_value = m_last;
-        m_block->m_block.push_back(store);
+        AddInstruction(store);
 
         Jump * jump = new Jump();
         Jump * defaultJ = new Jump();
@@ -282,36 +314,36 @@ namespace tinyc
             Load * load = new Load();
             load->m_address = allocation;
             load->m_type = allocation->m_type;
-            m_block->m_block.push_back(load);
+            AddInstruction(load);
             m_last = load;
             SwitchCond(x.first);
             Jump_cond * j = new Jump_cond();
             j->m_cond = m_last;
-            m_block->m_block.push_back(j);
+            AddInstruction(j);
             m_jumps.push_back(j);
             NewBlock();
             j->m_false = m_block;
         }
         if (ast->defaultCase != nullptr)
         {
-            m_block->m_block.push_back(defaultJ);
+            AddInstruction(defaultJ);
         }
         else
-            m_block->m_block.push_back(jump);
+            AddInstruction(jump);
 
         NewBlock();
 
         for (int i = 0; i < ast->cases.size(); i++)
         {
             visitChild(ast->cases[i].second);
-            m_block->m_block.push_back(jump);
+            AddInstruction(jump);
             m_jumps[i]->m_true = m_block;
             NewBlock();
         }
         if (ast->defaultCase != nullptr)
         {
             visitChild(ast->defaultCase);
-            m_block->m_block.push_back(jump);
+            AddInstruction(jump);
             defaultJ->m_label = m_block;
             NewBlock();
         }
@@ -340,7 +372,7 @@ namespace tinyc
         AddJumpsContinueBreak();
 
         Jump * jump = new Jump();
-        m_block->m_block.push_back(jump);
+        AddInstruction(jump);
 
         NewBlock();
 
@@ -351,13 +383,13 @@ namespace tinyc
 
         Jump_cond * jump_cond = new Jump_cond();
         jump_cond->m_cond = m_last;
-        m_block->m_block.push_back(jump_cond);
+        AddInstruction(jump_cond);
         
         NewBlock();
 
         jump_cond->m_true = m_block;
         visitChild(ast->body);
-        m_block->m_block.push_back(jump);
+        AddInstruction(jump);
 
         NewBlock();
         
@@ -377,7 +409,7 @@ namespace tinyc
         jump_cond->m_true = m_block;
         visitChild(ast->body);
         Jump * jump = new Jump();
-        m_block->m_block.push_back(jump);
+        AddInstruction(jump);
 
         NewBlock();
 
@@ -387,7 +419,7 @@ namespace tinyc
         ConditionAdjust();
 
         jump_cond->m_cond = m_last;
-        m_block->m_block.push_back(jump_cond);
+        AddInstruction(jump_cond);
 
         NewBlock();
 
@@ -404,7 +436,7 @@ namespace tinyc
         if (ast->init != nullptr)
             visitChild(ast->init);
         Jump * jump1 = new Jump();
-        m_block->m_block.push_back(jump1);
+        AddInstruction(jump1);
 
         NewBlock();
 
@@ -416,44 +448,47 @@ namespace tinyc
             Load_Imm_i * load = new Load_Imm_i();
             load->m_type = ResultType::Integer;
             load->m_value = 1;
-            m_block->m_block.push_back(load);
+            AddInstruction(load);
             m_last = load;
         }
 
         ConditionAdjust();
 
         cond_jump->m_cond = m_last;
-        m_block->m_block.push_back(cond_jump);
+        AddInstruction(cond_jump);
 
         NewBlock();
 
         cond_jump->m_true = m_block;
         visitChild(ast->body);
         Jump * jump2 = new Jump();
-        m_block->m_block.push_back(jump2);
+        AddInstruction(jump2);
 
         NewBlock();
 
         jump2->m_label = m_block;
         if (ast->increment != nullptr)
             visitChild(ast->increment);
-        m_block->m_block.push_back(jump1);
+        AddInstruction(jump1);
 
         NewBlock();
 
         cond_jump->m_false = m_block;
 
+        m_fun->m_loops.push_back(ForLoop{jump1->m_label, cond_jump->m_true, jump2->m_label, m_block,
+                                         static_cast<int>(ast->location().line())});
+
         RemJumpsContinueBreak(jump2->m_label,m_block);
     }
     
     void ASTtoIR::visit(ASTBreak * ast)
     {
-        m_block->m_block.push_back(m_break.back());
+        AddInstruction(m_break.back());
     }
     
     void ASTtoIR::visit(ASTContinue * ast)
     {
-        m_block->m_block.push_back(m_continue.back());
+        AddInstruction(m_continue.back());
     }
     
     void ASTtoIR::visit(ASTReturn * ast)
@@ -468,7 +503,7 @@ namespace tinyc
         {
             ret->m_res = nullptr;
         }
-        m_block->m_block.push_back(ret);
+        AddInstruction(ret);
     }
     
     Instruction * ASTtoIR::AssignCast(ResultType left, ResultType right, Instruction * ins)
@@ -480,13 +515,13 @@ namespace tinyc
                 if (right == ResultType::Char)
                 {
                     Castctoi * cast = new Castctoi(ins);
-                    m_block->m_block.push_back(cast);
+                    AddInstruction(cast);
                     return cast;
                 }
                 else if (right == ResultType::Double)
                 {
                     Castdtoi * cast = new Castdtoi(ins);
-                    m_block->m_block.push_back(cast);
+                    AddInstruction(cast);
                     return cast;
                 }
             }
@@ -495,13 +530,13 @@ namespace tinyc
                 if (right == ResultType::Integer)
                 {
                     Castitod * cast = new Castitod(ins);
-                    m_block->m_block.push_back(cast);
+                    AddInstruction(cast);
                     return cast;
                 }
                 else if (right == ResultType::Char)
                 {
                     Castctod * cast = new Castctod(ins);
-                    m_block->m_block.push_back(cast);
+                    AddInstruction(cast);
                     return cast;
                 }
             }
@@ -525,7 +560,7 @@ namespace tinyc
 
         store->m_value = AssignCast(store->m_type,store->m_value->m_type,store->m_value);
 
-        m_block->m_block.push_back(store);
+        AddInstruction(store);
     }
 
     void ASTtoIR::visit(ASTBinaryOp * ast)
@@ -592,7 +627,7 @@ namespace tinyc
         else if (ast->op == Symbol::Or)
             m_last = new Or(left,right,t);
 
-        m_block->m_block.push_back(m_last);
+        AddInstruction(m_last);
 
     }
     
@@ -616,7 +651,7 @@ namespace tinyc
         else if (ast->op == Symbol::Neg)
             m_last = new Neg(m_last,t);
 
-        m_block->m_block.push_back(m_last);
+        AddInstruction(m_last);
 
         if (ast->op == Symbol::Dec || ast->op == Symbol::Inc)
         {
@@ -628,7 +663,7 @@ namespace tinyc
 
             store->m_address = m_last;
 
-            m_block->m_block.push_back(store);
+            AddInstruction(store);
         }
     }
     
@@ -645,7 +680,7 @@ namespace tinyc
         else if (ast->op == Symbol::Dec)
             m_last = new Dec(m_last,t);
 
-        m_block->m_block.push_back(m_last);
+        AddInstruction(m_last);
 
         store->m_value = m_last;
 
@@ -658,7 +693,7 @@ namespace tinyc
 
         store->m_address = m_last;
 
-        m_block->m_block.push_back(store);
+        AddInstruction(store);
 
         m_last = ins;
     }
@@ -673,7 +708,7 @@ namespace tinyc
         {
             LoadFun * ptr = new LoadFun();
             ptr->m_address = addr;
-            m_block->m_block.push_back(ptr);
+            AddInstruction(ptr);
             m_last = ptr;
             return;
         }
@@ -681,7 +716,7 @@ namespace tinyc
         LoadAddress * ptr = new LoadAddress();
         ptr->m_address = m_last;
         ptr->m_type = GetType(ast->type());
-        m_block->m_block.push_back(ptr);
+        AddInstruction(ptr);
         m_last = ptr;
         
     }
@@ -698,14 +733,53 @@ namespace tinyc
             LoadDeref * ptr = new LoadDeref();
             ptr->m_address = m_last;
             ptr->m_type = GetType(ast->type());
-            m_block->m_block.push_back(ptr);
+            AddInstruction(ptr);
             m_last = ptr;
         }
     }
     
+    Instruction * ASTtoIR::ElementAddress(Instruction * array, int64_t index)
+    {
+        LoadAddress * address = new LoadAddress();
+        address->m_address = array;
+        address->m_type = ResultType::Integer;
+        AddInstruction(address);
+        Load_Imm_i * offset = new Load_Imm_i();
+        offset->m_value = index;
+        offset->m_type = ResultType::Integer;
+        AddInstruction(offset);
+        Add * element = new Add(address,offset,ResultType::Integer);
+        AddInstruction(element);
+        return element;
+    }
+
     void ASTtoIR::visit(ASTIndex * ast)
     {
-        //TODO
+        // Element address is the address of the array plus the index, words are the smallest unit
+        bool leftValue = m_leftValue;
+        m_leftValue = true;
+        visitChild(ast->base);
+        m_leftValue = false;
+
+        LoadAddress * address = new LoadAddress();
+        address->m_address = m_last;
+        address->m_type = ResultType::Integer;
+        AddInstruction(address);
+
+        visitChild(ast->index);
+        Add * element = new Add(address,m_last,ResultType::Integer);
+        AddInstruction(element);
+        m_last = element;
+
+        if (!leftValue)
+        {
+            LoadDeref * ptr = new LoadDeref();
+            ptr->m_address = element;
+            ptr->m_type = GetType(ast->type());
+            AddInstruction(ptr);
+            m_last = ptr;
+        }
+        m_leftValue = leftValue;
     }
     
     void ASTtoIR::visit(ASTMember * ast)
@@ -731,14 +805,14 @@ namespace tinyc
         BorderCall * start = new BorderCall();
         start->m_start = true;
         start->m_call = call;
-        m_block->m_block.push_back(start);
+        AddInstruction(start);
 
         for (auto & x : ast->args)
         {
             visitChild(x);
             StoreParam * arg = new StoreParam();
             arg->m_address = m_last;
-            m_block->m_block.push_back(arg);
+            AddInstruction(arg);
             if (Call * c = dynamic_cast<Call*>(call))
                 c->m_args.push_back(m_last);
             if (CallStatic * c = dynamic_cast<CallStatic*>(call))
@@ -754,12 +828,12 @@ namespace tinyc
         if (CallStatic * c = dynamic_cast<CallStatic*>(call))
             c->m_fun_addr = dynamic_cast<Fun_address*>(m_last);
 
-        m_block->m_block.push_back(call);
+        AddInstruction(call);
         m_last = call;
         BorderCall * end = new BorderCall();
         end->m_start = false;
         end->m_call = call;
-        m_block->m_block.push_back(end);
+        AddInstruction(end);
     }
     
     void ASTtoIR::visit(ASTCast * ast)
@@ -772,7 +846,7 @@ namespace tinyc
             m_last = new Castdtoi(m_last);
         else if (t == ResultType::Double && m_last->m_type == ResultType::Integer)
             m_last = new Castitod(m_last);
-        m_block->m_block.push_back(m_last);
+        AddInstruction(m_last);
         
     }
     
@@ -785,13 +859,53 @@ namespace tinyc
     {
         visitChild(ast->value);
         DebugWrite * write = new DebugWrite(m_last);
-        m_block->m_block.push_back(write);
+        AddInstruction(write);
         m_last = write;
     }
     
+    void ASTtoIR::visit(ASTBuiltin * ast)
+    {
+        Intrinsic * intrinsic = nullptr;
+        switch (ast->kind) {
+            case ASTBuiltin::Kind::coreId:
+                intrinsic = new Intrinsic(Intrinsic::Kind::CoreId);
+                break;
+            case ASTBuiltin::Kind::fence:
+                intrinsic = new Intrinsic(Intrinsic::Kind::Fence);
+                break;
+            case ASTBuiltin::Kind::atomicAdd:
+                intrinsic = new Intrinsic(Intrinsic::Kind::AtomicAdd);
+                visitChild(ast->args[1]);
+                intrinsic->m_val = m_last;
+
+                m_leftValue = true;
+                visitChild(ast->args[0]);
+                m_leftValue = false;
+
+                intrinsic->m_address = m_last;
+                break;
+            case ASTBuiltin::Kind::rdpmc:
+                intrinsic = new Intrinsic(Intrinsic::Kind::PerfCounter);
+                intrinsic->m_counter = static_cast<ASTInteger*>(ast->args[0].get())->value;
+                break;
+        }
+        AddInstruction(intrinsic);
+        m_last = intrinsic;
+    }
+
     void ASTtoIR::visitChild(AST * ast)
     {
+        int line = m_line;
+        m_line = ast->location().line();
         ASTVisitor::visitChild(ast);
+        m_line = line;
+    }
+
+    void ASTtoIR::AddInstruction(Instruction * ins)
+    {
+        if (ins->m_line == 0)
+            ins->m_line = m_line;
+        m_block->m_block.push_back(ins);
     }
     
     template<typename T>
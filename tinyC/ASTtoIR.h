@@ -49,6 +49,7 @@ namespace tinyc {
             void visit(ASTCast * ast);
             void visit(ASTRead * ast);
             void visit(ASTWrite * ast);
+            void visit(ASTBuiltin * ast);
 
             void visitChild(AST * ast);
             template<typename T>
@@ -57,7 +58,10 @@ namespace tinyc {
         protected:
             ResultType GetType(Type * t);
             void NewBlock();
+            // Appends to the current block, attributed to the line of the innermost visited AST node
+            void AddInstruction(Instruction * ins);
             Instruction * AssignCast(ResultType left, ResultType right, Instruction * ins);
+            Instruction * ElementAddress(Instruction * array, int64_t index);
             void ConditionAdjust();
             void SwitchCond(int val);
             void AddJumpsContinueBreak();
@@ -78,5 +82,6 @@ namespace tinyc {
             std::vector<Jump*> m_continue;
             std::vector<Jump*> m_break;
             IRProgram * m_prg = nullptr;
+            int m_line = 0;
     };
 }
\ No newline at end of file
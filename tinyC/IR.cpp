@@ -3,13 +3,13 @@
 namespace tinyc
 {
     Instruction::Instruction()
-    :m_type(ResultType::Void)
+    :m_type(ResultType::Void), m_line(0)
     {
         
     }
 
     Instruction::Instruction(ResultType t)
-    :m_type(t)
+    :m_type(t), m_line(0)
     {
         
     }
@@ -44,7 +44,7 @@ namespace tinyc
     }
 
     Function::Function(const std::string & name)
-    :m_name(name)
+    :m_name(name), m_line(0)
     {
         
     }
@@ -245,5 +245,20 @@ namespace tinyc
     {
     }
 
+    Intrinsic::Intrinsic(Kind kind)
+    :Instruction(kind == Kind::Fence ? ResultType::Void : ResultType::Integer), m_kind(kind)
+    {
+    }
+
+    VectorOp::VectorOp(Kind kind, Instruction * left, Instruction * right, ResultType t)
+    :Instruction(t), m_kind(kind), m_left(left), m_right(right)
+    {
+    }
+
+    Select::Select(CmpOp * cond, Instruction * t, Instruction * f, ResultType type)
+    :Instruction(type), m_cond(cond), m_true(t), m_false(f)
+    {
+    }
+
  
 }
\ No newline at end of file
@@ -23,8 +23,9 @@ namespace tinyc {
             Instruction();
             Instruction(ResultType t);
             ResultType m_type;
-            char m_memType; // 'r' - register, 's' - stack, 'm' - memory, 'x  - spill, 'i' - integer;
+            char m_memType; // 'r' - register, 's' - stack, 'm' - memory, 'x  - spill, 'i' - integer, 'v' - vector register;
             int64_t m_memVal;
+            int m_line; // line of the tinyC source, 0 when unknown; passes replacing an instruction copy it
         protected:
             friend class IRVisitor;
             virtual void accept(IRVisitor * v) = 0;
@@ -37,6 +38,16 @@ namespace tinyc {
             int m_name;
             inline static int counter;
     };
+    // Blocks of a for loop as ASTtoIR creates them, passes changing blocks may break the shape
+    class ForLoop {
+        public:
+            Block * m_header; // condition
+            Block * m_body;
+            Block * m_increment;
+            Block * m_exit;
+            int m_line;
+    };
+
     class Fun_address;
     class Function {
         public:
@@ -45,8 +56,10 @@ namespace tinyc {
             std::vector<Block*> m_blocks;
             std::vector<Alloc_arg*> m_args;
             std::vector<Alloc_l*> m_allocs;
+            std::vector<ForLoop> m_loops;
             ResultType m_res_type;
             Fun_address * m_addr;
+            int m_line; // prologue and epilogue are attributed to the declaration
     };
 
     class Fun_address : public Instruction {
@@ -100,6 +113,7 @@ namespace tinyc {
     class Alloc_g : public Instruction {
         public:
             ResultType m_type;
+            int64_t m_size = 1; // words, arrays take one per element
         protected:
             void accept(IRVisitor * v) override;
     };
@@ -107,6 +121,7 @@ namespace tinyc {
     class Alloc_l : public Instruction {
         public:
             ResultType m_type;
+            int64_t m_size = 1; // words, arrays take one per element
         protected:
             void accept(IRVisitor * v) override;
     };
@@ -427,6 +442,48 @@ namespace tinyc {
             void accept(IRVisitor * v) override;
     };
 
+    // Builtin of the target, m_address and m_val are used by AtomicAdd only, m_counter by PerfCounter
+    class Intrinsic : public Instruction {
+        public:
+            enum class Kind {
+                CoreId, Fence, AtomicAdd, PerfCounter
+            };
+            Intrinsic(Kind kind);
+            Kind m_kind;
+            Instruction * m_address = nullptr;
+            Instruction * m_val = nullptr;
+            int64_t m_counter = 0;
+        protected:
+            void accept(IRVisitor * v) override;
+    };
+
+    // Operation on VectorRegister::lanes consecutive elements, created by Vectorization
+    // m_type is the type of the elements, Load and Store have the address of the first element in m_left
+    class VectorOp : public Instruction {
+        public:
+            enum class Kind {
+                Load, Store, Broadcast, Add, Mul
+            };
+            VectorOp(Kind kind, Instruction * left, Instruction * right, ResultType t);
+            Kind m_kind;
+            Instruction * m_left;
+            Instruction * m_right; // stored vector for Store, nullptr for Load and Broadcast
+        protected:
+            void accept(IRVisitor * v) override;
+    };
+
+    // m_true when m_cond holds, otherwise m_false, created by IfConversion
+    // m_cond is not in any block, its operands are, the comparison is done by the select
+    class Select : public Instruction {
+        public:
+            Select(CmpOp * cond, Instruction * t, Instruction * f, ResultType type);
+            CmpOp * m_cond;
+            Instruction * m_true;
+            Instruction * m_false;
+        protected:
+            void accept(IRVisitor * v) override;
+    };
+
     class IRProgram {
         public:
             ~IRProgram();
@@ -484,6 +541,9 @@ namespace tinyc {
             virtual void visit(Castitod * ir) = 0;
             virtual void visit(Castdtoi * ir) = 0;
             virtual void visit(DebugWrite * ir) = 0;
+            virtual void visit(Intrinsic * ir) = 0;
+            virtual void visit(VectorOp * ir) = 0;
+            virtual void visit(Select * ir) = 0;
             virtual void visit(NOP * ir) = 0;
         protected:
             void visitChild(Instruction * child) {
@@ -541,5 +601,8 @@ namespace tinyc {
     inline void Castitod::accept(IRVisitor * v) { v->visit(this); }
     inline void Castdtoi::accept(IRVisitor * v) { v->visit(this); }
     inline void DebugWrite::accept(IRVisitor * v) { v->visit(this); }
+    inline void Intrinsic::accept(IRVisitor * v) { v->visit(this); }
+    inline void VectorOp::accept(IRVisitor * v) { v->visit(this); }
+    inline void Select::accept(IRVisitor * v) { v->visit(this); }
     inline void NOP::accept(IRVisitor * v) {v->visit(this); }
 }
\ No newline at end of file
@@ -3,13 +3,15 @@ namespace tinyc
 {
     using namespace tiny::t86;
 
-    IRTot86::IRTot86(int maxReg,int maxFreg)
+    IRTot86::IRTot86(int maxReg,int maxFreg,int maxVreg)
     :m_max_regs(maxReg), m_last_label(Label::empty()), m_jump_label(Label::empty())
     {
         for (int i = 0; i < maxReg; i++)
             m_regs.insert(i);
         for (int i = 0; i < maxFreg; i++)
             m_fregs.insert(i);
+        for (int i = 0; i < maxVreg; i++)
+            m_vregs.insert(i);
     }
     
     void IRTot86::visit(Fun_address * ir)
@@ -66,13 +68,16 @@ namespace tinyc
     void IRTot86::visit(Alloc_g * ir)
     {
         ir->m_memType = 'm';
-        ir->m_memVal = m_global_counter++;
+        ir->m_memVal = m_global_counter;
+        m_global_counter += ir->m_size;
     }
     
     void IRTot86::visit(Alloc_l * ir)
     {
+        // Array elements go up from the lowest address of the allocation
+        m_alloc_counter += ir->m_size;
         ir->m_memType = 's';
-        ir->m_memVal = ++m_alloc_counter;
+        ir->m_memVal = m_alloc_counter;
     }
     
     void IRTot86::visit(Alloc_arg * ir)
@@ -89,7 +94,7 @@ namespace tinyc
             {
                 int regNum = NextFReg();
                 int regN = NextReg();
-                m_pb.add(MOV{Reg(regN),Mem(Bp() - ir->m_address->m_memVal)});
+                m_last_label = m_pb.add(MOV{Reg(regN),Mem(Bp() - ir->m_address->m_memVal)});
                 m_pb.add(MOV{FReg(regNum),Reg(regN)});
                 m_regs.insert(regN);
                 ir->m_memType = 'r';
@@ -811,6 +816,8 @@ namespace tinyc
             m_pb.add(RET{});
         else
             m_pb.add(HALT{});
+        m_pb.addSymbol(fun->m_name, f, m_pb.size());
+        m_pb.addLines(f, m_pb.size(), fun->m_line);
 
         PatchLabels();        
     }
@@ -819,7 +826,9 @@ namespace tinyc
     {
         bool first = true;
         for (auto & x : block->m_block){
+            size_t begin = m_pb.size();
             IRVisitor::visitChild(x);
+            m_pb.addLines(begin, m_pb.size(), x->m_line);
             if (first)
             {
                 AddLabel(block);
@@ -843,8 +852,11 @@ namespace tinyc
 
         Label global = m_pb.add(tiny::t86::NOP{});
         m_pb.patch(start,global);
-        for (auto & x : prg->m_decls)
+        for (auto & x : prg->m_decls){
+            size_t begin = m_pb.size();
             IRVisitor::visitChild(x);
+            m_pb.addLines(begin, m_pb.size(), x->m_line);
+        }
 
         start = m_pb.add(JMP{Label::empty()});
         auto it = m_funs.find("main");
@@ -858,19 +870,142 @@ namespace tinyc
         {
             InsertToReg(ir->m_val);
             m_last_label = m_pb.add(MOV{Reg(0),Reg(ir->m_val->m_memVal)});
-            m_pb.add(DBG{ [](const Cpu & cpu){std::cout << cpu.getRegister(Reg(0)) << std::endl;}});
+            m_pb.add(DBG{Reg(0)});
             m_regs.insert(ir->m_val->m_memVal);
         }
         else if (ir->m_val->m_type == ResultType::Double)
         {
             InsertToFReg(ir->m_val);
             m_last_label = m_pb.add(MOV{FReg(0),FReg(ir->m_val->m_memVal)});
-            m_pb.add(DBG{ [](const Cpu & cpu){std::cout << cpu.getFloatRegister(FReg(0)) << std::endl;}});
+            m_pb.add(DBG{FReg(0)});
             m_fregs.insert(ir->m_val->m_memVal);       
         }
  
     }
     
+    void IRTot86::visit(Intrinsic * ir)
+    {
+        if (ir->m_kind == Intrinsic::Kind::Fence)
+        {
+            m_last_label = m_pb.add(FENCE{});
+            return;
+        }
+        if (ir->m_kind == Intrinsic::Kind::CoreId || ir->m_kind == Intrinsic::Kind::PerfCounter)
+        {
+            int regNum = NextReg();
+            if (ir->m_kind == Intrinsic::Kind::CoreId)
+                m_last_label = m_pb.add(MOV{Reg(regNum), CoreId()});
+            else
+                m_last_label = m_pb.add(RDPMC{Reg(regNum), ir->m_counter});
+            ir->m_memType = 'r';
+            ir->m_memVal = regNum;
+            CheckSpill(ir);
+            return;
+        }
+
+        InsertToReg(ir->m_val);
+        if (ir->m_address->m_memType == 's')
+            m_last_label = m_pb.add(XADD{Mem(Bp() - ir->m_address->m_memVal), Reg(ir->m_val->m_memVal)});
+        else if (ir->m_address->m_memType == 'm')
+            m_last_label = m_pb.add(XADD{Mem(ir->m_address->m_memVal), Reg(ir->m_val->m_memVal)});
+        else{
+            InsertToReg(ir->m_address);
+            m_last_label = m_pb.add(XADD{Mem(Reg(ir->m_address->m_memVal)), Reg(ir->m_val->m_memVal)});
+            m_regs.insert(ir->m_address->m_memVal);
+        }
+        // XADD leaves the previous value of the memory in the register of the added value
+        ir->m_memType = 'r';
+        ir->m_memVal = ir->m_val->m_memVal;
+        CheckSpill(ir);
+    }
+
+    void IRTot86::visit(VectorOp * ir)
+    {
+        // Vectorization checked there are enough vector registers, so vectors never spill
+        if (ir->m_kind == VectorOp::Kind::Load)
+        {
+            InsertToReg(ir->m_left);
+            int vregNum = NextVReg();
+            m_last_label = m_pb.add(VLOAD{VReg(vregNum), Mem(Reg(ir->m_left->m_memVal))});
+            m_regs.insert(ir->m_left->m_memVal);
+            ir->m_memType = 'v';
+            ir->m_memVal = vregNum;
+        }
+        else if (ir->m_kind == VectorOp::Kind::Store)
+        {
+            InsertToReg(ir->m_left);
+            m_last_label = m_pb.add(VSTORE{Mem(Reg(ir->m_left->m_memVal)), VReg(ir->m_right->m_memVal)});
+            m_regs.insert(ir->m_left->m_memVal);
+            m_vregs.insert(ir->m_right->m_memVal);
+        }
+        else if (ir->m_kind == VectorOp::Kind::Broadcast)
+        {
+            int vregNum = NextVReg();
+            if (ir->m_left->m_type == ResultType::Double)
+            {
+                InsertToFReg(ir->m_left);
+                m_last_label = m_pb.add(VBROADCAST{VReg(vregNum), FReg(ir->m_left->m_memVal)});
+                m_fregs.insert(ir->m_left->m_memVal);
+            }
+            else
+            {
+                InsertToReg(ir->m_left);
+                m_last_label = m_pb.add(VBROADCAST{VReg(vregNum), Reg(ir->m_left->m_memVal)});
+                m_regs.insert(ir->m_left->m_memVal);
+            }
+            ir->m_memType = 'v';
+            ir->m_memVal = vregNum;
+        }
+        else
+        {
+            VectorRegister left = VReg(ir->m_left->m_memVal);
+            VectorRegister right = VReg(ir->m_right->m_memVal);
+            if (ir->m_kind == VectorOp::Kind::Add && ir->m_type == ResultType::Double)
+                m_last_label = m_pb.add(VFADD{left, right});
+            else if (ir->m_kind == VectorOp::Kind::Add)
+                m_last_label = m_pb.add(VADD{left, right});
+            else if (ir->m_type == ResultType::Double)
+                m_last_label = m_pb.add(VFMUL{left, right});
+            else
+                m_last_label = m_pb.add(VMUL{left, right});
+            m_vregs.insert(ir->m_right->m_memVal);
+            ir->m_memType = 'v';
+            ir->m_memVal = ir->m_left->m_memVal;
+        }
+    }
+
+    void IRTot86::visit(Select * ir)
+    {
+        // Spilled values are popped in reverse order of their computation
+        InsertToReg(ir->m_false);
+        InsertToReg(ir->m_true);
+        InsertToReg(ir->m_cond->m_right);
+        InsertToReg(ir->m_cond->m_left);
+
+        Register result = Reg(ir->m_false->m_memVal);
+        Register value = Reg(ir->m_true->m_memVal);
+        m_last_label = m_pb.add(CMP{Reg(ir->m_cond->m_left->m_memVal),Reg(ir->m_cond->m_right->m_memVal)});
+        if (dynamic_cast<Gt*>(ir->m_cond))
+            m_pb.add(CMOVG{result, value});
+        else if (dynamic_cast<Gte*>(ir->m_cond))
+            m_pb.add(CMOVGE{result, value});
+        else if (dynamic_cast<Lt*>(ir->m_cond))
+            m_pb.add(CMOVL{result, value});
+        else if (dynamic_cast<Lte*>(ir->m_cond))
+            m_pb.add(CMOVLE{result, value});
+        else if (dynamic_cast<Eq*>(ir->m_cond))
+            m_pb.add(CMOVE{result, value});
+        else
+            m_pb.add(CMOVNE{result, value});
+        m_regs.insert(ir->m_cond->m_left->m_memVal);
+        m_regs.insert(ir->m_cond->m_right->m_memVal);
+        m_regs.insert(ir->m_true->m_memVal);
+
+        ir->m_memType = 'r';
+        ir->m_memVal = ir->m_false->m_memVal;
+        CheckSpill(ir);
+    }
+
     void IRTot86::visit(NOP * ir)
     {
        m_last_label = m_pb.add(tiny::t86::NOP{});
@@ -956,6 +1091,11 @@ namespace tinyc
     {
         return m_fregs.extract(m_fregs.begin()).value();
     }
+
+    int IRTot86::NextVReg()
+    {
+        return m_vregs.extract(m_vregs.begin()).value();
+    }
     
     void IRTot86::AllUsedRegs(std::vector<int> & regs)
     {
@@ -18,7 +18,7 @@ namespace tinyc {
 
     class IRTot86 : public IRVisitor {
         public:
-            IRTot86(int maxReg = 10, int maxFreg = 5);
+            IRTot86(int maxReg = 10, int maxFreg = 5, int maxVreg = 4);
             void visit(Fun_address * ir);
             void visit(Call * ir);
             void visit(CallStatic * ir);
@@ -66,6 +66,9 @@ namespace tinyc {
             void visit(Castitod * ir);
             void visit(Castdtoi * ir);
             void visit(DebugWrite * ir);
+            void visit(Intrinsic * ir);
+            void visit(VectorOp * ir);
+            void visit(Select * ir);
             void visit(NOP * ir);
             void visitChild(Instruction * ir);
             void visit(Function * fun);
@@ -75,6 +78,7 @@ namespace tinyc {
         protected:
             int NextReg();
             int NextFReg();
+            int NextVReg();
             void AllUsedRegs(std::vector<int> & regs);
             void AllUsedFRegs(std::vector<int> & fregs);
             void AddLabel(Block * block);
@@ -90,6 +94,7 @@ namespace tinyc {
             int m_max_fregs;
             std::set<int> m_regs;
             std::set<int> m_fregs;
+            std::set<int> m_vregs;
             std::unordered_map<Block*,Label> m_block_labels;
             std::vector<std::pair<Label,Block*>> m_patch_labels;
             std::unordered_map<std::string,Label> m_funs;
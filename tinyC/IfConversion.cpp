@@ -0,0 +1,208 @@
+#include "IfConversion.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace tinyc
+{
+    namespace {
+        bool ScalarVariable(Instruction * ins)
+        {
+            if (Alloc_l * alloc = dynamic_cast<Alloc_l*>(ins))
+                return alloc->m_size == 1;
+            if (Alloc_g * alloc = dynamic_cast<Alloc_g*>(ins))
+                return alloc->m_size == 1;
+            return dynamic_cast<Alloc_arg*>(ins) != nullptr;
+        }
+    }
+
+    IfConversion::IfConversion(std::vector<Function*> & funs, int maxRegs, int mispredictPenalty)
+    :m_funs(funs), m_max_regs(maxRegs), m_mispredict_penalty(mispredictPenalty)
+    {
+    }
+
+    void IfConversion::Start()
+    {
+        for (auto & fun : m_funs)
+        {
+            for (int i = 0; i < fun->m_blocks.size(); i++)
+                Convert(fun,fun->m_blocks[i]);
+        }
+    }
+
+    bool IfConversion::Convert(Function * fun, Block * block)
+    {
+        std::vector<Instruction*> & ins = block->m_block;
+        if (ins.size() < 2)
+            return false;
+        Jump_cond * jump = dynamic_cast<Jump_cond*>(ins.back());
+        CmpOp * cond = jump != nullptr ? dynamic_cast<CmpOp*>(jump->m_cond) : nullptr;
+        if (cond == nullptr || ins[ins.size() - 2] != cond || cond->m_left->m_type == ResultType::Double)
+            return false;
+
+        Case t;
+        if (!CheckCase(fun,jump->m_true,t))
+            return false;
+        Block * join = static_cast<Jump*>(t.m_block->m_block.back())->m_label;
+        Case f{nullptr, nullptr, {}};
+        if (jump->m_false != join)
+        {
+            if (!CheckCase(fun,jump->m_false,f) || static_cast<Jump*>(f.m_block->m_block.back())->m_label != join
+                || f.m_store->m_address != t.m_store->m_address || f.m_store->m_type != t.m_store->m_type)
+                return false;
+        }
+        if (!Profitable(t,f))
+            return false;
+
+        // Both values are computed while the operands of the condition hold two registers
+        int live = 2;
+        int maxLive = live;
+        std::vector<Instruction*> values = t.m_values;
+        values.insert(values.end(),f.m_values.begin(),f.m_values.end());
+        for (auto & x : values)
+        {
+            if (dynamic_cast<BinaryOp*>(x))
+                live--;
+            else if (!dynamic_cast<UnaryOp*>(x))
+                live++;
+            maxLive = std::max(maxLive,live);
+        }
+        if (f.m_block == nullptr)
+            maxLive = std::max(maxLive,live + 1);
+        // Backend spills when less than two registers are free
+        if (maxLive + 2 > m_max_regs)
+            return false;
+
+        ins.pop_back();
+        ins.pop_back();
+        ins.insert(ins.end(),values.begin(),values.end());
+        Instruction * otherwise = f.m_store != nullptr ? f.m_store->m_value : nullptr;
+        if (otherwise == nullptr)
+        {
+            // Triangle keeps the current value of the variable
+            Load * load = new Load();
+            load->m_address = t.m_store->m_address;
+            load->m_type = t.m_store->m_type;
+            load->m_line = jump->m_line;
+            ins.push_back(load);
+            otherwise = load;
+        }
+        Select * select = new Select(cond,t.m_store->m_value,otherwise,t.m_store->m_type);
+        ins.push_back(select);
+        Store * store = new Store();
+        store->m_address = t.m_store->m_address;
+        store->m_value = select;
+        store->m_type = t.m_store->m_type;
+        ins.push_back(store);
+        Jump * next = new Jump();
+        next->m_label = join;
+        ins.push_back(next);
+        // The branch became a select, which stays on the line of the if
+        select->m_line = store->m_line = next->m_line = jump->m_line;
+
+        delete jump;
+        for (Case * c : {&t, &f})
+        {
+            if (c->m_block == nullptr)
+                continue;
+            fun->m_blocks.erase(std::find(fun->m_blocks.begin(),fun->m_blocks.end(),c->m_block));
+            delete c->m_store;
+            delete c->m_block->m_block.back();
+            delete c->m_block;
+        }
+        return true;
+    }
+
+    bool IfConversion::CheckCase(Function * fun, Block * block, Case & c) const
+    {
+        if (std::find(fun->m_blocks.begin(),fun->m_blocks.end(),block) == fun->m_blocks.end() || References(fun,block) != 1)
+            return false;
+        for (auto & loop : fun->m_loops)
+            if (loop.m_header == block || loop.m_body == block || loop.m_increment == block || loop.m_exit == block)
+                return false;
+
+        std::vector<Instruction*> & ins = block->m_block;
+        if (ins.size() < 2 || ins.size() - 2 > m_size_limit || !dynamic_cast<Jump*>(ins.back()))
+            return false;
+        c.m_block = block;
+        c.m_store = dynamic_cast<Store*>(ins[ins.size() - 2]);
+        if (c.m_store == nullptr || !ScalarVariable(c.m_store->m_address)
+            || (c.m_store->m_type != ResultType::Integer && c.m_store->m_type != ResultType::Char)
+            || c.m_store->m_value->m_type != c.m_store->m_type)
+            return false;
+
+        // Values form a single tree ending in the store, so nothing else holds a register
+        std::unordered_map<Instruction*,int> uses;
+        auto use = [&uses](Instruction * x) {
+            auto it = uses.find(x);
+            if (it == uses.end())
+                return false;
+            it->second++;
+            return true;
+        };
+        c.m_values.assign(ins.begin(),ins.end() - 2);
+        for (auto & x : c.m_values)
+        {
+            if (x->m_type == ResultType::Double)
+                return false;
+            if (Load * load = dynamic_cast<Load*>(x))
+            {
+                if (!ScalarVariable(load->m_address))
+                    return false;
+            }
+            else if (dynamic_cast<Add*>(x) || dynamic_cast<Sub*>(x) || dynamic_cast<Mul*>(x) || dynamic_cast<BitAnd*>(x)
+                     || dynamic_cast<BitOr*>(x) || dynamic_cast<ShL*>(x) || dynamic_cast<ShR*>(x))
+            {
+                BinaryOp * op = static_cast<BinaryOp*>(x);
+                if (!use(op->m_left) || !use(op->m_right))
+                    return false;
+            }
+            else if (dynamic_cast<Inc*>(x) || dynamic_cast<Dec*>(x) || dynamic_cast<Neg*>(x))
+            {
+                if (!use(static_cast<UnaryOp*>(x)->m_left))
+                    return false;
+            }
+            else if (!dynamic_cast<Load_Imm_i*>(x))
+                return false;
+            uses[x] = 0;
+        }
+        if (!use(c.m_store->m_value))
+            return false;
+        for (auto & x : uses)
+            if (x.second != 1)
+                return false;
+        return true;
+    }
+
+    bool IfConversion::Profitable(const Case & t, const Case & f) const
+    {
+        // Triangle always loads the kept value in addition to its case
+        int added = f.m_block != nullptr ? std::max(Cost(t.m_values),Cost(f.m_values)) : Cost(t.m_values) + m_load_cost;
+        // Half of the executions of an unpredictable branch are mispredicted
+        return 2 * added <= m_mispredict_penalty;
+    }
+
+    int IfConversion::Cost(const std::vector<Instruction*> & values) const
+    {
+        int cost = 0;
+        for (auto & x : values)
+            cost += dynamic_cast<Load*>(x) ? m_load_cost : 1;
+        return cost;
+    }
+
+    int IfConversion::References(Function * fun, Block * block) const
+    {
+        int references = 0;
+        for (auto & x : fun->m_blocks)
+        {
+            for (auto & y : x->m_block)
+            {
+                if (Jump * jump = dynamic_cast<Jump*>(y))
+                    references += jump->m_label == block;
+                else if (Jump_cond * jump = dynamic_cast<Jump_cond*>(y))
+                    references += (jump->m_true == block) + (jump->m_false == block);
+            }
+        }
+        return references;
+    }
+}
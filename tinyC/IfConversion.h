@@ -0,0 +1,47 @@
+#pragma once
+
+#include "IR.h"
+#include "../tiny86/ram.h"
+#include <vector>
+
+namespace tinyc {
+
+    /**
+     * Replaces small ifs assigning one variable by a select, so no branch has to be predicted
+     *
+     * Handles the diamond, where both cases store into the same int or char variable, and the triangle
+     * without an else case. Cases have to be single blocks computing the stored value from variables
+     * and constants by operations which can not fail, they are then computed before the select.
+     *
+     * Both cases always run after the conversion, so an if is converted only when the work it adds
+     * is at most the expected cost of a mispredict, taking the branch as unpredictable (mispredicted
+     * every other time). The work is the longer case of a diamond, or the case and the load of the
+     * kept value of a triangle. Deeper frontends convert more ifs.
+     */
+    class IfConversion {
+        public:
+            // Mispredict penalty is the refill of the frontend, its stages and the rename latency
+            IfConversion(std::vector<Function*> & funs, int maxRegs, int mispredictPenalty);
+            void Start();
+        protected:
+            // Block of one case of the if, the stored value is computed by m_values
+            struct Case {
+                Block * m_block;
+                Store * m_store;
+                std::vector<Instruction*> m_values;
+            };
+            bool Convert(Function * fun, Block * block);
+            bool CheckCase(Function * fun, Block * block, Case & c) const;
+            int References(Function * fun, Block * block) const;
+            bool Profitable(const Case & t, const Case & f) const;
+            int Cost(const std::vector<Instruction*> & values) const;
+            std::vector<Function*> & m_funs;
+            int m_max_regs;
+            int m_mispredict_penalty;
+            // Ticks a load adds, it holds a reservation station entry while waiting for the RAM,
+            // which costs about twice the RAM latency in the default configuration
+            int m_load_cost = 2 * static_cast<int>(RAM::flatLatency);
+            // Instructions computing a stored value, more would hold too many registers
+            int m_size_limit = 6;
+    };
+}
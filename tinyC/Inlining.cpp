@@ -86,6 +86,11 @@ namespace tinyc
             FillBlock(caller->m_blocks[block_index + i + 1],callee->m_blocks[i]);
             m_map_ins.clear();
         }
+        for (auto & loop : callee->m_loops)
+        {
+            caller->m_loops.push_back(ForLoop{m_map_block[loop.m_header], m_map_block[loop.m_body],
+                                              m_map_block[loop.m_increment], m_map_block[loop.m_exit], loop.m_line});
+        }
     }
     
     void Inlining::PreparingInline(Function * caller, Function * callee, int block_index, int & call_index)
@@ -103,6 +108,7 @@ namespace tinyc
             Alloc_l * var = new Alloc_l();
             Alloc_l * old = callee->m_allocs[i];
             var->m_type = old->m_type;
+            var->m_size = old->m_size;
             caller->m_allocs.push_back(var);  
             m_map_allocs.insert(std::make_pair(old,var));
         }
@@ -130,6 +136,7 @@ namespace tinyc
             Store * store = new Store();
             store->m_address = caller->m_allocs[alloc_index];
             store->m_value = block->m_block[j];
+            store->m_line = block->m_block[j+1]->m_line;
             delete block->m_block[j+1];
             block->m_block[j+1] = store;
             alloc_index--;
@@ -194,9 +201,10 @@ namespace tinyc
                 m_return_block = caller->m_blocks[i];
             }
         }
-        delete block->m_block[call_index];
         Jump * j = new Jump();
         j->m_label = caller->m_blocks[block_index+1];
+        j->m_line = block->m_block[call_index]->m_line;
+        delete block->m_block[call_index];
         block->m_block[call_index] = j;
         if (block->m_block.size() - 1 > call_index)
             block->m_block.erase(block->m_block.begin() + call_index + 1,block->m_block.end());
@@ -206,6 +214,8 @@ namespace tinyc
     {
         for (auto & x : from->m_block)
         {
+            // Inlined code keeps the lines of the callee
+            size_t first = to->m_block.size();
             if (Call * ins = dynamic_cast<Call*>(x))
             {
                 Call * in = new Call();
@@ -246,8 +256,9 @@ namespace tinyc
             {
                 Load * in = new Load();
                 in->m_type = ins->m_type;
+                // Globals stay as they are
                 auto it = m_map_allocs.find(ins->m_address);
-                in->m_address = it->second;
+                in->m_address = it != m_map_allocs.end() ? it->second : ins->m_address;
                 to->m_block.push_back(in);
                 m_map_ins.insert(std::make_pair(ins,in));
             }
@@ -270,8 +281,15 @@ namespace tinyc
             else if (Store * ins = dynamic_cast<Store*>(x))
             {
                 Store * in = new Store();
+                // Address is a local variable, a computed array element, or a global which stays as is
                 auto it = m_map_allocs.find(ins->m_address);
-                in->m_address = it->second;
+                auto address = m_map_ins.find(ins->m_address);
+                if (it != m_map_allocs.end())
+                    in->m_address = it->second;
+                else if (address != m_map_ins.end())
+                    in->m_address = address->second;
+                else
+                    in->m_address = ins->m_address;
                 it = m_map_ins.find(ins->m_value);
                 in->m_value = it->second;
                 in->m_type = ins->m_type;
@@ -282,13 +300,13 @@ namespace tinyc
                 LoadAddress * in = new LoadAddress();
                 in->m_type = ins->m_type;
                 auto it = m_map_allocs.find(ins->m_address);
-                in->m_address = it->second;
+                in->m_address = it != m_map_allocs.end() ? it->second : ins->m_address;
                 to->m_block.push_back(in);
                 m_map_ins.insert(std::make_pair(ins,in));
             }
             else if (LoadDeref * ins = dynamic_cast<LoadDeref*>(x))
             {
-                Load * in = new Load();
+                LoadDeref * in = new LoadDeref();
                 in->m_type = ins->m_type;
                 auto it = m_map_ins.find(ins->m_address);
                 in->m_address = it->second;
@@ -531,6 +549,26 @@ namespace tinyc
                 NOP * in = new NOP();
                 to->m_block.push_back(in);
             }
+            else if (Intrinsic * ins = dynamic_cast<Intrinsic*>(x))
+            {
+                Intrinsic * in = new Intrinsic(ins->m_kind);
+                in->m_counter = ins->m_counter;
+                if (ins->m_kind == Intrinsic::Kind::AtomicAdd)
+                {
+                    // Address is a local variable, a computed pointer, or a global which stays as is
+                    auto alloc = m_map_allocs.find(ins->m_address);
+                    auto address = m_map_ins.find(ins->m_address);
+                    if (alloc != m_map_allocs.end())
+                        in->m_address = alloc->second;
+                    else if (address != m_map_ins.end())
+                        in->m_address = address->second;
+                    else
+                        in->m_address = ins->m_address;
+                    in->m_val = m_map_ins.find(ins->m_val)->second;
+                }
+                to->m_block.push_back(in);
+                m_map_ins.insert(std::make_pair(ins,in));
+            }
             else if (DebugWrite * ins = dynamic_cast<DebugWrite*>(x))
             {
                 auto it = m_map_ins.find(ins->m_val);
@@ -538,6 +576,8 @@ namespace tinyc
                 in->m_type = ins->m_type;
                 to->m_block.push_back(in);
             }
+            for (size_t i = first; i < to->m_block.size(); i++)
+                to->m_block[i]->m_line = x->m_line;
         }
     }
 
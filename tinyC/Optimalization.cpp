@@ -2,7 +2,10 @@
 #include "IR.h"
 #include "Peephole.h"
 #include "Inlining.h"
+#include "IfConversion.h"
+#include "Vectorization.h"
 #include <vector>
+#include <iostream>
 
 namespace tinyc
 {
@@ -21,6 +24,16 @@ namespace tinyc
         InliningOptimalization();
     }
     
+    void Optimalization::StartLevel(int level, int maxRegs, int maxVregs, int mispredictPenalty)
+    {
+        if (level >= 1)
+            StartAll();
+        if (level >= 2) {
+            IfConversionOptimalization(maxRegs,mispredictPenalty);
+            VectorizationOptimalization(maxVregs);
+        }
+    }
+    
     void Optimalization::PeepholeOptimalization()
     {
         Peephole peep;
@@ -35,6 +48,19 @@ namespace tinyc
         Inlining in(m_prg->m_funs);
         in.Start();
     }
+
+    void Optimalization::IfConversionOptimalization(int maxRegs, int mispredictPenalty)
+    {
+        IfConversion conv(m_prg->m_funs,maxRegs,mispredictPenalty);
+        conv.Start();
+    }
+
+    void Optimalization::VectorizationOptimalization(int maxVregs)
+    {
+        Vectorization vec(m_prg->m_funs,maxVregs);
+        vec.Start();
+        vec.Report(std::cerr);
+    }
     
     void Optimalization::SimpleBinExpr(Peephole & peep)
     {   
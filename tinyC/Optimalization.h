@@ -14,8 +14,15 @@ namespace tinyc {
         Optimalization(IRProgram * prg);
         ~Optimalization();
         void StartAll();
+        // Passes of the -o level, 1 is peephole and inlining, 2 adds if-conversion and vectorization
+        void StartLevel(int level, int maxRegs, int maxVregs, int mispredictPenalty);
         void PeepholeOptimalization();
         void InliningOptimalization();
+        // Needs the register count of the backend, selects hold more registers than branches,
+        // and the mispredict penalty of the cpu to decide which ifs are worth converting
+        void IfConversionOptimalization(int maxRegs, int mispredictPenalty);
+        // Prints which loops were vectorised, run after the others
+        void VectorizationOptimalization(int maxVregs);
 
     protected:
         void SimpleBinExpr(Peephole & peep);
@@ -22,6 +22,7 @@ namespace tinyc
 
         right->m_value = val;
         ShL * op1 = new ShL(left,right,op->m_type);
+        op1->m_line = op->m_line;
         (*block)[start+2] = op1;
         new_ones.insert(std::make_pair(op,op1));
 
@@ -47,6 +48,7 @@ namespace tinyc
 
         right->m_value = val;
         ShR * op1 = new ShR(left,right,op->m_type);
+        op1->m_line = op->m_line;
         (*block)[start+2] = op1;
         new_ones.insert(std::make_pair(op,op1));
 
@@ -62,6 +64,7 @@ namespace tinyc
 
         Load_Imm_i * now = new Load_Imm_i();
         now->m_type = ResultType::Integer;
+        now->m_line = op->m_line;
 
         if (dynamic_cast<Mul*>(op))
             now->m_value = left->m_value * right->m_value;
@@ -460,6 +463,36 @@ namespace tinyc
             ir->m_val = Check(ir->m_val);
     }
     
+    void Peephole::visit(Intrinsic * ir)
+    {
+        CheckType(ir);
+        if (!m_new_ones.empty() && ir->m_kind == Intrinsic::Kind::AtomicAdd){
+            ir->m_address = Check(ir->m_address);
+            ir->m_val = Check(ir->m_val);
+        }
+    }
+
+    void Peephole::visit(VectorOp * ir)
+    {
+        CheckType(ir);
+        if (!m_new_ones.empty()){
+            ir->m_left = Check(ir->m_left);
+            if (ir->m_right != nullptr)
+                ir->m_right = Check(ir->m_right);
+        }
+    }
+
+    void Peephole::visit(Select * ir)
+    {
+        CheckType(ir);
+        if (!m_new_ones.empty()){
+            ir->m_cond->m_left = Check(ir->m_cond->m_left);
+            ir->m_cond->m_right = Check(ir->m_cond->m_right);
+            ir->m_true = Check(ir->m_true);
+            ir->m_false = Check(ir->m_false);
+        }
+    }
+
     void Peephole::visit(NOP * ir)
     {
         CheckType(ir);
@@ -61,6 +61,9 @@ namespace tinyc {
             void visit(Castitod * ir);
             void visit(Castdtoi * ir);
             void visit(DebugWrite * ir);
+            void visit(Intrinsic * ir);
+            void visit(VectorOp * ir);
+            void visit(Select * ir);
             void visit(NOP * ir);
             void visitChild(Instruction * ir);
             void visit(Function * fun);
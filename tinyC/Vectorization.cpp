@@ -0,0 +1,476 @@
+#include "Vectorization.h"
+#include "../tiny86/cpu/register.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace tinyc
+{
+    namespace {
+        // Words taken by the allocation, 0 when the instruction is not an allocation
+        int64_t AllocSize(Instruction * ins)
+        {
+            if (Alloc_l * alloc = dynamic_cast<Alloc_l*>(ins))
+                return alloc->m_size;
+            if (Alloc_g * alloc = dynamic_cast<Alloc_g*>(ins))
+                return alloc->m_size;
+            if (dynamic_cast<Alloc_arg*>(ins))
+                return 1;
+            return 0;
+        }
+
+        ResultType AllocType(Instruction * ins)
+        {
+            if (Alloc_l * alloc = dynamic_cast<Alloc_l*>(ins))
+                return alloc->m_type;
+            if (Alloc_g * alloc = dynamic_cast<Alloc_g*>(ins))
+                return alloc->m_type;
+            return ins->m_type;
+        }
+
+        bool LoadsCounter(Instruction * ins, Instruction * counter)
+        {
+            Load * load = dynamic_cast<Load*>(ins);
+            return load != nullptr && load->m_address == counter;
+        }
+
+        bool IsOne(Instruction * ins)
+        {
+            Load_Imm_i * imm = dynamic_cast<Load_Imm_i*>(ins);
+            return imm != nullptr && imm->m_value == 1;
+        }
+    }
+
+    Vectorization::Vectorization(std::vector<Function*> & funs, int maxVregs)
+    :m_funs(funs), m_max_vregs(maxVregs), m_lanes(tiny::t86::VectorRegister::lanes)
+    {
+    }
+
+    void Vectorization::Start()
+    {
+        for (auto & fun : m_funs)
+        {
+            for (auto & loop : fun->m_loops)
+            {
+                Result result;
+                result.m_fun = fun->m_name;
+                result.m_line = loop.m_line;
+                result.m_reason = Analyze(fun,loop,result);
+                if (result.m_reason.empty())
+                    Vectorize(fun,loop);
+                m_results.push_back(result);
+            }
+        }
+    }
+
+    void Vectorization::Report(std::ostream & os) const
+    {
+        os << "Vectorization report:" << std::endl;
+        if (m_results.empty())
+            os << "  no for loops" << std::endl;
+        for (auto & x : m_results)
+        {
+            os << "  " << x.m_fun << ", line " << x.m_line << ": ";
+            if (x.m_reason.empty())
+                os << "vectorised by " << m_lanes << " lanes, stores per iteration: " << x.m_stores << std::endl;
+            else
+                os << "not vectorised, " << x.m_reason << std::endl;
+        }
+    }
+
+    std::string Vectorization::Analyze(Function * fun, ForLoop & loop, Result & result)
+    {
+        auto inFun = [fun](Block * block) {
+            return block != nullptr && std::find(fun->m_blocks.begin(),fun->m_blocks.end(),block) != fun->m_blocks.end();
+        };
+        if (!inFun(loop.m_header) || !inFun(loop.m_body) || !inFun(loop.m_increment) || loop.m_exit == nullptr)
+            return "loop was changed by other optimalizations";
+
+        // Header has to be just counter < bound or counter <= bound
+        std::vector<Instruction*> & header = loop.m_header->m_block;
+        Jump_cond * jump = dynamic_cast<Jump_cond*>(header.back());
+        m_cond = jump != nullptr ? dynamic_cast<CmpOp*>(jump->m_cond) : nullptr;
+        if (m_cond == nullptr || (!dynamic_cast<Lt*>(m_cond) && !dynamic_cast<Lte*>(m_cond))
+            || jump->m_true != loop.m_body || jump->m_false != loop.m_exit)
+            return "condition is not counter < bound or counter <= bound";
+        Load * counter = dynamic_cast<Load*>(m_cond->m_left);
+        if (counter == nullptr || AllocSize(counter->m_address) != 1 || counter->m_type != ResultType::Integer
+            || header.front() != counter)
+            return "condition is not counter < bound or counter <= bound";
+        m_counter = counter->m_address;
+        if (header.size() != 4 || header[1] != m_cond->m_right || header[2] != m_cond)
+            return "bound is not an int variable or constant";
+        if (Load * bound = dynamic_cast<Load*>(m_cond->m_right))
+        {
+            if (AllocSize(bound->m_address) != 1 || bound->m_address == m_counter || bound->m_type != ResultType::Integer)
+                return "bound is not an int variable or constant";
+        }
+        else if (!dynamic_cast<Load_Imm_i*>(m_cond->m_right))
+            return "bound is not an int variable or constant";
+
+        // Increment has to store counter + 1 into the counter and nothing else
+        std::vector<Instruction*> & increment = loop.m_increment->m_block;
+        Jump * back = dynamic_cast<Jump*>(increment.back());
+        if (back == nullptr || back->m_label != loop.m_header)
+            return "counter does not go up by one";
+        int stores = 0;
+        bool byOne = false;
+        for (int i = 0; i + 1 < increment.size(); i++)
+        {
+            Instruction * x = increment[i];
+            if (Store * store = dynamic_cast<Store*>(x))
+            {
+                stores++;
+                Instruction * value = store->m_value;
+                if (Inc * inc = dynamic_cast<Inc*>(value))
+                    byOne = LoadsCounter(inc->m_left,m_counter);
+                else if (Add * add = dynamic_cast<Add*>(value))
+                    byOne = (LoadsCounter(add->m_left,m_counter) && IsOne(add->m_right))
+                            || (IsOne(add->m_left) && LoadsCounter(add->m_right,m_counter));
+                byOne = byOne && store->m_address == m_counter;
+            }
+            else if (!dynamic_cast<Load*>(x) && !dynamic_cast<Load_Imm_i*>(x) && !dynamic_cast<Inc*>(x) && !dynamic_cast<Add*>(x))
+                return "counter does not go up by one";
+        }
+        if (stores != 1 || !byOne)
+            return "counter does not go up by one";
+
+        std::vector<Instruction*> & body = loop.m_body->m_block;
+        Jump * next = dynamic_cast<Jump*>(body.back());
+        if (next == nullptr || next->m_label != loop.m_increment)
+            return "body is not a single block";
+
+        // Vector loop is entered instead of the header
+        m_preheader = nullptr;
+        for (auto & x : fun->m_blocks)
+        {
+            Jump * entry = dynamic_cast<Jump*>(x->m_block.back());
+            if (x == loop.m_increment || entry == nullptr || entry->m_label != loop.m_header)
+                continue;
+            if (m_preheader != nullptr)
+                return "loop is entered from more places";
+            m_preheader = x;
+        }
+        if (m_preheader == nullptr)
+            return "loop is entered from more places";
+
+        std::string reason = AnalyzeBody(loop.m_body,m_counter);
+        if (!reason.empty())
+            return reason;
+        reason = CheckDependences();
+        if (!reason.empty())
+            return reason;
+
+        for (auto & x : m_accesses)
+            result.m_stores += x.m_store;
+        return "";
+    }
+
+    std::string Vectorization::AnalyzeBody(Block * block, Instruction * counter)
+    {
+        m_values.clear();
+        m_accesses.clear();
+        std::unordered_map<Instruction*,int> uses;
+        int statement = 0;
+        // Vector registers taken when the body is emitted in order, vectors are never spilled
+        int live = 0;
+        int maxLive = 0;
+        auto operand = [this,&uses](Instruction * ins) -> Value * {
+            auto it = m_values.find(ins);
+            if (it == m_values.end())
+                return nullptr;
+            uses[ins]++;
+            return &it->second;
+        };
+        auto take = [&live,&maxLive](int vregs) {
+            live += vregs;
+            maxLive = std::max(maxLive,live);
+        };
+
+        std::vector<Instruction*> & body = block->m_block;
+        for (int i = 0; i + 1 < body.size(); i++)
+        {
+            Instruction * x = body[i];
+            if (Load * ins = dynamic_cast<Load*>(x))
+            {
+                if (ins->m_address == counter)
+                    m_values[x] = Value{Kind::Counter};
+                else if (AllocSize(ins->m_address) == 1)
+                    m_values[x] = Value{Kind::Invariant};
+                else
+                    return "reads an array without index";
+            }
+            else if (dynamic_cast<Load_Imm_i*>(x) || dynamic_cast<Load_Imm_d*>(x))
+            {
+                m_values[x] = Value{Kind::Invariant};
+            }
+            else if (LoadAddress * ins = dynamic_cast<LoadAddress*>(x))
+            {
+                if (AllocSize(ins->m_address) <= 1)
+                    return "takes address of a variable";
+                ResultType t = AllocType(ins->m_address);
+                if (t != ResultType::Integer && t != ResultType::Double)
+                    return "accesses an array of chars";
+                m_values[x] = Value{Kind::Array, ins->m_address};
+            }
+            else if (dynamic_cast<Add*>(x) || dynamic_cast<Sub*>(x) || dynamic_cast<Mul*>(x))
+            {
+                BinaryOp * op = dynamic_cast<BinaryOp*>(x);
+                Value * left = operand(op->m_left);
+                Value * right = operand(op->m_right);
+                if (left == nullptr || right == nullptr)
+                    return "computes an unsupported expression";
+                bool add = dynamic_cast<Add*>(x) != nullptr;
+                bool sub = dynamic_cast<Sub*>(x) != nullptr;
+                Load_Imm_i * leftImm = dynamic_cast<Load_Imm_i*>(op->m_left);
+                Load_Imm_i * rightImm = dynamic_cast<Load_Imm_i*>(op->m_right);
+                if (add && left->m_kind == Kind::Array && right->m_kind == Kind::Counter)
+                    m_values[x] = Value{Kind::Element, left->m_array, right->m_offset};
+                else if ((add || sub) && left->m_kind == Kind::Counter && rightImm != nullptr)
+                    m_values[x] = Value{Kind::Counter, nullptr, left->m_offset + (add ? rightImm->m_value : -rightImm->m_value)};
+                else if (add && leftImm != nullptr && right->m_kind == Kind::Counter)
+                    m_values[x] = Value{Kind::Counter, nullptr, right->m_offset + leftImm->m_value};
+                else if (left->m_kind == Kind::Invariant && right->m_kind == Kind::Invariant)
+                    m_values[x] = Value{Kind::Invariant};
+                else if (left->m_kind == Kind::Counter || right->m_kind == Kind::Counter)
+                    return "uses the loop counter as a value";
+                else if ((left->m_kind == Kind::Vector || left->m_kind == Kind::Invariant)
+                         && (right->m_kind == Kind::Vector || right->m_kind == Kind::Invariant))
+                {
+                    if (sub)
+                        return "subtracts elements, there is no packed subtraction";
+                    // Invariant operand is broadcast, result takes the register of the left operand
+                    take((left->m_kind == Kind::Invariant) + (right->m_kind == Kind::Invariant));
+                    take(-1);
+                    m_values[x] = Value{Kind::Vector};
+                }
+                else
+                    return "computes an unsupported expression";
+            }
+            else if (LoadDeref * ins = dynamic_cast<LoadDeref*>(x))
+            {
+                Value * address = operand(ins->m_address);
+                if (address == nullptr || address->m_kind != Kind::Element)
+                    return "reads through a pointer";
+                if (ins->m_type != AllocType(address->m_array))
+                    return "mixes int and double";
+                m_accesses.push_back(Access{address->m_array, address->m_offset, false, statement});
+                take(1);
+                m_values[x] = Value{Kind::Vector};
+            }
+            else if (Store * ins = dynamic_cast<Store*>(x))
+            {
+                Value * address = operand(ins->m_address);
+                if (address == nullptr)
+                    return "writes a scalar variable";
+                if (address->m_kind != Kind::Element)
+                    return "writes through a pointer";
+                Value * value = operand(ins->m_value);
+                if (value == nullptr || value->m_kind == Kind::Counter)
+                    return "uses the loop counter as a value";
+                if (value->m_kind != Kind::Vector && value->m_kind != Kind::Invariant)
+                    return "computes an unsupported expression";
+                if (ins->m_value->m_type != AllocType(address->m_array))
+                    return "mixes int and double";
+                take(value->m_kind == Kind::Invariant);
+                take(-1);
+                m_accesses.push_back(Access{address->m_array, address->m_offset, true, statement++});
+            }
+            else if (dynamic_cast<Call*>(x) || dynamic_cast<CallStatic*>(x) || dynamic_cast<BorderCall*>(x)
+                     || dynamic_cast<StoreParam*>(x) || dynamic_cast<DebugWrite*>(x) || dynamic_cast<Intrinsic*>(x))
+                return "calls a function, prints or uses a builtin";
+            else if (dynamic_cast<Castitod*>(x) || dynamic_cast<Castdtoi*>(x) || dynamic_cast<Castctoi*>(x) || dynamic_cast<Castctod*>(x))
+                return "mixes int and double";
+            else
+                return "computes an unsupported expression";
+        }
+        if (statement == 0)
+            return "stores no array element";
+        for (auto & x : m_values)
+            if (uses[x.first] != 1)
+                return "computes a value it does not use";
+        if (maxLive > m_max_vregs)
+            return "needs " + std::to_string(maxLive) + " vector registers, " + std::to_string(m_max_vregs) + " available";
+        return "";
+    }
+
+    std::string Vectorization::CheckDependences() const
+    {
+        // Vector loop runs statements one after another, each for all lanes, so only iterations
+        // less than lanes apart can see a different order of accesses to the same element
+        for (auto & store : m_accesses)
+        {
+            if (!store.m_store)
+                continue;
+            for (auto & x : m_accesses)
+            {
+                if (&x == &store || x.m_array != store.m_array)
+                    continue;
+                int64_t distance = x.m_offset - store.m_offset;
+                if (distance == 0 || std::abs(distance) >= m_lanes)
+                    continue;
+                if (x.m_store)
+                    return "stores an element stored by other iteration";
+                // Reads value stored by a previous iteration before the vector stores it
+                if (distance < 0 && x.m_statement <= store.m_statement)
+                    return "reads an element stored by a previous iteration";
+                // Reads value after the vector stored it for a later iteration
+                if (distance > 0 && x.m_statement > store.m_statement)
+                    return "reads an element after a following iteration stores it";
+            }
+        }
+        return "";
+    }
+
+    void Vectorization::Vectorize(Function * fun, ForLoop & loop)
+    {
+        Block * header = new Block();
+        Block * body = new Block();
+        Block * increment = new Block();
+
+        // Vector loop runs while the last of its lanes still passes the condition
+        Load * counter = new Load();
+        counter->m_address = m_counter;
+        counter->m_type = ResultType::Integer;
+        header->m_block.push_back(counter);
+        Load_Imm_i * last = new Load_Imm_i();
+        last->m_value = m_lanes - 1;
+        last->m_type = ResultType::Integer;
+        header->m_block.push_back(last);
+        Add * add = new Add(counter,last,ResultType::Integer);
+        header->m_block.push_back(add);
+        Instruction * bound = CloneScalar(m_cond->m_right);
+        header->m_block.push_back(bound);
+        CmpOp * cond;
+        if (dynamic_cast<Lt*>(m_cond))
+            cond = new Lt(add,bound,ResultType::Integer);
+        else
+            cond = new Lte(add,bound,ResultType::Integer);
+        cond->SetCmpJump(true);
+        header->m_block.push_back(cond);
+        Jump_cond * jump = new Jump_cond();
+        jump->m_cond = cond;
+        jump->m_true = body;
+        jump->m_false = loop.m_header;
+        header->m_block.push_back(jump);
+
+        m_clones.clear();
+        std::vector<Instruction*> & scalar = loop.m_body->m_block;
+        for (int i = 0; i + 1 < scalar.size(); i++)
+        {
+            Instruction * x = scalar[i];
+            size_t first = body->m_block.size();
+            if (Store * store = dynamic_cast<Store*>(x))
+            {
+                ResultType t = store->m_value->m_type;
+                Instruction * value = VectorOperand(store->m_value,t,body);
+                body->m_block.push_back(new VectorOp(VectorOp::Kind::Store,m_clones[store->m_address],value,t));
+            }
+            else if (m_values[x].m_kind != Kind::Vector)
+            {
+                m_clones[x] = CloneScalar(x);
+                body->m_block.push_back(m_clones[x]);
+            }
+            else if (LoadDeref * load = dynamic_cast<LoadDeref*>(x))
+            {
+                m_clones[x] = new VectorOp(VectorOp::Kind::Load,m_clones[load->m_address],nullptr,load->m_type);
+                body->m_block.push_back(m_clones[x]);
+            }
+            else
+            {
+                BinaryOp * op = dynamic_cast<BinaryOp*>(x);
+                VectorOp::Kind kind = dynamic_cast<Add*>(x) ? VectorOp::Kind::Add : VectorOp::Kind::Mul;
+                Instruction * left = VectorOperand(op->m_left,op->m_type,body);
+                Instruction * right = VectorOperand(op->m_right,op->m_type,body);
+                m_clones[x] = new VectorOp(kind,left,right,op->m_type);
+                body->m_block.push_back(m_clones[x]);
+            }
+            for (size_t j = first; j < body->m_block.size(); j++)
+                body->m_block[j]->m_line = x->m_line;
+        }
+        Jump * next = new Jump();
+        next->m_label = increment;
+        body->m_block.push_back(next);
+
+        counter = new Load();
+        counter->m_address = m_counter;
+        counter->m_type = ResultType::Integer;
+        increment->m_block.push_back(counter);
+        Load_Imm_i * lanes = new Load_Imm_i();
+        lanes->m_value = m_lanes;
+        lanes->m_type = ResultType::Integer;
+        increment->m_block.push_back(lanes);
+        add = new Add(counter,lanes,ResultType::Integer);
+        increment->m_block.push_back(add);
+        Store * store = new Store();
+        store->m_address = m_counter;
+        store->m_value = add;
+        store->m_type = ResultType::Integer;
+        increment->m_block.push_back(store);
+        Jump * back = new Jump();
+        back->m_label = header;
+        increment->m_block.push_back(back);
+
+        // Jump into the original header may be shared with its increment, so it is replaced
+        Jump * entry = new Jump();
+        entry->m_label = header;
+        m_preheader->m_block.back() = entry;
+
+        // Loop control is attributed to the for statement
+        entry->m_line = loop.m_line;
+        for (Block * block : {header,body,increment})
+            for (auto & x : block->m_block)
+                if (x->m_line == 0)
+                    x->m_line = loop.m_line;
+
+        auto it = std::find(fun->m_blocks.begin(),fun->m_blocks.end(),loop.m_header);
+        fun->m_blocks.insert(it,{header,body,increment});
+    }
+
+    Instruction * Vectorization::CloneScalar(Instruction * ins)
+    {
+        if (Load * x = dynamic_cast<Load*>(ins))
+        {
+            Load * in = new Load();
+            in->m_address = x->m_address;
+            in->m_type = x->m_type;
+            return in;
+        }
+        if (Load_Imm_i * x = dynamic_cast<Load_Imm_i*>(ins))
+        {
+            Load_Imm_i * in = new Load_Imm_i();
+            in->m_value = x->m_value;
+            in->m_type = x->m_type;
+            return in;
+        }
+        if (Load_Imm_d * x = dynamic_cast<Load_Imm_d*>(ins))
+        {
+            Load_Imm_d * in = new Load_Imm_d();
+            in->m_value = x->m_value;
+            in->m_type = x->m_type;
+            return in;
+        }
+        if (LoadAddress * x = dynamic_cast<LoadAddress*>(ins))
+        {
+            LoadAddress * in = new LoadAddress();
+            in->m_address = x->m_address;
+            in->m_type = x->m_type;
+            return in;
+        }
+        BinaryOp * x = dynamic_cast<BinaryOp*>(ins);
+        if (dynamic_cast<Add*>(ins))
+            return new Add(m_clones[x->m_left],m_clones[x->m_right],x->m_type);
+        if (dynamic_cast<Sub*>(ins))
+            return new Sub(m_clones[x->m_left],m_clones[x->m_right],x->m_type);
+        return new Mul(m_clones[x->m_left],m_clones[x->m_right],x->m_type);
+    }
+
+    Instruction * Vectorization::VectorOperand(Instruction * ins, ResultType t, Block * block)
+    {
+        if (m_values[ins].m_kind != Kind::Invariant)
+            return m_clones[ins];
+        VectorOp * broadcast = new VectorOp(VectorOp::Kind::Broadcast,m_clones[ins],nullptr,t);
+        block->m_block.push_back(broadcast);
+        return broadcast;
+    }
+}
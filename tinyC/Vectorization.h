@@ -0,0 +1,69 @@
+#pragma once
+
+#include "IR.h"
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <ostream>
+
+namespace tinyc {
+
+    /**
+     * Rewrites counted for loops over arrays to packed vector instructions
+     *
+     * A loop qualifies when its counter goes up by one and is compared by < or <= with a variable
+     * or constant, and its body is a single block of stores into array elements indexed by the counter
+     * plus a constant. Stored values are built by + and * from such elements and values the loop does
+     * not change. A vector loop doing lanes iterations at once is put in front of the loop, which then
+     * runs the remaining iterations. Runs last, after Peephole and Inlining.
+     */
+    class Vectorization {
+        public:
+            Vectorization(std::vector<Function*> & funs, int maxVregs);
+            void Start();
+            // Every for loop with the reason it was not vectorised
+            void Report(std::ostream & os) const;
+        protected:
+            enum class Kind {
+                Invariant, // computed the same way in every iteration
+                Counter,   // loop counter plus m_offset
+                Array,     // address of array m_array
+                Element,   // address of element counter + m_offset of m_array
+                Vector     // one lane per iteration
+            };
+            struct Value {
+                Kind m_kind;
+                Instruction * m_array = nullptr;
+                int64_t m_offset = 0;
+            };
+            struct Access {
+                Instruction * m_array;
+                int64_t m_offset;
+                bool m_store;
+                int m_statement;
+            };
+            struct Result {
+                std::string m_fun;
+                int m_line;
+                std::string m_reason; // empty when vectorised
+                int m_stores = 0;
+            };
+            std::string Analyze(Function * fun, ForLoop & loop, Result & result);
+            std::string AnalyzeBody(Block * body, Instruction * counter);
+            std::string CheckDependences() const;
+            void Vectorize(Function * fun, ForLoop & loop);
+            Instruction * CloneScalar(Instruction * ins);
+            Instruction * VectorOperand(Instruction * ins, ResultType t, Block * block);
+            std::vector<Function*> & m_funs;
+            int m_max_vregs;
+            int m_lanes;
+            std::vector<Result> m_results;
+            // Filled by Analyze for the current loop
+            Instruction * m_counter;
+            CmpOp * m_cond;
+            Block * m_preheader;
+            std::unordered_map<Instruction*,Value> m_values;
+            std::vector<Access> m_accesses;
+            std::unordered_map<Instruction*,Instruction*> m_clones;
+    };
+}
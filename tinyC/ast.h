@@ -934,6 +934,66 @@ namespace tinyc {
 
     };
 
+    /** Builtin of the target, called like a function, but lowered directly to t86 instructions.
+     */
+    class ASTBuiltin : public AST {
+    public:
+        enum class Kind {
+            // int coreid() - id of the core (hardware thread) running the code
+            coreId,
+            // void fence() - memory accesses before it finish before any after it starts
+            fence,
+            // int atomic_add(lvalue, int) - atomically adds to the variable, returns its previous value
+            atomicAdd,
+            // int rdpmc(integer) - performance counter of the running thread, the number is a literal
+            rdpmc,
+        };
+
+        Kind kind;
+        std::vector<std::unique_ptr<AST>> args;
+
+        ASTBuiltin(Token const & t, Kind kind):
+            AST{t},
+            kind{kind} {
+        }
+
+        bool hasAddress() const override {
+            return false;
+        }
+
+        static char const * name(Kind kind) {
+            switch (kind) {
+                case Kind::coreId:
+                    return "coreid";
+                case Kind::fence:
+                    return "fence";
+                case Kind::atomicAdd:
+                    return "atomic_add";
+                case Kind::rdpmc:
+                    return "rdpmc";
+            }
+            return "";
+        }
+
+        void print(colors::ColorPrinter & p) const override {
+            p << p.keyword << name(kind) << p.symbol << "(";
+            auto i = args.begin();
+            if (i != args.end()) {
+                p << **i;
+                while (++i != args.end()){
+                    p << ",";
+                    p << p.symbol << **i;
+                }
+            }
+            p << p.symbol << ")";
+        }
+
+    protected:
+
+        void accept(ASTVisitor * v) override;
+
+    };
+
     class ASTVisitor {
     public:
 
@@ -975,6 +1035,7 @@ namespace tinyc {
         virtual void visit(ASTCast * ast) = 0;
         virtual void visit(ASTWrite * ast) = 0;
         virtual void visit(ASTRead * ast) = 0;
+        virtual void visit(ASTBuiltin * ast) = 0;
 
     protected:
 
@@ -1026,5 +1087,6 @@ namespace tinyc {
     inline void ASTCast::accept(ASTVisitor * v) { v->visit(this); }
     inline void ASTRead::accept(ASTVisitor * v) { v->visit(this); }
     inline void ASTWrite::accept(ASTVisitor * v) { v->visit(this); }
+    inline void ASTBuiltin::accept(ASTVisitor * v) { v->visit(this); }
 
 } // namespace tinyc
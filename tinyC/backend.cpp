@@ -2,17 +2,22 @@
 
 #include "IR.h"
 #include "IRTot86.h"
+#include "frontend.h"
+#include "Optimalization.h"
 #include "../tiny86/target.h"
+#include "../tiny86/program/assembler.h"
+
+#include <fstream>
 
 
 namespace tinyc
 {
     using namespace tiny;
 
-    Backend::Backend(IRProgram * prg,int regs, int fregs)
+    Backend::Backend(IRProgram * prg,int regs, int fregs, int vregs)
     :m_prg(prg)
     {
-        target = new IRTot86(regs,fregs);
+        target = new IRTot86(regs,fregs,vregs);
     }
     
     Backend::~Backend()
@@ -27,8 +32,34 @@ namespace tinyc
     
     void Backend::Start()
     {
+        Program program = target->GetProgram();
+        if (const std::string & asmOutput = config.get("-asmOutput"); !asmOutput.empty()) {
+            std::ofstream os(asmOutput);
+            Assembler::disassemble(program, os);
+        }
         Target ex;
-        ex.execute(target->GetProgram());
+        ex.coRunCompiler = Compile;
+        ex.execute(std::move(program));
+    }
+
+    int Backend::MispredictPenalty()
+    {
+        const auto & cpuConfig = t86::Cpu::Config::instance();
+        return static_cast<int>(cpuConfig.frontendStages() + cpuConfig.renameLatency());
+    }
+
+    Program Backend::Compile(std::string const & source)
+    {
+        Frontend front;
+        std::unique_ptr<AST> ast = front.parse(source);
+        front.typecheck(ast);
+        std::unique_ptr<IRProgram> prg{front.astotir(ast)};
+        int regs = std::stoi(config.get(t86::Cpu::Config::registerCountConfigString));
+        int vregs = std::stoi(config.get(t86::Cpu::Config::vectorRegisterCountConfigString));
+        Optimalization(prg.get()).StartLevel(std::stoi(config.get("-o")), regs, vregs, MispredictPenalty());
+        Backend back(prg.get(), regs, std::stoi(config.get(t86::Cpu::Config::floatRegisterCountConfigString)), vregs);
+        back.irtot86();
+        return back.target->GetProgram();
     }
 
 
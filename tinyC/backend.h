@@ -4,6 +4,7 @@
 
 #include "IR.h"
 #include "IRTot86.h"
+#include "../tiny86/program.h"
 
 namespace tinyc {
 
@@ -11,12 +12,20 @@ namespace tinyc {
     class Backend {
     public:
 
-        Backend(IRProgram * prg,int regs = 10, int fregs = 5);
+        Backend(IRProgram * prg,int regs = 10, int fregs = 5, int vregs = 4);
         ~Backend();
         
         void irtot86();
         void Start();
 
+        /** Whole pipeline at the -o level of the config, without echoing the AST
+         */
+        static tiny::t86::Program Compile(std::string const & source);
+
+        /** Ticks to refill the frontend of the configured cpu after a mispredict
+         */
+        static int MispredictPenalty();
+
     protected:
         IRProgram * m_prg;
         IRTot86 * target;
@@ -362,13 +362,22 @@ namespace tinyc {
         return VAR_DECLS();
     }
 
-    /* VAR_DECL := TYPE identifier [ '[' E9 ']' ] [ '=' EXPR ]
+    /* VAR_DECL := TYPE identifier ( '[' integer ']' | '[' ']' '=' '{' E9 { ',' E9 } '}' | [ '=' EXPR ] )
         */
     std::unique_ptr<ASTVarDecl> Parser::VAR_DECL() {
         Token const & start = top();
         std::unique_ptr<ASTVarDecl> decl{new ASTVarDecl{start, TYPE()}};
         decl->name = IDENT();
         if (condPop(Symbol::SquareOpen)) {
+            if (top() == Token::Kind::Integer) {
+                Token const & t = top();
+                int size = pop(Token::Kind::Integer).valueInt();
+                if (size <= 0)
+                    throw ParserError(STR("Array size has to be positive"), t.location(), false);
+                pop(Symbol::SquareClose);
+                decl->varType.reset(new ASTArrayType{start, std::move(decl->varType), static_cast<size_t>(size)});
+                return decl;
+            }
 //            std::unique_ptr<AST> index{E9()};
 //            pop(Symbol::SquareClose);
 //            // now we have to update the type
@@ -606,6 +615,9 @@ namespace tinyc {
             pop(Symbol::ParClose);
             return std::unique_ptr<AST>{new ASTCast{op, std::move(expr), std::move(type)}};
         }
+        else if (top() == symbol::KwCoreId || top() == symbol::KwFence || top() == symbol::KwAtomicAdd || top() == symbol::KwRdpmc) {
+            return BUILTIN();
+        }
         else if (top() == Token::Kind::Identifier) {
             return IDENT();
         } else {
@@ -613,6 +625,27 @@ namespace tinyc {
         }
     }
 
+    /* BUILTIN := ( coreid | fence | atomic_add | rdpmc ) '(' [ EXPR { ',' EXPR } ] ')'
+        */
+    std::unique_ptr<AST> Parser::BUILTIN() {
+        ASTBuiltin::Kind kind = ASTBuiltin::Kind::coreId;
+        if (top() == symbol::KwFence)
+            kind = ASTBuiltin::Kind::fence;
+        else if (top() == symbol::KwAtomicAdd)
+            kind = ASTBuiltin::Kind::atomicAdd;
+        else if (top() == symbol::KwRdpmc)
+            kind = ASTBuiltin::Kind::rdpmc;
+        std::unique_ptr<ASTBuiltin> result{new ASTBuiltin{pop(), kind}};
+        pop(Symbol::ParOpen);
+        if (top() != Symbol::ParClose) {
+            result->args.push_back(EXPR());
+            while (condPop(Symbol::Comma))
+                result->args.push_back(EXPR());
+        }
+        pop(Symbol::ParClose);
+        return result;
+    }
+
     std::unique_ptr<ASTIdentifier> Parser::IDENT() {
         if (!isIdentifier(top()) || isTypeName(top().valueSymbol()))
             throw ParserError(STR("Expected identifier, but " << top() << " found"), top().location(), eof());
@@ -622,6 +655,10 @@ namespace tinyc {
     bool symbol::isKeyword(const Symbol &s) {
         return s == KwPrint
                || s == KwScan
+               || s == KwCoreId
+               || s == KwFence
+               || s == KwAtomicAdd
+               || s == KwRdpmc
                 ;
     }
 }
@@ -16,6 +16,10 @@ namespace tinyc {
     namespace symbol{
         static Symbol KwScan{"scan"};
         static Symbol KwPrint{"print"};
+        static Symbol KwCoreId{"coreid"};
+        static Symbol KwFence{"fence"};
+        static Symbol KwAtomicAdd{"atomic_add"};
+        static Symbol KwRdpmc{"rdpmc"};
         bool isKeyword(Symbol const & s);
     }
     class Parser : public ParserBase {
@@ -167,6 +171,7 @@ namespace tinyc {
         std::unique_ptr<AST> E_UNARY_PRE();
         std::unique_ptr<AST> E_CALL_INDEX_MEMBER_POST();
         std::unique_ptr<AST> F();
+        std::unique_ptr<AST> BUILTIN();
         std::unique_ptr<ASTIdentifier> IDENT();
 
     }; // tiny::Parser
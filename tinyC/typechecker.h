@@ -38,13 +38,10 @@ namespace tinyc {
             for (auto & x : ast->values)
             {
                 Type * t1 = visitChild(x);
-                if (t != nullptr)
-                {
-                    if (t != t1)
-                        throw ParserError(STR("Array elements has to be of the same type."),ast->location());
-                    else
-                        t = t1;
-                }
+                if (t == nullptr)
+                    t = t1;
+                else if (t != t1)
+                    throw ParserError(STR("Array elements has to be of the same type."),ast->location());
             }
             ast->setType(Type::getOrCreateArrayType(t));
         }
@@ -352,7 +349,7 @@ namespace tinyc {
         void visit(ASTIndex * ast) override {
             Type * t = visitChild(ast->base);
             Type::Array * arr = dynamic_cast<Type::Array*>(t);
-            if (t == nullptr)
+            if (arr == nullptr)
                 throw ParserError{STR("Index can be used only with array type."), ast->location()};
             t = visitChild(ast->index);
             if (t != Type::intType())
@@ -439,6 +436,28 @@ namespace tinyc {
         }
 
 
+        void visit(ASTBuiltin * ast) override {
+            size_t expected = ast->kind == ASTBuiltin::Kind::atomicAdd ? 2 : ast->kind == ASTBuiltin::Kind::rdpmc ? 1 : 0;
+            if (ast->args.size() != expected)
+                throw ParserError{STR(ASTBuiltin::name(ast->kind) << " expects " << expected << " arguments, but " << ast->args.size() << " were given"), ast->location()};
+            if (ast->kind == ASTBuiltin::Kind::atomicAdd) {
+                Type * target = visitChild(ast->args[0]);
+                Type * value = visitChild(ast->args[1]);
+                if (!ast->args[0]->hasAddress())
+                    throw ParserError{STR("Target of atomic_add must have an address"), ast->args[0]->location()};
+                if (target != Type::intType() || value != Type::intType())
+                    throw ParserError{STR("atomic_add works on int only"), ast->location()};
+            }
+            if (ast->kind == ASTBuiltin::Kind::rdpmc) {
+                // The counter is encoded in the instruction
+                ASTInteger * counter = dynamic_cast<ASTInteger*>(ast->args[0].get());
+                if (counter == nullptr || counter->value < 0 || counter->value > 3)
+                    throw ParserError{STR("rdpmc expects counter number 0 to 3"), ast->args[0]->location()};
+                visitChild(ast->args[0]);
+            }
+            ast->setType(ast->kind == ASTBuiltin::Kind::fence ? Type::voidType() : Type::intType());
+        }
+
         Type * visitChild(AST * ast) {
             ASTVisitor::visitChild(ast);
             return ast->type();